@@ -1,115 +1,137 @@
 #include "bbst.h"
+#include "bbst_internal.h"
+#include "clib_serial.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 short get_height(node_t *n) {
     if (n == NULL) {
-        fprintf(stderr, "get_height was given NULL node.\n");
-        return 1;
+        return 0;
     }
     return n->height;
 }
 
 short get_balance(node_t *n) {
     if (n == NULL) {
-        fprintf(stderr, "get_balance was given NULL node.\n");
+        CLIB_FAIL(CLIB_EINVAL, "get_balance was given NULL node.");
         return 1;
     }
     return get_height(n->right) - get_height(n->left);
 }
 
-node_t *node_create(void *data,
-                    size_t stride,
-                    size_t height,
-                    int (*compare_to)(void *elem1, void *elem2)) {
+/**
+* `update_height` recomputes the height of `n` from its children.
+*/
+void update_height(node_t *n) {
+    short l = get_height(n->left);
+    short r = get_height(n->right);
+    n->height = 1 + (l > r ? l : r);
+}
 
+/**
+* `node_create` allocates a new leaf holding a copy of `data`.
+* The node header and the element are allocated together, so a node
+* costs a single allocation of `sizeof(node_t) + stride` bytes.
+*/
+node_t *node_create(BBST *bbst, void *data) {
     if (data == NULL) {
-        fprintf(stderr, "create_node was given NULL value.\n");
+        CLIB_FAIL(CLIB_EINVAL, "create_node was given NULL value.");
         return NULL;
     }
 
-    // Allocate memory for the node struct on heap.
-    node_t *n = (node_t*)calloc(1, sizeof(node_t));
+    // Allocate memory for the node and its data.
+    CLIB_Allocator *a = &bbst->allocator;
+    node_t *n = (node_t*)a->alloc(a->ctx, sizeof(node_t) + bbst->stride);
     if (n == NULL) {
-        fprintf(stderr, "create_node failed to allocate memory for the node.\n");
-        return NULL;
-    }
-
-    // Allocate memory for the data of the node on the heap.
-    n->data = calloc(1, stride);
-    if (n->data == NULL) {
-        fprintf(stderr, "create_node failed to allocate memory for the dta.\n");
-        free(n);
+        CLIB_FAIL(CLIB_ENOMEM, "create_node failed to allocate memory for the node.");
         return NULL;
     }
 
     // Copy data into node.
-    void *dst = memcpy(n->data, data, stride);
-    if (dst == NULL) {
-        fprintf(stderr, "create_node failed to copy data into node.\n");
-        free(n->data);
-        free(n);
-        return NULL;
-    }
+    memcpy(n->data, data, bbst->stride);
 
     // Set other members.
-    n->stride     = stride;
-    n->left       = NULL;
-    n->right      = NULL;
-    n->height     = height;
-    n->compare_to = compare_to;
+    n->left   = NULL;
+    n->right  = NULL;
+    n->height = 1;
+    n->gen    = 0;
 
     return n;
 }
 
-void node_free_rec(node_t *current) {
-    if (current->left != NULL) {
-        node_free_rec(current->left);
+/**
+* `slab_node_size` is the distance between two nodes in a slab: the node
+* with its element, rounded up to keep the next node aligned.
+*/
+size_t slab_node_size(size_t stride) {
+    size_t align = _Alignof(node_t);
+    return (sizeof(node_t) + stride + align - 1) / align * align;
+}
+
+/**
+* `slab_alloc` allocates room for `n` nodes in a single block owned by
+* `bbst`, which has no slab yet. Node `i` starts `i * slab_node_size`
+* bytes into `bbst->slab`. `caller` is used for error messages.
+* Returns 0 on success, -1 otherwise.
+*/
+int slab_alloc(BBST *bbst, size_t n, const char *caller) {
+    size_t node_size = slab_node_size(bbst->stride);
+    if (node_size < bbst->stride || (n > 0 && node_size > SIZE_MAX / n)) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "%s error: %zu nodes overflow.", caller, n);
+        return -1;
     }
-    if (current->right != NULL) {
-        node_free_rec(current->right);
+
+    CLIB_Allocator *a = &bbst->allocator;
+    bbst->slab = (char *) a->alloc(a->ctx, n * node_size);
+    if (bbst->slab == NULL && n > 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "%s error: failed to allocate %zu nodes.", caller, n);
+        return -1;
     }
-    free(current->data);
-    free(current);
+    bbst->slab_size = n * node_size;
+
+    return 0;
 }
 
-node_t *node_insert(node_t *current,
-                    void *data,
-                    size_t stride,
-                    size_t height,
-                    int (*compare_to)(void *elem1, void *elem2)) {
+/**
+* `node_release` frees a node that was unlinked from the tree. Nodes of
+* the slab are only freed together with it by `BBST_free`.
+*/
+void node_release(BBST *bbst, node_t *n) {
+    if ((uintptr_t) n - (uintptr_t) bbst->slab < bbst->slab_size) {
+        return;
+    }
+    bbst->allocator.free(bbst->allocator.ctx, n, sizeof(node_t) + bbst->stride);
+}
 
-    if (compare_to(data, current->data) <= 0) {
-        printf("node_insert: new element smaller than current.\n");
-        if (current->left == NULL) {
-            printf("node_insert: child is NULL. Creating node.\n");
-            current->left = node_create(data, stride, height+1, compare_to);
+/**
+* `node_free_all` frees the subtree rooted at `current` without
+* recursion or a stack: left children are rotated up until the
+* current node has none, then it is freed and its right child is next.
+*/
+void node_free_all(BBST *bbst, node_t *current) {
+    while (current != NULL) {
+        if (current->left != NULL) {
+            node_t *l = current->left;
+            current->left = l->right;
+            l->right = current;
+            current = l;
         } else {
-            printf("node_insert: child exists. Descending...\n");
-            current->left = node_insert(current->left, data, stride, height+1, compare_to);
-        }
-    } else {
-        printf("node_insert: new element larger than current.\n");
-        if (current->right == NULL) {
-            printf("node_insert: child is NULL. Creating node.\n");
-            current->right = node_create(data, stride, height+1, compare_to);
-        } else {
-            printf("node_insert: child exists. Descending...\n");
-            current->right = node_insert(current->right, data, stride, height+1, compare_to);
+            node_t *next = current->right;
+            node_release(bbst, current);
+            current = next;
         }
     }
-
-    return current;
 }
 
 node_t *ror(node_t *n) {
     if (n == NULL) {
-        fprintf(stderr, "ror was given empty node.\n");
+        CLIB_FAIL(CLIB_EINVAL, "ror was given empty node.");
         return NULL;
     }
     if (n->left == NULL) {
-        fprintf(stderr, "ror was given node with no left child.\n");
+        CLIB_FAIL(CLIB_EINVAL, "ror was given node with no left child.");
         return NULL;
     }
 
@@ -117,16 +139,19 @@ node_t *ror(node_t *n) {
     n->left = n->left->right;
     l_temp->right = n;
 
+    update_height(n);
+    update_height(l_temp);
+
     return l_temp;
 }
 
 node_t *rol(node_t *n) {
     if (n == NULL) {
-        fprintf(stderr, "rol was given empty node.\n");
+        CLIB_FAIL(CLIB_EINVAL, "rol was given empty node.");
         return NULL;
     }
     if (n->right == NULL) {
-        fprintf(stderr, "rol was given node with no right child.\n");
+        CLIB_FAIL(CLIB_EINVAL, "rol was given node with no right child.");
         return NULL;
     }
 
@@ -134,40 +159,820 @@ node_t *rol(node_t *n) {
     n->right = n->right->left;
     r_temp->left = n;
 
+    update_height(n);
+    update_height(r_temp);
+
     return r_temp;
 }
 
+/**
+* `rebalance` restores the AVL property at `n`, given that both of its
+* subtrees are AVL trees whose heights differ by at most 2.
+* Returns the new root of the subtree.
+*/
+node_t *rebalance(node_t *n) {
+    update_height(n);
+    short balance = get_balance(n);
+
+    if (balance > 1) {
+        // Right-left case: turn it into the right-right case first.
+        if (get_balance(n->right) < 0) {
+            n->right = ror(n->right);
+        }
+        return rol(n);
+    }
+    if (balance < -1) {
+        // Left-right case: turn it into the left-left case first.
+        if (get_balance(n->left) > 0) {
+            n->left = rol(n->left);
+        }
+        return ror(n);
+    }
+
+    return n;
+}
+
+/**
+* `replace_child` makes `new_child` take the place of `old_child` below
+* `parent`, or the place of the root if `parent` is `NULL`.
+*/
+void replace_child(BBST *bbst, node_t *parent, node_t *old_child, node_t *new_child) {
+    if (parent == NULL) {
+        bbst->root = new_child;
+    } else if (parent->left == old_child) {
+        parent->left = new_child;
+    } else {
+        parent->right = new_child;
+    }
+}
+
+/**
+* `node_insert` links `node` into `bbst`. Elements equal to an existing
+* node go to its left. The path from the root is kept on an explicit
+* stack and retraced bottom up for rebalancing, which stops as soon as
+* a subtree keeps its root and height.
+*/
+void node_insert(BBST *bbst, node_t *node) {
+    node_t *path[BBST_MAX_HEIGHT];
+    int depth = 0;
+
+    node_t *current = bbst->root;
+    node_t **link = &bbst->root;
+    while (current != NULL) {
+        path[depth++] = current;
+        link = bbst->compare_to(node->data, current->data) <= 0 ? &current->left : &current->right;
+        current = *link;
+    }
+    *link = node;
+
+    while (depth > 0) {
+        node_t *n = path[--depth];
+        unsigned char old_height = n->height;
+        node_t *r = rebalance(n);
+        if (r != n) {
+            replace_child(bbst, depth > 0 ? path[depth - 1] : NULL, n, r);
+        } else if (n->height == old_height) {
+            break;
+        }
+    }
+}
+
+/**
+* `node_build` links the in-order slab nodes `lo..hi` (exclusive) into
+* a perfectly balanced subtree and returns its root. Takes O(hi - lo)
+* time; the recursion is only as deep as the resulting tree.
+*/
+node_t *node_build(char *slab, size_t node_size, size_t lo, size_t hi) {
+    if (lo >= hi) {
+        return NULL;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    node_t *n = (node_t *) (slab + mid * node_size);
+    n->gen   = 0;
+    n->left  = node_build(slab, node_size, lo, mid);
+    n->right = node_build(slab, node_size, mid + 1, hi);
+    update_height(n);
+    return n;
+}
+
+/**
+* `node_remove_min` unlinks the smallest node of the subtree rooted at
+* `current` and stores it in `min`. Returns the new root of the subtree.
+*/
+node_t *node_remove_min(node_t *current, node_t **min) {
+    if (current->left == NULL) {
+        *min = current;
+        return current->right;
+    }
+
+    current->left = node_remove_min(current->left, min);
+
+    return rebalance(current);
+}
+
+/**
+* `node_remove` unlinks one node equal to `data` from the subtree rooted
+* at `current` and stores it in `removed` (`NULL` if there is none).
+* Returns the new root of the subtree.
+*/
+node_t *node_remove(BBST *bbst, node_t *current, void *data, node_t **removed) {
+    if (current == NULL) {
+        *removed = NULL;
+        return NULL;
+    }
+
+    int cmp = bbst->compare_to(data, current->data);
+    if (cmp < 0) {
+        current->left = node_remove(bbst, current->left, data, removed);
+    } else if (cmp > 0) {
+        current->right = node_remove(bbst, current->right, data, removed);
+    } else {
+        *removed = current;
+        if (current->left == NULL) {
+            return current->right;
+        }
+        if (current->right == NULL) {
+            return current->left;
+        }
+
+        // Replace the node by its in-order successor.
+        node_t *successor;
+        node_t *right = node_remove_min(current->right, &successor);
+        successor->left  = current->left;
+        successor->right = right;
+        return rebalance(successor);
+    }
+
+    return rebalance(current);
+}
+
+/**
+* `node_count` returns the number of elements equal to `data` in the
+* subtree rooted at `current`. Equal elements can end up on both sides
+* of each other through rotations, so both subtrees of a match are
+* searched, which costs O(log n + k) for k matches.
+*/
+size_t node_count(BBST *bbst, node_t *current, void *data) {
+    size_t n = 0;
+    while (current != NULL) {
+        int cmp = bbst->compare_to(data, current->data);
+        if (cmp < 0) {
+            current = current->left;
+        } else if (cmp > 0) {
+            current = current->right;
+        } else {
+            n += 1 + node_count(bbst, current->left, data);
+            current = current->right;
+        }
+    }
+    return n;
+}
+
 
 BBST *BBST_create(size_t stride, int (*compare_to)(void *elem1, void *elem2)) {
-    BBST *bbst = (BBST *)calloc(1, sizeof(BBST));
+    return BBST_create_with_allocator(stride, compare_to, NULL);
+}
+
+/**
+* `BBST_create_with_allocator` works like `BBST_create`, but the tree
+* and all of its nodes are allocated from `allocator`. If `allocator`
+* is `NULL` malloc/free are used.
+*/
+BBST *BBST_create_with_allocator(size_t stride,
+                                 int (*compare_to)(void *elem1, void *elem2),
+                                 const CLIB_Allocator *allocator) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    BBST *bbst = (BBST *)a.alloc(a.ctx, sizeof(BBST));
     if (bbst == NULL) {
-        fprintf(stderr, "BBST_create failed to allocate memory for BBST.\n");
+        CLIB_FAIL(CLIB_ENOMEM, "BBST_create failed to allocate memory for BBST.");
         return NULL;
     }
 
     bbst->root       = NULL;
+    bbst->size       = 0;
     bbst->stride     = stride;
     bbst->compare_to = compare_to;
+    bbst->allocator  = a;
+    bbst->slab       = NULL;
+    bbst->slab_size  = 0;
+    bbst->sync       = NULL;
 
     return bbst;
 }
 
+/**
+* `BBST_free` frees all nodes of `bbst` and the tree itself.
+*/
 void BBST_free(BBST *bbst) {
+    if (bbst == NULL) {
+        return;
+    }
+
+    CLIB_Allocator a = bbst->allocator;
+    if (bbst->sync != NULL) {
+        bbst_sync_free(bbst);
+    }
     if (bbst->root != NULL) {
-        node_free_rec(bbst->root);
+        node_free_all(bbst, bbst->root);
+    }
+    if (bbst->slab != NULL) {
+        a.free(a.ctx, bbst->slab, bbst->slab_size);
     }
-    free(bbst);
+    a.free(a.ctx, bbst, sizeof(BBST));
 }
 
+/**
+* `BBST_insert` inserts a copy of `data` into `bbst`. Duplicates are
+* allowed. The tree is rebalanced on the way up, so its height stays
+* below 1.44 log2(n) even for sorted input.
+* Returns 0 on success, -1 otherwise.
+*/
 int BBST_insert(BBST *bbst, void *data) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_insert error: provided BBST is NULL.");
+        return -1;
+    }
+    if (bbst->sync != NULL) {
+        return bbst_sync_insert(bbst, data);
+    }
+
+    node_t *node = node_create(bbst, data);
+    if (node == NULL) {
+        return -1;
+    }
+
+    node_insert(bbst, node);
+    bbst->size++;
+
+    return 0;
+}
+
+/**
+* `BBST_remove` removes one occurrence of `data` from `bbst`.
+* Returns 0 on success (also if `data` does not occur), -1 otherwise.
+*/
+int BBST_remove(BBST *bbst, void *data) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_remove error: provided BBST is NULL.");
+        return -1;
+    }
+    if (bbst->sync != NULL) {
+        return bbst_sync_remove(bbst, data);
+    }
+
+    node_t *removed;
+    bbst->root = node_remove(bbst, bbst->root, data, &removed);
+    if (removed != NULL) {
+        node_release(bbst, removed);
+        bbst->size--;
+    }
+
+    return 0;
+}
+
+/**
+* `BBST_top` returns a pointer to the smallest element of `bbst`
+* (with respect to `compare_to`) without removing it.
+* Returns `NULL` if `bbst` is empty or not initialized.
+*/
+void *BBST_top(BBST *bbst) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_top error: provided BBST is NULL.");
+        return NULL;
+    }
+
+    node_t *n = load_root(bbst);
+    if (n == NULL) {
+        return NULL;
+    }
+    while (n->left != NULL) {
+        n = n->left;
+    }
+
+    return n->data;
+}
+
+/**
+* `BBST_pop` removes the smallest element of `bbst`, copies it into
+* newly allocated memory and returns a pointer to it.
+* `free()` needs to be called manually!
+* Returns `NULL` if `bbst` is empty or on failure.
+*/
+void *BBST_pop(BBST *bbst) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_pop error: provided BBST is NULL.");
+        return NULL;
+    }
+    if (bbst->sync != NULL) {
+        return bbst_sync_pop(bbst);
+    }
+
     if (bbst->root == NULL) {
-        bbst->root = node_create(data, bbst->stride, 0, bbst->compare_to);
-        return 0;
+        return NULL;
+    }
+
+    void *result = malloc(bbst->stride);
+    if (result == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "BBST_pop error: memory allocation for result failed.");
+        return NULL;
+    }
+
+    node_t *min;
+    bbst->root = node_remove_min(bbst->root, &min);
+    memcpy(result, min->data, bbst->stride);
+    node_release(bbst, min);
+    bbst->size--;
+
+    return result;
+}
+
+/**
+* `BBST_is_empty` returns 0 if `bbst` is empty, 1 if it
+* is not and -1 if the provided BBST was not initialized.
+*/
+int BBST_is_empty(BBST *bbst) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_is_empty error: provided BBST is NULL.");
+        return -1;
+    }
+    return __atomic_load_n(&bbst->size, __ATOMIC_RELAXED) == 0 ? 0 : 1;
+}
+
+/**
+* `BBST_size` returns the number of elements in `bbst`,
+* or -1 if the provided BBST was not initialized.
+*/
+long BBST_size(BBST *bbst) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_size error: provided BBST is NULL.");
+        return -1;
+    }
+    return __atomic_load_n(&bbst->size, __ATOMIC_RELAXED);
+}
+
+/**
+* `BBST_contains` returns 1 if `data` occurs in `bbst`,
+* 0 if it does not and -1 on failure.
+*/
+int BBST_contains(BBST *bbst, void *data) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_contains error: provided BBST is NULL.");
+        return -1;
+    }
+
+    node_t *n = load_root(bbst);
+    while (n != NULL) {
+        int cmp = bbst->compare_to(data, n->data);
+        if (cmp == 0) {
+            return 1;
+        }
+        n = cmp < 0 ? n->left : n->right;
+    }
+
+    return 0;
+}
+
+/**
+* `BBST_count` returns the number of occurrences of `data` in `bbst`.
+* Returns -1 on failure.
+*/
+long BBST_count(BBST *bbst, void *data) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_count error: provided BBST is NULL.");
+        return -1;
+    }
+
+    return node_count(bbst, load_root(bbst), data);
+}
+
+/**
+* `BBST_height` returns the height of `bbst` (0 for an empty tree),
+* or -1 if the provided BBST was not initialized.
+*/
+int BBST_height(BBST *bbst) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_height error: provided BBST is NULL.");
+        return -1;
     }
+    return get_height(load_root(bbst));
+}
 
-    bbst->root = node_insert(bbst->root, data, bbst->stride, 0, bbst->compare_to);
+/**
+* `iter_descend` pushes `n` and then its leftmost (`dir == 0`) or
+* rightmost (`dir == 1`) descendants onto the path of `it`.
+*/
+void iter_descend(BBST_iter *it, node_t *n, int dir) {
+    while (n != NULL) {
+        it->path[it->depth++] = n;
+        n = dir == 0 ? n->left : n->right;
+    }
+}
+
+/**
+* `iter_in_range` returns the current element of `it`, or `NULL` if
+* `it` is past the end or its element is not below the upper bound.
+*/
+void *iter_in_range(BBST_iter *it) {
+    if (it->depth == 0) {
+        return NULL;
+    }
+    void *data = it->path[it->depth - 1]->data;
+    if (it->hi != NULL && it->bbst->compare_to(data, it->hi) >= 0) {
+        return NULL;
+    }
+    return data;
+}
+
+/**
+* `iter_begin_at` positions `it` at the smallest element of the tree
+* below `root`, a snapshot of the root of `bbst`.
+*/
+static void iter_begin_at(BBST *bbst, BBST_iter *it, node_t *root) {
+    it->bbst  = bbst;
+    it->hi    = NULL;
+    it->depth = 0;
+    iter_descend(it, root, 0);
+}
+
+/**
+* `BBST_iter_begin` positions `it` at the smallest element of `bbst`.
+* Iterators keep the path from the root to the current node in a fixed
+* size array, so moving them neither recurses nor allocates. Any
+* insert or remove on `bbst` invalidates its iterators.
+* Returns 0 on success, -1 otherwise.
+*/
+int BBST_iter_begin(BBST *bbst, BBST_iter *it) {
+    if (bbst == NULL || it == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_iter_begin error: provided BBST or iterator is NULL.");
+        return -1;
+    }
+
+    iter_begin_at(bbst, it, load_root(bbst));
 
     return 0;
 }
 
+/**
+* `BBST_iter_last` positions `it` at the largest element of `bbst`.
+* Returns 0 on success, -1 otherwise.
+*/
+int BBST_iter_last(BBST *bbst, BBST_iter *it) {
+    if (bbst == NULL || it == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_iter_last error: provided BBST or iterator is NULL.");
+        return -1;
+    }
+
+    it->bbst  = bbst;
+    it->hi    = NULL;
+    it->depth = 0;
+    iter_descend(it, load_root(bbst), 1);
+
+    return 0;
+}
+
+/**
+* `BBST_iter_seek` positions `it` at the first element of `bbst` that
+* is not smaller than `key`, or past the end if there is none.
+* Returns 0 on success, -1 otherwise.
+*/
+int BBST_iter_seek(BBST *bbst, BBST_iter *it, void *key) {
+    if (bbst == NULL || it == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_iter_seek error: provided BBST or iterator is NULL.");
+        return -1;
+    }
+
+    it->bbst  = bbst;
+    it->hi    = NULL;
+    it->depth = 0;
+
+    // The path to the lower bound is a prefix of the search path.
+    int found = 0;
+    node_t *n = load_root(bbst);
+    while (n != NULL) {
+        it->path[it->depth++] = n;
+        if (bbst->compare_to(n->data, key) >= 0) {
+            found = it->depth;
+            n = n->left;
+        } else {
+            n = n->right;
+        }
+    }
+    it->depth = found;
+
+    return 0;
+}
+
+/**
+* `BBST_iter_range` positions `it` at the first element not smaller
+* than `lo` and limits it to elements smaller than `hi`, i.e. it scans
+* the range [lo, hi). Either bound may be `NULL` for no limit. `hi`
+* must stay valid while iterating.
+* Returns 0 on success, -1 otherwise.
+*/
+int BBST_iter_range(BBST *bbst, BBST_iter *it, void *lo, void *hi) {
+    int res = lo != NULL ? BBST_iter_seek(bbst, it, lo) : BBST_iter_begin(bbst, it);
+    if (res == 0) {
+        it->hi = hi;
+    }
+    return res;
+}
+
+/**
+* `BBST_iter_get` returns a pointer to the current element of `it`,
+* or `NULL` if `it` is past the end of the tree or range.
+*/
+void *BBST_iter_get(BBST_iter *it) {
+    if (it == NULL) {
+        return NULL;
+    }
+    return iter_in_range(it);
+}
+
+/**
+* `BBST_iter_next` moves `it` to the next larger element and returns
+* a pointer to it, or `NULL` once the end of the tree or range is passed.
+*/
+void *BBST_iter_next(BBST_iter *it) {
+    if (it == NULL || it->depth == 0) {
+        return NULL;
+    }
+
+    node_t *n = it->path[it->depth - 1];
+    if (n->right != NULL) {
+        iter_descend(it, n->right, 0);
+    } else {
+        // Go up until we leave a left subtree.
+        it->depth--;
+        while (it->depth > 0 && it->path[it->depth - 1]->right == n) {
+            n = it->path[--it->depth];
+        }
+    }
+
+    return iter_in_range(it);
+}
+
+/**
+* `BBST_iter_prev` moves `it` to the next smaller element and returns
+* a pointer to it, or `NULL` once the beginning of the tree is passed.
+*/
+void *BBST_iter_prev(BBST_iter *it) {
+    if (it == NULL || it->depth == 0) {
+        return NULL;
+    }
+
+    node_t *n = it->path[it->depth - 1];
+    if (n->left != NULL) {
+        iter_descend(it, n->left, 1);
+    } else {
+        // Go up until we leave a right subtree.
+        it->depth--;
+        while (it->depth > 0 && it->path[it->depth - 1]->left == n) {
+            n = it->path[--it->depth];
+        }
+    }
+
+    return iter_in_range(it);
+}
+
+#define SERIAL_MAGIC "CLIB_BTS"
+
+/**
+* `BBST_serialize` writes the elements of `bbst` in order to `out`,
+* after a header with stride, count and a checksum of the elements
+* (the format of `DL_serialize`). To serialize into memory, use
+* `open_memstream` or `fmemopen` for `out`.
+* Returns 0 on success, -1 otherwise.
+*/
+int BBST_serialize(BBST *bbst, FILE *out) {
+    if (bbst == NULL || out == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_serialize error: provided BBST or FILE is NULL.");
+        return -1;
+    }
+
+    // In concurrent mode writers may replace the root at any time, so
+    // the count, the checksum and the elements all come from one
+    // snapshot, which is kept alive by a read-side critical section.
+    int token = BBST_read_lock(bbst);
+    node_t *root = load_root(bbst);
+    int rc = 0;
+
+    // The checksum goes into the header, so the elements are visited twice.
+    BBST_iter it;
+    CLIB_Checksum c;
+    clib_checksum_init(&c);
+    size_t count = 0;
+    iter_begin_at(bbst, &it, root);
+    for (void *e = BBST_iter_get(&it); e != NULL; e = BBST_iter_next(&it)) {
+        clib_checksum_update(&c, e, bbst->stride);
+        count++;
+    }
+
+    CLIB_SerialHeader h = {
+        .magic    = SERIAL_MAGIC,
+        .version  = CLIB_SERIAL_VERSION,
+        .stride   = bbst->stride,
+        .count    = count,
+        .checksum = clib_checksum_final(&c),
+    };
+    if (fwrite(&h, sizeof(h), 1, out) != 1) {
+        rc = -1;
+    }
+
+    iter_begin_at(bbst, &it, root);
+    for (void *e = BBST_iter_get(&it); e != NULL && rc == 0; e = BBST_iter_next(&it)) {
+        if (fwrite(e, bbst->stride, 1, out) != 1) {
+            rc = -1;
+        }
+    }
+
+    BBST_read_unlock(bbst, token);
+    if (rc != 0) {
+        CLIB_FAIL(CLIB_EIO, "BBST_serialize error: write failed: %s", strerror(errno));
+    }
+    return rc;
+}
+
+/**
+* `BBST_deserialize` reads a tree written by `BBST_serialize` from `in`.
+* The elements are read straight into nodes allocated in one slab (see
+* `BBST_from_sorted`), which are then linked into a perfectly balanced
+* tree in O(n) instead of being inserted one by one. The count in the
+* header is checked against the size of `in` first; if `in` is not
+* seekable, the slab grows as the elements arrive instead. The checksum and
+* the order of the elements with respect to `compare_to` are verified.
+* Returns `NULL` on failure, with the last error `CLIB_EFORMAT` for
+* malformed, truncated, corrupted or unordered input.
+*/
+BBST *BBST_deserialize(FILE *in, int (*compare_to)(void *, void *)) {
+    if (in == NULL || compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_deserialize error: provided FILE or compare_to is NULL.");
+        return NULL;
+    }
 
+    CLIB_SerialHeader h;
+    int err = clib_serial_read_header(in, SERIAL_MAGIC, &h);
+    if (err != CLIB_OK) {
+        CLIB_FAIL(err, "BBST_deserialize error: missing or invalid header.");
+        return NULL;
+    }
+    if (h.count > SIZE_MAX || h.stride > SIZE_MAX - sizeof(node_t)) {
+        CLIB_FAIL(CLIB_EFORMAT, "BBST_deserialize error: header sizes overflow.");
+        return NULL;
+    }
+
+    int seekable;
+    err = clib_serial_check_size(in, &h, &seekable);
+    if (err != CLIB_OK) {
+        CLIB_FAIL(err, "BBST_deserialize error: input is truncated.");
+        return NULL;
+    }
+
+    BBST *bbst = BBST_create(h.stride, compare_to);
+    if (bbst == NULL) {
+        return NULL;
+    }
+    // Without the size of the input, the slab starts at about
+    // CLIB_SERIAL_CHUNK bytes and grows as the elements arrive. The nodes
+    // are only linked once all are read, so it can move until then.
+    size_t n = h.count;
+    size_t node_size = slab_node_size(h.stride);
+    size_t capacity = n;
+    if (!seekable && capacity > CLIB_SERIAL_CHUNK / node_size) {
+        capacity = CLIB_SERIAL_CHUNK / node_size + 1;
+    }
+    if (slab_alloc(bbst, capacity, "BBST_deserialize") != 0) {
+        BBST_free(bbst);
+        return NULL;
+    }
+
+    CLIB_Checksum c;
+    clib_checksum_init(&c);
+    for (size_t i = 0; i < n && err == CLIB_OK; i++) {
+        if (i == capacity) {
+            size_t grown = capacity <= n / 2 ? 2 * capacity : n;
+            char *slab = (char *) bbst->allocator.realloc(bbst->allocator.ctx, bbst->slab,
+                                                          bbst->slab_size, grown * node_size);
+            if (slab == NULL) {
+                CLIB_FAIL(CLIB_ENOMEM, "BBST_deserialize error: failed to allocate %zu nodes.", grown);
+                BBST_free(bbst);
+                return NULL;
+            }
+            bbst->slab = slab;
+            bbst->slab_size = grown * node_size;
+            capacity = grown;
+        }
+        node_t *node = (node_t *) (bbst->slab + i * node_size);
+        if (fread(node->data, h.stride, 1, in) != 1) {
+            err = ferror(in) ? CLIB_EIO : CLIB_EFORMAT;
+            break;
+        }
+        clib_checksum_update(&c, node->data, h.stride);
+        if (i > 0 && compare_to(((node_t *) (bbst->slab + (i - 1) * node_size))->data, node->data) > 0) {
+            err = CLIB_EFORMAT;
+        }
+    }
+    if (err == CLIB_OK && clib_checksum_final(&c) != h.checksum) {
+        err = CLIB_EFORMAT;
+    }
+
+    if (err != CLIB_OK) {
+        CLIB_FAIL(err, "BBST_deserialize error: failed to read elements.");
+        BBST_free(bbst);
+        return NULL;
+    }
+
+    bbst->root = node_build(bbst->slab, node_size, 0, n);
+    bbst->size = n;
+
+    return bbst;
+}
+
+/**
+* `BBST_from_sorted` builds a tree holding copies of the elements of
+* `sorted`, with its `stride`, `compare_to` and allocator, in O(n): all
+* nodes are allocated in one contiguous slab and linked into a perfectly
+* balanced tree without comparisons. Unless `sorted` is in sorted mode,
+* its order is checked first (n - 1 comparisons).
+* Nodes of the slab are not freed when removed, only by `BBST_free`.
+* Returns `NULL` if `sorted` is not sorted or on failure.
+*/
+BBST *BBST_from_sorted(DynList *sorted) {
+    if (sorted == NULL || sorted->compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_from_sorted error: provided DynList or its compare_to is NULL.");
+        return NULL;
+    }
+
+    size_t n = sorted->size;
+    size_t stride = sorted->stride;
+    if (!sorted->sorted) {
+        for (size_t i = 1; i < n; i++) {
+            if (sorted->compare_to(sorted->data + (i - 1) * stride, sorted->data + i * stride) > 0) {
+                CLIB_FAIL(CLIB_EINVAL, "BBST_from_sorted error: DynList is not sorted (index %zu).", i);
+                return NULL;
+            }
+        }
+    }
+
+    BBST *bbst = BBST_create_with_allocator(stride, sorted->compare_to, &sorted->allocator);
+    if (bbst == NULL) {
+        return NULL;
+    }
+    if (slab_alloc(bbst, n, "BBST_from_sorted") != 0) {
+        BBST_free(bbst);
+        return NULL;
+    }
+
+    size_t node_size = slab_node_size(stride);
+    for (size_t i = 0; i < n; i++) {
+        memcpy(((node_t *) (bbst->slab + i * node_size))->data, sorted->data + i * stride, stride);
+    }
+    bbst->root = node_build(bbst->slab, node_size, 0, n);
+    bbst->size = n;
+
+    return bbst;
+}
+
+/**
+* `BBST_to_dynlist` returns a new DynList holding copies of all elements
+* of `bbst` in order, with the tree's `stride`, `compare_to` and
+* allocator, and a capacity of the tree's size. The list is in sorted
+* mode if the tree has a `compare_to` function. In concurrent mode the
+* elements come from one snapshot of the tree, taken in a read-side
+* critical section of its own.
+* Returns `NULL` on failure.
+*/
+DynList *BBST_to_dynlist(BBST *bbst) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_to_dynlist error: provided BBST is NULL.");
+        return NULL;
+    }
+
+    int token = BBST_read_lock(bbst);
+    node_t *root = load_root(bbst);
+
+    // `size` may belong to a different version of the tree than `root`,
+    // so it is only a hint: the list grows if the snapshot is larger.
+    DynList *dl = DL_create_with_allocator(__atomic_load_n(&bbst->size, __ATOMIC_RELAXED), bbst->stride,
+                                           bbst->compare_to, &bbst->allocator);
+    if (dl == NULL) {
+        BBST_read_unlock(bbst, token);
+        return NULL;
+    }
+
+    BBST_iter it;
+    iter_begin_at(bbst, &it, root);
+    for (void *e = BBST_iter_get(&it); e != NULL; e = BBST_iter_next(&it)) {
+        if (dl->size == dl->capacity && DL_reserve(dl, 2 * dl->capacity + 1) != 0) {
+            BBST_read_unlock(bbst, token);
+            DL_free(dl);
+            return NULL;
+        }
+        memcpy(dl->data + dl->size * dl->stride, e, bbst->stride);
+        dl->size++;
+    }
+    BBST_read_unlock(bbst, token);
+    dl->sorted = bbst->compare_to != NULL;
+
+    return dl;
+}
@@ -8,27 +8,84 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "clib_alloc.h"
+#include "clib_log.h"
+#include "dynlist.h"
+
+// Upper bound for the height of an AVL tree with up to 2^64 nodes
+// (1.44 * 64), used for fixed size path stacks.
+#define BBST_MAX_HEIGHT 96
+
 typedef struct node_t {
-    // Pointer to the data being stored in the specific node.
-    void *data;
-    size_t stride;
     // Pointer to children.
     struct node_t *left;
     struct node_t *right;
-    // Height of the node.
-    size_t height;
-    // Function pointer for comparison of nodes
-    int (*compare_to)(void *elem1, void *elem2);
+    // Height of the subtree rooted at this node (a leaf has height 1).
+    unsigned char height;
+    // Write operation that created the node in concurrent mode (see
+    // `BBST_make_concurrent`), 0 otherwise.
+    unsigned long long gen;
+    // The element itself, stored inline behind the node header.
+    _Alignas(max_align_t) char data[];
 } node_t;
 
+typedef struct BBST_Sync BBST_Sync;
+
 typedef struct {
     node_t *root;
+    // Number of elements in the tree.
+    size_t size;
     size_t stride;
     int (*compare_to)(void *elem1, void *elem2);
+    // Allocator for the tree and its nodes.
+    CLIB_Allocator allocator;
+    // Block holding the nodes built by `BBST_from_sorted` and
+    // `BBST_deserialize` (NULL if none), freed as a whole by `BBST_free`.
+    char *slab;
+    size_t slab_size;
+    // State of the concurrent mode (see `BBST_make_concurrent`), NULL
+    // for trees that are not shared between threads.
+    BBST_Sync *sync;
 } BBST;
 
+typedef struct {
+    BBST *bbst;
+    // Exclusive upper bound of a range scan, NULL if unbounded.
+    void *hi;
+    // Path from the root to the current node.
+    node_t *path[BBST_MAX_HEIGHT];
+    // Length of `path`, 0 once the iterator is past the end.
+    int depth;
+} BBST_iter;
+
 BBST *BBST_create(size_t stride, int (*compare_to)(void *elem1, void *elem2));
+BBST *BBST_create_with_allocator(size_t stride,
+                                 int (*compare_to)(void *elem1, void *elem2),
+                                 const CLIB_Allocator *allocator);
 void BBST_free(BBST *bbst);
 int BBST_insert(BBST *bbst, void *data);
+int BBST_remove(BBST *bbst, void *data);
+void *BBST_pop(BBST *bbst);
+void *BBST_top(BBST *bbst);
+int BBST_is_empty(BBST *bbst);
+long BBST_size(BBST *bbst);
+int BBST_contains(BBST *bbst, void *data);
+long BBST_count(BBST *bbst, void *data);
+int BBST_height(BBST *bbst);
+BBST *BBST_from_sorted(DynList *sorted);
+DynList *BBST_to_dynlist(BBST *bbst);
+int BBST_serialize(BBST *bbst, FILE *out);
+BBST *BBST_deserialize(FILE *in, int (*compare_to)(void *, void *));
+int BBST_make_concurrent(BBST *bbst);
+int BBST_read_lock(BBST *bbst);
+void BBST_read_unlock(BBST *bbst, int token);
+int BBST_synchronize(BBST *bbst);
+int BBST_iter_begin(BBST *bbst, BBST_iter *it);
+int BBST_iter_last(BBST *bbst, BBST_iter *it);
+int BBST_iter_seek(BBST *bbst, BBST_iter *it, void *key);
+int BBST_iter_range(BBST *bbst, BBST_iter *it, void *lo, void *hi);
+void *BBST_iter_get(BBST_iter *it);
+void *BBST_iter_next(BBST_iter *it);
+void *BBST_iter_prev(BBST_iter *it);
 
 #endif
@@ -0,0 +1,33 @@
+#ifndef BBST_INTERNAL_H
+#define BBST_INTERNAL_H
+
+#include "bbst.h"
+
+/*
+* Declarations shared by the source files of the library, not installed.
+*/
+
+short get_height(node_t *n);
+short get_balance(node_t *n);
+void update_height(node_t *n);
+node_t *ror(node_t *n);
+node_t *rol(node_t *n);
+void node_release(BBST *bbst, node_t *n);
+
+/**
+* `load_root` reads the root of `bbst`. In concurrent mode the writer
+* replaces the root while readers traverse the tree, so it is read
+* atomically; the sequentially consistent order pairs it with the
+* reader counters of `BBST_read_lock` (a plain load on x86).
+*/
+static inline node_t *load_root(BBST *bbst) {
+    return __atomic_load_n(&bbst->root, __ATOMIC_SEQ_CST);
+}
+
+// Write operations of the concurrent mode, see bbstsync.c.
+int bbst_sync_insert(BBST *bbst, void *data);
+int bbst_sync_remove(BBST *bbst, void *data);
+void *bbst_sync_pop(BBST *bbst);
+void bbst_sync_free(BBST *bbst);
+
+#endif // BBST_INTERNAL_H
@@ -0,0 +1,464 @@
+#include "bbst.h"
+#include "bbst_internal.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+* Concurrent mode: any number of readers and one writer at a time.
+*
+* Writers never modify a node readers can reach. They copy the path
+* from the root to every node they change (path copying), rebalance
+* the copies and publish the new root with a single atomic store.
+* Readers therefore see either the old or the new tree, never a mix,
+* and never wait.
+*
+* Replaced nodes are retired and freed once no reader can hold them
+* (epoch based reclamation): readers register in one of two counters,
+* chosen by the parity of the current epoch. The writer advances the
+* epoch only when the counters of the other parity are all zero; the
+* nodes retired two epochs ago are then unreachable for every reader
+* and freed. Advancing is attempted after each write, so a writer
+* never waits for readers either.
+*/
+
+// Reader counters are spread over this many slots to keep readers on
+// different cores from contending on one cache line.
+#define SYNC_SLOTS 64
+#define CACHE_LINE 64
+// Nodes a write operation may copy or create: at most three per level
+// (the node and both nodes of a double rotation), the new node and the
+// successor of a removed node.
+#define COW_MAX (3 * (BBST_MAX_HEIGHT + 1) + 2)
+
+typedef struct {
+    atomic_long readers[2];
+    char        pad[CACHE_LINE - 2 * sizeof(atomic_long)];
+} sync_slot;
+
+struct BBST_Sync {
+    sync_slot       slots[SYNC_SLOTS];
+    atomic_ulong    epoch;
+    pthread_mutex_t write_lock;
+    // Generation of the current write operation, see `node_t.gen`.
+    unsigned long long gen;
+    // Preallocated nodes, so write operations cannot fail halfway.
+    node_t          *spare[COW_MAX];
+    size_t          n_spare;
+    // Nodes retired during even and odd epochs.
+    node_t          **retired[2];
+    size_t          n_retired[2];
+    size_t          cap_retired[2];
+};
+
+typedef struct {
+    BBST              *bbst;
+    unsigned long long gen;
+    // Nodes replaced by this operation.
+    node_t            *old[COW_MAX];
+    size_t            n_old;
+    // Number of spare nodes before the operation.
+    size_t            n_spare;
+} cow_op;
+
+static atomic_uint next_slot;
+static _Thread_local unsigned thread_slot;
+
+/**
+* `cow` returns `n` if it was created by the running operation, and a
+* private copy of it otherwise, which the caller may modify.
+*/
+static node_t *cow(cow_op *op, node_t *n) {
+    if (n == NULL || n->gen == op->gen) {
+        return n;
+    }
+    BBST_Sync *s = op->bbst->sync;
+    node_t *c = s->spare[--s->n_spare];
+    memcpy(c, n, sizeof(node_t) + op->bbst->stride);
+    c->gen = op->gen;
+    op->old[op->n_old++] = n;
+    return c;
+}
+
+/**
+* `cow_rebalance` works like `rebalance` on the copy `n`, copying the
+* children a rotation changes first.
+*/
+static node_t *cow_rebalance(cow_op *op, node_t *n) {
+    update_height(n);
+    short balance = get_balance(n);
+
+    if (balance > 1) {
+        n->right = cow(op, n->right);
+        if (get_balance(n->right) < 0) {
+            n->right->left = cow(op, n->right->left);
+            n->right = ror(n->right);
+        }
+        return rol(n);
+    }
+    if (balance < -1) {
+        n->left = cow(op, n->left);
+        if (get_balance(n->left) > 0) {
+            n->left->right = cow(op, n->left->right);
+            n->left = rol(n->left);
+        }
+        return ror(n);
+    }
+
+    return n;
+}
+
+static node_t *cow_insert(cow_op *op, node_t *n, node_t *node) {
+    if (n == NULL) {
+        return node;
+    }
+    n = cow(op, n);
+    if (op->bbst->compare_to(node->data, n->data) <= 0) {
+        n->left = cow_insert(op, n->left, node);
+    } else {
+        n->right = cow_insert(op, n->right, node);
+    }
+    return cow_rebalance(op, n);
+}
+
+static node_t *cow_remove_min(cow_op *op, node_t *n, node_t **min) {
+    if (n->left == NULL) {
+        *min = n;
+        return n->right;
+    }
+    n = cow(op, n);
+    n->left = cow_remove_min(op, n->left, min);
+    return cow_rebalance(op, n);
+}
+
+/**
+* `cow_remove` is `node_remove` with path copying. The removed node is
+* retired along with the replaced ones.
+*/
+static node_t *cow_remove(cow_op *op, node_t *n, void *data, int *removed) {
+    if (n == NULL) {
+        return NULL;
+    }
+
+    int cmp = op->bbst->compare_to(data, n->data);
+    if (cmp == 0) {
+        *removed = 1;
+        op->old[op->n_old++] = n;
+        if (n->left == NULL) {
+            return n->right;
+        }
+        if (n->right == NULL) {
+            return n->left;
+        }
+
+        // Replace the node by a copy of its in-order successor.
+        node_t *successor;
+        node_t *right = cow_remove_min(op, n->right, &successor);
+        successor = cow(op, successor);
+        successor->left  = n->left;
+        successor->right = right;
+        return cow_rebalance(op, successor);
+    }
+
+    n = cow(op, n);
+    if (cmp < 0) {
+        n->left = cow_remove(op, n->left, data, removed);
+    } else {
+        n->right = cow_remove(op, n->right, data, removed);
+    }
+    return cow_rebalance(op, n);
+}
+
+/**
+* `retired_reserve` makes room for `n` more nodes in the retired list
+* of the current epoch.
+*/
+static int retired_reserve(BBST *bbst, size_t n, const char *caller) {
+    BBST_Sync *s = bbst->sync;
+    int e = atomic_load(&s->epoch) & 1;
+    if (s->n_retired[e] + n <= s->cap_retired[e]) {
+        return 0;
+    }
+
+    size_t cap = 2 * s->cap_retired[e] + n;
+    CLIB_Allocator *a = &bbst->allocator;
+    node_t **r = (node_t **) a->realloc(a->ctx, s->retired[e], s->cap_retired[e] * sizeof(node_t *),
+                                        cap * sizeof(node_t *));
+    if (r == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "%s error: failed to grow the list of retired nodes.", caller);
+        return -1;
+    }
+    s->retired[e]     = r;
+    s->cap_retired[e] = cap;
+    return 0;
+}
+
+/**
+* `try_advance` frees the nodes retired two epochs ago and advances the
+* epoch, unless readers registered under the other parity are still
+* active. Returns 1 if the epoch was advanced, 0 otherwise.
+*/
+static int try_advance(BBST *bbst) {
+    BBST_Sync *s = bbst->sync;
+    unsigned long e = atomic_load(&s->epoch);
+    int next = (e + 1) & 1;
+    for (int i = 0; i < SYNC_SLOTS; i++) {
+        if (atomic_load(&s->slots[i].readers[next]) != 0) {
+            return 0;
+        }
+    }
+
+    for (size_t i = 0; i < s->n_retired[next]; i++) {
+        node_release(bbst, s->retired[next][i]);
+    }
+    s->n_retired[next] = 0;
+    atomic_store(&s->epoch, e + 1);
+    return 1;
+}
+
+/**
+* `write_begin` takes the write lock and prepares `op`: it tops up the
+* spare nodes and the retired list for the worst case of one write
+* operation, so nothing can fail once the tree is being changed.
+* Returns 0 on success, -1 (with the lock released) otherwise.
+*/
+static int write_begin(BBST *bbst, cow_op *op, const char *caller) {
+    BBST_Sync *s = bbst->sync;
+    pthread_mutex_lock(&s->write_lock);
+
+    size_t need = 3 * ((size_t) get_height(bbst->root) + 1) + 2;
+    CLIB_Allocator *a = &bbst->allocator;
+    while (s->n_spare < need) {
+        node_t *n = (node_t *) a->alloc(a->ctx, sizeof(node_t) + bbst->stride);
+        if (n == NULL) {
+            CLIB_FAIL(CLIB_ENOMEM, "%s error: failed to allocate memory for nodes.", caller);
+            pthread_mutex_unlock(&s->write_lock);
+            return -1;
+        }
+        s->spare[s->n_spare++] = n;
+    }
+    if (retired_reserve(bbst, COW_MAX, caller) != 0) {
+        pthread_mutex_unlock(&s->write_lock);
+        return -1;
+    }
+
+    op->bbst    = bbst;
+    op->gen     = ++s->gen;
+    op->n_old   = 0;
+    op->n_spare = s->n_spare;
+    return 0;
+}
+
+/**
+* `write_end` publishes `root`, retires the nodes `op` replaced, tries to
+* reclaim older ones and releases the write lock.
+*/
+static void write_end(BBST *bbst, cow_op *op, node_t *root, size_t size) {
+    BBST_Sync *s = bbst->sync;
+    __atomic_store_n(&bbst->root, root, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&bbst->size, size, __ATOMIC_RELAXED);
+
+    int e = atomic_load(&s->epoch) & 1;
+    memcpy(s->retired[e] + s->n_retired[e], op->old, op->n_old * sizeof(node_t *));
+    s->n_retired[e] += op->n_old;
+
+    try_advance(bbst);
+    pthread_mutex_unlock(&s->write_lock);
+}
+
+int bbst_sync_insert(BBST *bbst, void *data) {
+    if (data == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_insert error: provided data is NULL.");
+        return -1;
+    }
+
+    cow_op op;
+    if (write_begin(bbst, &op, "BBST_insert") != 0) {
+        return -1;
+    }
+
+    BBST_Sync *s = bbst->sync;
+    node_t *node = s->spare[--s->n_spare];
+    memcpy(node->data, data, bbst->stride);
+    node->left   = NULL;
+    node->right  = NULL;
+    node->height = 1;
+    node->gen    = op.gen;
+
+    write_end(bbst, &op, cow_insert(&op, bbst->root, node), bbst->size + 1);
+    return 0;
+}
+
+int bbst_sync_remove(BBST *bbst, void *data) {
+    cow_op op;
+    if (write_begin(bbst, &op, "BBST_remove") != 0) {
+        return -1;
+    }
+
+    int removed = 0;
+    node_t *root = cow_remove(&op, bbst->root, data, &removed);
+    if (!removed) {
+        // Nothing to remove: give the unpublished copies back.
+        BBST_Sync *s = bbst->sync;
+        s->n_spare = op.n_spare;
+        pthread_mutex_unlock(&s->write_lock);
+        return 0;
+    }
+
+    write_end(bbst, &op, root, bbst->size - 1);
+    return 0;
+}
+
+void *bbst_sync_pop(BBST *bbst) {
+    void *result = malloc(bbst->stride);
+    if (result == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "BBST_pop error: memory allocation for result failed.");
+        return NULL;
+    }
+
+    cow_op op;
+    if (write_begin(bbst, &op, "BBST_pop") != 0) {
+        free(result);
+        return NULL;
+    }
+    if (bbst->root == NULL) {
+        pthread_mutex_unlock(&bbst->sync->write_lock);
+        free(result);
+        return NULL;
+    }
+
+    node_t *min;
+    node_t *root = cow_remove_min(&op, bbst->root, &min);
+    memcpy(result, min->data, bbst->stride);
+    op.old[op.n_old++] = min;
+    write_end(bbst, &op, root, bbst->size - 1);
+
+    return result;
+}
+
+/**
+* `bbst_sync_free` frees the state of the concurrent mode, including all
+* retired and spare nodes. Called by `BBST_free`.
+*/
+void bbst_sync_free(BBST *bbst) {
+    BBST_Sync *s = bbst->sync;
+    CLIB_Allocator *a = &bbst->allocator;
+    for (int e = 0; e < 2; e++) {
+        for (size_t i = 0; i < s->n_retired[e]; i++) {
+            node_release(bbst, s->retired[e][i]);
+        }
+        a->free(a->ctx, s->retired[e], s->cap_retired[e] * sizeof(node_t *));
+    }
+    while (s->n_spare > 0) {
+        a->free(a->ctx, s->spare[--s->n_spare], sizeof(node_t) + bbst->stride);
+    }
+    pthread_mutex_destroy(&s->write_lock);
+    a->free(a->ctx, s, sizeof(BBST_Sync));
+    bbst->sync = NULL;
+}
+
+/**
+* `BBST_make_concurrent` switches `bbst` to concurrent mode, in which
+* lookups and iterators may run on any number of threads while other
+* threads insert and remove elements. Writers are serialized by a lock;
+* readers never wait for them, but have to call `BBST_read_lock` and
+* `BBST_read_unlock` around every access. Must be called before the
+* tree is shared; `BBST_free` requires all threads to be done.
+* Returns 0 on success, -1 otherwise.
+*/
+int BBST_make_concurrent(BBST *bbst) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_make_concurrent error: provided BBST is NULL.");
+        return -1;
+    }
+    if (bbst->sync != NULL) {
+        return 0;
+    }
+
+    CLIB_Allocator *a = &bbst->allocator;
+    BBST_Sync *s = (BBST_Sync *) a->alloc(a->ctx, sizeof(BBST_Sync));
+    if (s == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "BBST_make_concurrent error: failed to allocate memory.");
+        return -1;
+    }
+    memset(s, 0, sizeof(BBST_Sync));
+    for (int i = 0; i < SYNC_SLOTS; i++) {
+        atomic_init(&s->slots[i].readers[0], 0);
+        atomic_init(&s->slots[i].readers[1], 0);
+    }
+    atomic_init(&s->epoch, 0);
+    if (pthread_mutex_init(&s->write_lock, NULL) != 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "BBST_make_concurrent error: failed to create the write lock.");
+        a->free(a->ctx, s, sizeof(BBST_Sync));
+        return -1;
+    }
+
+    bbst->sync = s;
+    return 0;
+}
+
+/**
+* `BBST_read_lock` starts a read-side critical section on `bbst` for the
+* calling thread and returns a token for `BBST_read_unlock`. Until then
+* the nodes the thread can reach are not freed, and lookups and
+* iterators see the tree as it was when they loaded its root. Never
+* blocks. Sections should be short, since they delay reclamation.
+* For trees not in concurrent mode this does nothing.
+* Returns -1 on failure.
+*/
+int BBST_read_lock(BBST *bbst) {
+    if (bbst == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_read_lock error: provided BBST is NULL.");
+        return -1;
+    }
+    BBST_Sync *s = bbst->sync;
+    if (s == NULL) {
+        return 0;
+    }
+
+    if (thread_slot == 0) {
+        thread_slot = atomic_fetch_add(&next_slot, 1) % SYNC_SLOTS + 1;
+    }
+    int slot = thread_slot - 1;
+    int parity = atomic_load(&s->epoch) & 1;
+    atomic_fetch_add(&s->slots[slot].readers[parity], 1);
+
+    return 2 * slot + parity;
+}
+
+/**
+* `BBST_read_unlock` ends the read-side critical section `token` was
+* returned for. Pointers into the tree must not be used afterwards.
+*/
+void BBST_read_unlock(BBST *bbst, int token) {
+    if (bbst == NULL || bbst->sync == NULL || token < 0) {
+        return;
+    }
+    atomic_fetch_sub(&bbst->sync->slots[token / 2].readers[token % 2], 1);
+}
+
+/**
+* `BBST_synchronize` waits until all readers that might still see
+* removed elements are done, and frees the nodes retired so far. Must
+* not be called from within a read-side critical section.
+* Returns 0 on success, -1 otherwise.
+*/
+int BBST_synchronize(BBST *bbst) {
+    if (bbst == NULL || bbst->sync == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BBST_synchronize error: provided BBST is NULL or not concurrent.");
+        return -1;
+    }
+
+    BBST_Sync *s = bbst->sync;
+    pthread_mutex_lock(&s->write_lock);
+    while (s->n_retired[0] > 0 || s->n_retired[1] > 0) {
+        if (!try_advance(bbst)) {
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&s->write_lock);
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bbst.h"
+#include "dynlist.h"
+#include "clib_bench.h"
+
+/*
+* Microbenchmarks of BBST on long keys. Every insert benchmark also
+* checks the resulting tree height against the AVL bound
+* 1.44 log2(n + 2) and complains on stderr if it is exceeded.
+* The priority queue benchmark is also run on a DL_Heap for comparison.
+* Usage: ./bench [--max-n N] [--format table|csv|json] [--filter S]
+*/
+
+int compare_longs(void *a, void *b) {
+    long x = *(long *)a;
+    long y = *(long *)b;
+    return (x > y) - (x < y);
+}
+
+static long *keys(CLIB_Bench *b, size_t n, int random) {
+    long *k = malloc(n * sizeof(long));
+    if (k == NULL) {
+        fprintf(stderr, "Allocation of keys failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < n; i++) {
+        k[i] = random ? (long) (clib_bench_rand(b) >> 1) : (long) i;
+    }
+    return k;
+}
+
+static BBST *create(CLIB_Bench *b) {
+    BBST *t = BBST_create_with_allocator(sizeof(long), compare_longs, &b->allocator);
+    if (t == NULL) {
+        fprintf(stderr, "BBST_create failed: %s\n", clib_strerror(clib_last_error()));
+        exit(EXIT_FAILURE);
+    }
+    return t;
+}
+
+static BBST *filled(CLIB_Bench *b, long *k, size_t n) {
+    BBST *t = create(b);
+    for (size_t i = 0; i < n; i++) {
+        BBST_insert(t, &k[i]);
+    }
+    return t;
+}
+
+static void check_height(BBST *t, size_t n) {
+    if (BBST_height(t) > 1.44 * log2(n + 2)) {
+        fprintf(stderr, "height %d of %zu nodes exceeds the AVL bound\n", BBST_height(t), n);
+    }
+}
+
+static void run_insert(CLIB_Bench *b, size_t n, int random) {
+    long *k = keys(b, n, random);
+    BBST *t = create(b);
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        BBST_insert(t, &k[i]);
+    }
+    clib_bench_stop(b, n);
+    check_height(t, n);
+    BBST_free(t);
+    free(k);
+}
+
+static void bench_insert_sorted(CLIB_Bench *b, size_t n) {
+    run_insert(b, n, 0);
+}
+
+static void bench_insert_random(CLIB_Bench *b, size_t n) {
+    run_insert(b, n, 1);
+}
+
+static void bench_from_sorted(CLIB_Bench *b, size_t n) {
+    DynList *dl = DL_create_with_allocator(n, sizeof(long), compare_longs, &b->allocator);
+    if (dl == NULL) {
+        fprintf(stderr, "DL_create failed: %s\n", clib_strerror(clib_last_error()));
+        exit(EXIT_FAILURE);
+    }
+    for (long i = 0; i < (long) n; i++) {
+        DL_append(dl, &i);
+    }
+    clib_bench_start(b);
+    BBST *t = BBST_from_sorted(dl);
+    clib_bench_stop(b, n);
+    check_height(t, n);
+    BBST_free(t);
+    DL_free(dl);
+}
+
+static void bench_to_dynlist(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BBST *t = filled(b, k, n);
+    clib_bench_start(b);
+    DynList *dl = BBST_to_dynlist(t);
+    clib_bench_stop(b, n);
+    DL_free(dl);
+    BBST_free(t);
+    free(k);
+}
+
+static void bench_lookup_random(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BBST *t = filled(b, k, n);
+    long found = 0;
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        found += BBST_contains(t, &k[i]);
+    }
+    clib_bench_stop(b, n);
+    if (found != (long) n) {
+        fprintf(stderr, "Lookup failed: found %ld of %zu keys.\n", found, n);
+    }
+    BBST_free(t);
+    free(k);
+}
+
+typedef struct {
+    BBST   *t;
+    long   *k;
+    size_t lo, hi;
+    long   found;
+} reader_arg;
+
+static void *reader(void *arg) {
+    reader_arg *r = (reader_arg *) arg;
+    for (size_t i = r->lo; i < r->hi; i++) {
+        int token = BBST_read_lock(r->t);
+        r->found += BBST_contains(r->t, &r->k[i]);
+        BBST_read_unlock(r->t, token);
+    }
+    return NULL;
+}
+
+/*
+* 95% lookups on one reader thread per CPU, 5% updates (a remove and an
+* insert of the same key) on the calling thread, in concurrent mode.
+*/
+static void bench_mixed_concurrent(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BBST *t = create(b);
+    for (size_t i = 0; i < n; i++) {
+        BBST_insert(t, &k[i]);
+    }
+    BBST_make_concurrent(t);
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nreaders = ncpu < 1 ? 1 : ncpu > 64 ? 64 : (int) ncpu;
+    size_t nreads = n - n / 20;
+    pthread_t threads[64];
+    reader_arg args[64];
+
+    clib_bench_start(b);
+    for (int i = 0; i < nreaders; i++) {
+        args[i] = (reader_arg) { t, k, nreads * i / nreaders, nreads * (i + 1) / nreaders, 0 };
+        pthread_create(&threads[i], NULL, reader, &args[i]);
+    }
+    for (size_t i = nreads; i < n; i++) {
+        BBST_remove(t, &k[i]);
+        BBST_insert(t, &k[i]);
+    }
+    long found = 0;
+    for (int i = 0; i < nreaders; i++) {
+        pthread_join(threads[i], NULL);
+        found += args[i].found;
+    }
+    clib_bench_stop(b, n);
+
+    if (found != (long) nreads) {
+        fprintf(stderr, "Lookup failed: found %ld of %zu keys.\n", found, nreads);
+    }
+    BBST_free(t);
+    free(k);
+}
+
+static void bench_iterate(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BBST *t = filled(b, k, n);
+    BBST_iter it;
+    long sum = 0;
+    clib_bench_start(b);
+    BBST_iter_begin(t, &it);
+    for (long *p = BBST_iter_get(&it); p != NULL; p = BBST_iter_next(&it)) {
+        sum += *p;
+    }
+    clib_bench_stop(b, n);
+    volatile long s = sum;
+    (void) s;
+    BBST_free(t);
+    free(k);
+}
+
+static void bench_remove_random(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BBST *t = filled(b, k, n);
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        BBST_remove(t, &k[i]);
+    }
+    clib_bench_stop(b, n);
+    BBST_free(t);
+    free(k);
+}
+
+// Priority queue of n elements (the hold model of event schedulers):
+// every step pops the smallest element and pushes a later one.
+static void bench_priority_queue(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BBST *t = filled(b, k, n);
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        long *top = BBST_pop(t);
+        long next = *top + (long) (clib_bench_rand(b) & 0xFFFFFFFF);
+        free(top);
+        BBST_insert(t, &next);
+    }
+    clib_bench_stop(b, n);
+    BBST_free(t);
+    free(k);
+}
+
+static void bench_priority_queue_heap(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    DL_Heap *h = DL_heap_create_with_allocator(n, sizeof(long), compare_longs, DL_HEAP_4ARY, &b->allocator);
+    for (size_t i = 0; i < n; i++) {
+        DL_heap_push(h, &k[i], NULL);
+    }
+    long top;
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        DL_heap_pop(h, &top);
+        top += (long) (clib_bench_rand(b) & 0xFFFFFFFF);
+        DL_heap_push(h, &top, NULL);
+    }
+    clib_bench_stop(b, n);
+    DL_heap_free(h);
+    free(k);
+}
+
+int main(int argc, char **argv) {
+    static const struct {
+        const char *name;
+        void (*fn)(CLIB_Bench *b, size_t n);
+    } benchmarks[] = {
+        { "insert_sorted", bench_insert_sorted },
+        { "insert_random", bench_insert_random },
+        { "from_sorted",   bench_from_sorted },
+        { "to_dynlist",    bench_to_dynlist },
+        { "lookup_random", bench_lookup_random },
+        { "mixed_concurrent", bench_mixed_concurrent },
+        { "iterate",       bench_iterate },
+        { "remove_random", bench_remove_random },
+        { "priority_queue", bench_priority_queue },
+        { "priority_queue_heap", bench_priority_queue_heap },
+    };
+
+    CLIB_Bench b;
+    clib_bench_init(&b, "BBST", argc, argv);
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        for (size_t n = 1000; n <= b.max_n; n *= 10) {
+            clib_bench_run(&b, benchmarks[i].name, n, benchmarks[i].fn);
+        }
+    }
+    clib_bench_finish(&b);
+
+    return EXIT_SUCCESS;
+}
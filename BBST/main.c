@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "bbst.h"
+#include "clib_serial.h"
 
 typedef struct {
     size_t id;
@@ -21,6 +23,91 @@ void print_person(person_t *p) {
     printf("----------------------------\n");
 }
 
+// Counts the blocks and bytes allocated through it that are not freed
+// yet. A free or realloc passing a wrong size leaves `bytes` off zero.
+typedef struct {
+    long blocks;
+    long bytes;
+} counting_t;
+
+void *counting_alloc(void *ctx, size_t size) {
+    counting_t *c = (counting_t *) ctx;
+    void *p = malloc(size);
+    c->blocks += p != NULL;
+    c->bytes += p != NULL ? (long) size : 0;
+    return p;
+}
+
+void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    counting_t *c = (counting_t *) ctx;
+    void *p = realloc(ptr, new_size);
+    if (p != NULL) {
+        c->blocks += ptr == NULL;
+        c->bytes += (long) new_size - (long) old_size;
+    }
+    return p;
+}
+
+void counting_free(void *ctx, void *ptr, size_t size) {
+    counting_t *c = (counting_t *) ctx;
+    if (ptr != NULL) {
+        c->blocks--;
+        c->bytes -= (long) size;
+    }
+    free(ptr);
+}
+
+// Builds, changes and frees trees through a counting allocator.
+int allocator_balanced(void) {
+    counting_t c = { 0, 0 };
+    CLIB_Allocator a = { counting_alloc, counting_realloc, counting_free, &c };
+
+    BBST *t = BBST_create_with_allocator(sizeof(person_t), compare_people, &a);
+    for (size_t i = 0; i < 2000; i++) {
+        person_t p = { .id = i * 7919 % 2000 };
+        BBST_insert(t, &p);
+    }
+    for (size_t i = 0; i < 2000; i += 2) {
+        person_t p = { .id = i };
+        BBST_remove(t, &p);
+    }
+    DynList *dl = BBST_to_dynlist(t);
+    BBST *slab = BBST_from_sorted(dl);
+    for (size_t i = 0; i < 500; i++) {
+        person_t p = { .id = i };
+        BBST_remove(slab, &p);
+        BBST_insert(slab, &p);
+    }
+
+    // Concurrent mode copies paths and frees the old nodes later.
+    BBST_make_concurrent(t);
+    for (size_t i = 0; i < 2000; i++) {
+        person_t p = { .id = i };
+        if (i % 2 == 0) {
+            BBST_insert(t, &p);
+        } else {
+            BBST_remove(t, &p);
+        }
+    }
+    BBST_synchronize(t);
+
+    BBST_free(slab);
+    DL_free(dl);
+    BBST_free(t);
+    printf("allocator: %ld blocks, %ld bytes left\n", c.blocks, c.bytes);
+    return c.blocks == 0 && c.bytes == 0;
+}
+
+// Reads a tree back from `len` bytes of `buf`; `err` is the last error.
+BBST *deserialize(char *buf, size_t len, int *err) {
+    FILE *f = fmemopen(buf, len, "r");
+    clib_clear_error();
+    BBST *t = BBST_deserialize(f, compare_people);
+    *err = clib_last_error();
+    fclose(f);
+    return t;
+}
+
 int main() {
 
     printf("----- BBST -----\n\n");
@@ -53,10 +140,85 @@ int main() {
     BBST_insert(t, &p1);
     BBST_insert(t, &p2);
 
-    print_person(t->root->data);
-    print_person(t->root->right->data);
-    print_person(t->root->right->left->data);
-    print_person(t->root->right->right->data);
+    printf("size = %ld, height = %d\n", BBST_size(t), BBST_height(t));
+    printf("contains p1: %d\n", BBST_contains(t, &p1));
+    printf("count of p1: %ld\n", BBST_count(t, &p1));
+
+    printf("top:\n");
+    print_person((person_t *) BBST_top(t));
+
+    BBST_remove(t, &p1);
+    printf("count of p1 after removing it once: %ld\n", BBST_count(t, &p1));
+
+    printf("popping all elements:\n");
+    while (BBST_is_empty(t) == 1) {
+        person_t *p = (person_t *) BBST_pop(t);
+        print_person(p);
+        free(p);
+    }
+
+    // Sorted input keeps the tree balanced.
+    for (size_t i = 0; i < 1000; i++) {
+        person_t p = { .id = i, .age = 0, .height = 0 };
+        BBST_insert(t, &p);
+    }
+    printf("size = %ld, height = %d after inserting 1000 sorted elements\n",
+           BBST_size(t), BBST_height(t));
+
+    // Range scan over [10, 15), then walk backwards from the last element.
+    person_t lo = { .id = 10 }, hi = { .id = 15 };
+    BBST_iter it;
+    printf("ids in [10, 15):");
+    BBST_iter_range(t, &it, &lo, &hi);
+    for (person_t *p = BBST_iter_get(&it); p != NULL; p = BBST_iter_next(&it)) {
+        printf(" %zu", p->id);
+    }
+    printf("\nlargest ids:");
+    BBST_iter_last(t, &it);
+    for (int i = 0; i < 3; i++, BBST_iter_prev(&it)) {
+        printf(" %zu", ((person_t *) BBST_iter_get(&it))->id);
+    }
+    printf("\n");
+
+    // Flatten the tree into a sorted DynList and rebuild it in O(n).
+    DynList *dl = BBST_to_dynlist(t);
+    BBST *copy = BBST_from_sorted(dl);
+    printf("rebuilt from DynList: size = %ld, height = %d\n", BBST_size(copy), BBST_height(copy));
+    BBST_free(copy);
+    DL_free(dl);
+
+    // Serialize and read back, then corrupt the serialized tree.
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&buf, &len);
+    int rc = BBST_serialize(t, f);
+    fclose(f);
+    int err;
+    copy = rc == 0 ? deserialize(buf, len, &err) : NULL;
+    printf("read back: size = %ld\n", copy != NULL ? BBST_size(copy) : -1);
+    int ok = copy != NULL && BBST_size(copy) == BBST_size(t);
+    BBST_free(copy);
+
+    // Truncated, a flipped byte, a bad magic and a forged count.
+    ok = ok && deserialize(buf, len - 1, &err) == NULL && err == CLIB_EFORMAT;
+    buf[len / 2] ^= 0x10;
+    ok = ok && deserialize(buf, len, &err) == NULL && err == CLIB_EFORMAT;
+    buf[len / 2] ^= 0x10;
+    buf[0] ^= 1;
+    ok = ok && deserialize(buf, len, &err) == NULL && err == CLIB_EFORMAT;
+    buf[0] ^= 1;
+    CLIB_SerialHeader h;
+    memcpy(&h, buf, sizeof(h));
+    h.count = (uint64_t) 1 << 40;
+    memcpy(buf, &h, sizeof(h));
+    ok = ok && deserialize(buf, len, &err) == NULL && err == CLIB_EFORMAT;
+    free(buf);
+    printf("corrupted input rejected: %d\n", ok);
+    ok = ok && allocator_balanced();
+    if (!ok) {
+        BBST_free(t);
+        return EXIT_FAILURE;
+    }
 
     BBST_free(t);
     printf("BBST freed successfully.\n");
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "bbst.h"
+
+/*
+* Stress test of the concurrent mode: one writer inserts and removes the
+* odd keys while reader threads look up the even keys, which are never
+* removed, iterate the tree and take copies of it with BBST_to_dynlist
+* and BBST_serialize. Every snapshot has to be sorted and hold all even
+* keys. Built with sanitizers by `make stresstest`.
+* Usage: ./stresstest [readers] [writes]
+*/
+
+#define KEYS 2000
+
+static atomic_int done;
+static atomic_long failures;
+
+static int compare_longs(void *a, void *b) {
+    long x = *(long *)a;
+    long y = *(long *)b;
+    return (x > y) - (x < y);
+}
+
+static void fail(const char *what) {
+    if (atomic_fetch_add(&failures, 1) < 10) {
+        fprintf(stderr, "FAILED: %s\n", what);
+    }
+}
+
+// Checks that `n` keys are in order and include every even key.
+static void check_snapshot(long *keys, size_t n, const char *what) {
+    size_t evens = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && keys[i - 1] >= keys[i]) {
+            fail(what);
+            return;
+        }
+        evens += keys[i] % 2 == 0;
+    }
+    if (evens != KEYS / 2) {
+        fail(what);
+    }
+}
+
+static void *reader(void *arg) {
+    BBST *t = (BBST *) arg;
+    unsigned seed = 1;
+    long *keys = malloc(KEYS * sizeof(long));
+    if (keys == NULL) {
+        fail("allocation");
+        return NULL;
+    }
+
+    for (long round = 0; !atomic_load(&done); round++) {
+        int token = BBST_read_lock(t);
+
+        // Lookups of keys that are always present.
+        for (int i = 0; i < 64; i++) {
+            long k = 2 * (rand_r(&seed) % (KEYS / 2));
+            if (!BBST_contains(t, &k)) {
+                fail("BBST_contains of a permanent key");
+            }
+        }
+
+        // A full iteration of one version of the tree.
+        BBST_iter it;
+        size_t n = 0;
+        BBST_iter_begin(t, &it);
+        for (long *e = BBST_iter_get(&it); e != NULL && n < KEYS; e = BBST_iter_next(&it)) {
+            keys[n++] = *e;
+        }
+        check_snapshot(keys, n, "iteration");
+
+        BBST_read_unlock(t, token);
+
+        // Copies, which take their own snapshot.
+        if (round % 4 == 0) {
+            DynList *dl = BBST_to_dynlist(t);
+            if (dl == NULL || dl->size > KEYS) {
+                fail("BBST_to_dynlist");
+            } else {
+                check_snapshot((long *) dl->data, dl->size, "BBST_to_dynlist");
+            }
+            DL_free(dl);
+        }
+        if (round % 16 == 0) {
+            char *buf = NULL;
+            size_t len = 0;
+            FILE *f = open_memstream(&buf, &len);
+            int rc = BBST_serialize(t, f);
+            fclose(f);
+            f = fmemopen(buf, len, "r");
+            BBST *copy = rc == 0 ? BBST_deserialize(f, compare_longs) : NULL;
+            if (copy == NULL) {
+                fail("BBST_serialize round trip");
+            } else {
+                DynList *dl = BBST_to_dynlist(copy);
+                check_snapshot((long *) dl->data, dl->size, "BBST_serialize");
+                DL_free(dl);
+                BBST_free(copy);
+            }
+            fclose(f);
+            free(buf);
+        }
+    }
+
+    free(keys);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int readers = argc > 1 ? atoi(argv[1]) : 4;
+    long writes = argc > 2 ? atol(argv[2]) : 200000;
+
+    BBST *t = BBST_create(sizeof(long), compare_longs);
+    for (long k = 0; k < KEYS; k += 2) {
+        BBST_insert(t, &k);
+    }
+    if (t == NULL || BBST_make_concurrent(t) != 0) {
+        fprintf(stderr, "Setup failed: %s\n", clib_strerror(clib_last_error()));
+        return EXIT_FAILURE;
+    }
+
+    pthread_t threads[64];
+    readers = readers < 1 ? 1 : readers > 64 ? 64 : readers;
+    for (int i = 0; i < readers; i++) {
+        pthread_create(&threads[i], NULL, reader, t);
+    }
+
+    unsigned seed = 2;
+    for (long i = 0; i < writes; i++) {
+        long k = 2 * (rand_r(&seed) % (KEYS / 2)) + 1;
+        // The tree keeps duplicates, so only absent keys are inserted.
+        int token = BBST_read_lock(t);
+        int present = BBST_contains(t, &k);
+        BBST_read_unlock(t, token);
+        if (!present) {
+            BBST_insert(t, &k);
+        } else {
+            BBST_remove(t, &k);
+        }
+    }
+    atomic_store(&done, 1);
+    for (int i = 0; i < readers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    long odd = 0;
+    for (long k = 1; k < KEYS; k += 2) {
+        odd += BBST_contains(t, &k);
+    }
+    if (BBST_size(t) != KEYS / 2 + odd) {
+        fail("final size");
+    }
+    BBST_free(t);
+
+    if (atomic_load(&failures) > 0) {
+        fprintf(stderr, "%ld failures\n", atomic_load(&failures));
+        return EXIT_FAILURE;
+    }
+    printf("stresstest: %d readers, %ld writes: OK\n", readers, writes);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "btree.h"
+#include "bbst.h"
+#include "clib_bench.h"
+
+/*
+* Microbenchmarks of BTree on long keys, with lookups in a BBST of the
+* same keys for comparison.
+* Usage: ./bench [--max-n N] [--format table|csv|json] [--filter S]
+*/
+
+int compare_longs(void *a, void *b) {
+    long x = *(long *)a;
+    long y = *(long *)b;
+    return (x > y) - (x < y);
+}
+
+static long *keys(CLIB_Bench *b, size_t n, int random) {
+    long *k = malloc(n * sizeof(long));
+    if (k == NULL) {
+        fprintf(stderr, "Allocation of keys failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < n; i++) {
+        k[i] = random ? (long) (clib_bench_rand(b) >> 1) : (long) i;
+    }
+    return k;
+}
+
+static BTree *create(CLIB_Bench *b) {
+    BTree *t = BTree_create_with_allocator(sizeof(long), compare_longs, &b->allocator);
+    if (t == NULL) {
+        fprintf(stderr, "BTree_create failed: %s\n", clib_strerror(clib_last_error()));
+        exit(EXIT_FAILURE);
+    }
+    return t;
+}
+
+static BTree *filled(CLIB_Bench *b, long *k, size_t n) {
+    BTree *t = create(b);
+    for (size_t i = 0; i < n; i++) {
+        BTree_insert(t, &k[i]);
+    }
+    return t;
+}
+
+static void run_insert(CLIB_Bench *b, size_t n, int random) {
+    long *k = keys(b, n, random);
+    BTree *t = create(b);
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        BTree_insert(t, &k[i]);
+    }
+    clib_bench_stop(b, n);
+    BTree_free(t);
+    free(k);
+}
+
+static void bench_insert_sorted(CLIB_Bench *b, size_t n) {
+    run_insert(b, n, 0);
+}
+
+static void bench_insert_random(CLIB_Bench *b, size_t n) {
+    run_insert(b, n, 1);
+}
+
+static void bench_lookup_random(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BTree *t = filled(b, k, n);
+    long found = 0;
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        found += BTree_contains(t, &k[i]);
+    }
+    clib_bench_stop(b, n);
+    if (found != (long) n) {
+        fprintf(stderr, "Lookup failed: found %ld of %zu keys.\n", found, n);
+    }
+    BTree_free(t);
+    free(k);
+}
+
+static void bench_bbst_lookup_random(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BBST *t = BBST_create_with_allocator(sizeof(long), compare_longs, &b->allocator);
+    for (size_t i = 0; i < n; i++) {
+        BBST_insert(t, &k[i]);
+    }
+    long found = 0;
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        found += BBST_contains(t, &k[i]);
+    }
+    clib_bench_stop(b, n);
+    if (found != (long) n) {
+        fprintf(stderr, "Lookup failed: found %ld of %zu keys.\n", found, n);
+    }
+    BBST_free(t);
+    free(k);
+}
+
+static void bench_iterate(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BTree *t = filled(b, k, n);
+    BTree_iter it;
+    long sum = 0;
+    clib_bench_start(b);
+    BTree_iter_begin(t, &it);
+    for (long *p = BTree_iter_get(&it); p != NULL; p = BTree_iter_next(&it)) {
+        sum += *p;
+    }
+    clib_bench_stop(b, n);
+    volatile long s = sum;
+    (void) s;
+    BTree_free(t);
+    free(k);
+}
+
+static void bench_remove_random(CLIB_Bench *b, size_t n) {
+    long *k = keys(b, n, 1);
+    BTree *t = filled(b, k, n);
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        BTree_remove(t, &k[i]);
+    }
+    clib_bench_stop(b, n);
+    BTree_free(t);
+    free(k);
+}
+
+int main(int argc, char **argv) {
+    static const struct {
+        const char *name;
+        void (*fn)(CLIB_Bench *b, size_t n);
+    } benchmarks[] = {
+        { "insert_sorted",      bench_insert_sorted },
+        { "insert_random",      bench_insert_random },
+        { "lookup_random",      bench_lookup_random },
+        { "bbst_lookup_random", bench_bbst_lookup_random },
+        { "iterate",            bench_iterate },
+        { "remove_random",      bench_remove_random },
+    };
+
+    CLIB_Bench b;
+    clib_bench_init(&b, "BTree", argc, argv);
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        for (size_t n = 1000; n <= b.max_n; n *= 10) {
+            clib_bench_run(&b, benchmarks[i].name, n, benchmarks[i].fn);
+        }
+    }
+    clib_bench_finish(&b);
+
+    return EXIT_SUCCESS;
+}
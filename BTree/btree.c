@@ -0,0 +1,779 @@
+#include "btree.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+* A B+ tree: leaves hold the elements, inner nodes hold separators that
+* guide the search. For the separator `s` between two children, every
+* element of the left subtree is <= `s` and every element of the right
+* one is >= `s`. With duplicates, equal elements may therefore end up
+* on both sides of a separator; lookups descend towards the first
+* candidate and continue into the following leaves.
+* Keys are stored contiguously inside a node, so a binary search over
+* a node touches only a few cache lines and a lookup costs one node
+* per level instead of one per comparison.
+*/
+
+#if BTREE_NODE_SIZE < 64
+#error "BTREE_NODE_SIZE must be at least 64 bytes"
+#endif
+
+static inline char *key_at(BTree *bt, BTree_node *n, size_t i) {
+    return n->keys + i * bt->stride;
+}
+
+static inline BTree_node **children(BTree *bt, BTree_node *n) {
+    return (BTree_node **) (n->keys + bt->children_offset);
+}
+
+/**
+* `min_count` is the number of keys below which a node other than the
+* root is rebalanced.
+*/
+static inline size_t min_count(BTree *bt, BTree_node *n) {
+    return n->leaf ? bt->leaf_capacity / 2 : (bt->inner_capacity - 1) / 2;
+}
+
+/**
+* `node_bound` returns the number of keys of `n` smaller than `key`, or
+* with `upper` set the number of keys not larger than `key`. In inner
+* nodes this is the index of the child to descend into.
+*/
+static size_t node_bound(BTree *bt, BTree_node *n, void *key, int upper) {
+    // The probes of the binary search depend on each other. Requesting
+    // all cache lines of the keys up front overlaps their misses.
+    const char *end = n->keys + n->count * bt->stride;
+    for (const char *p = n->keys; p < end; p += 64) {
+        __builtin_prefetch(p);
+    }
+
+    size_t lo = 0, hi = n->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = bt->compare_to(key_at(bt, n, mid), key);
+        if (cmp < 0 || (upper && cmp == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static BTree_node *node_alloc(BTree *bt, int leaf) {
+    CLIB_Allocator *a = &bt->allocator;
+    BTree_node *n = (BTree_node *) a->alloc(a->ctx, leaf ? bt->leaf_bytes : bt->inner_bytes);
+    if (n == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "BTree failed to allocate memory for a node.");
+        return NULL;
+    }
+    n->count = 0;
+    n->leaf  = leaf;
+    return n;
+}
+
+static void node_dealloc(BTree *bt, BTree_node *n) {
+    bt->allocator.free(bt->allocator.ctx, n, n->leaf ? bt->leaf_bytes : bt->inner_bytes);
+}
+
+/**
+* `node_free_all` frees the subtree rooted at `n`. The recursion is
+* only as deep as the tree.
+*/
+static void node_free_all(BTree *bt, BTree_node *n) {
+    if (!n->leaf) {
+        for (size_t i = 0; i <= n->count; i++) {
+            node_free_all(bt, children(bt, n)[i]);
+        }
+    }
+    node_dealloc(bt, n);
+}
+
+static void leaf_insert_at(BTree *bt, BTree_node *n, size_t i, void *data) {
+    memmove(key_at(bt, n, i + 1), key_at(bt, n, i), (n->count - i) * bt->stride);
+    memcpy(key_at(bt, n, i), data, bt->stride);
+    n->count++;
+}
+
+/**
+* `inner_insert_at` inserts the separator `sep` at index `i` of the inner
+* node `n`, with `child` as the child to its right.
+*/
+static void inner_insert_at(BTree *bt, BTree_node *n, size_t i, void *sep, BTree_node *child) {
+    BTree_node **c = children(bt, n);
+    memmove(key_at(bt, n, i + 1), key_at(bt, n, i), (n->count - i) * bt->stride);
+    memmove(c + i + 2, c + i + 1, (n->count - i) * sizeof(BTree_node *));
+    memcpy(key_at(bt, n, i), sep, bt->stride);
+    c[i + 1] = child;
+    n->count++;
+}
+
+/**
+* `inner_split_insert` moves the upper half of the full inner node `n`
+* to the empty node `r`, copies the separator between both halves to
+* `up` and then inserts `sep` and `child` at index `i` of the combined
+* node. `up` and `sep` must not overlap.
+*/
+static void inner_split_insert(BTree *bt, BTree_node *n, BTree_node *r, size_t i,
+                               void *sep, BTree_node *child, void *up) {
+    size_t mid = n->count / 2;
+    memcpy(up, key_at(bt, n, mid), bt->stride);
+    r->count = n->count - mid - 1;
+    memcpy(r->keys, key_at(bt, n, mid + 1), r->count * bt->stride);
+    memcpy(children(bt, r), children(bt, n) + mid + 1, (r->count + 1) * sizeof(BTree_node *));
+    n->count = mid;
+
+    if (i <= mid) {
+        inner_insert_at(bt, n, i, sep, child);
+    } else {
+        inner_insert_at(bt, r, i - mid - 1, sep, child);
+    }
+}
+
+/**
+* `borrow_left` moves the last key of `l`, the left sibling of the
+* `ci`-th child `n` of `p`, to the front of `n`.
+*/
+static void borrow_left(BTree *bt, BTree_node *p, size_t ci, BTree_node *l, BTree_node *n) {
+    size_t stride = bt->stride;
+    memmove(key_at(bt, n, 1), n->keys, n->count * stride);
+    if (n->leaf) {
+        memcpy(n->keys, key_at(bt, l, l->count - 1), stride);
+        memcpy(key_at(bt, p, ci - 1), n->keys, stride);
+    } else {
+        BTree_node **c = children(bt, n);
+        memmove(c + 1, c, (n->count + 1) * sizeof(BTree_node *));
+        c[0] = children(bt, l)[l->count];
+        memcpy(n->keys, key_at(bt, p, ci - 1), stride);
+        memcpy(key_at(bt, p, ci - 1), key_at(bt, l, l->count - 1), stride);
+    }
+    l->count--;
+    n->count++;
+}
+
+/**
+* `borrow_right` moves the first key of `r`, the right sibling of the
+* `ci`-th child `n` of `p`, to the end of `n`.
+*/
+static void borrow_right(BTree *bt, BTree_node *p, size_t ci, BTree_node *n, BTree_node *r) {
+    size_t stride = bt->stride;
+    if (n->leaf) {
+        memcpy(key_at(bt, n, n->count), r->keys, stride);
+        memmove(r->keys, key_at(bt, r, 1), (r->count - 1) * stride);
+        memcpy(key_at(bt, p, ci), r->keys, stride);
+    } else {
+        BTree_node **c = children(bt, r);
+        memcpy(key_at(bt, n, n->count), key_at(bt, p, ci), stride);
+        children(bt, n)[n->count + 1] = c[0];
+        memcpy(key_at(bt, p, ci), r->keys, stride);
+        memmove(r->keys, key_at(bt, r, 1), (r->count - 1) * stride);
+        memmove(c, c + 1, r->count * sizeof(BTree_node *));
+    }
+    n->count++;
+    r->count--;
+}
+
+/**
+* `merge` appends the child `r` of `p` to its left sibling `l`, removes
+* the separator `si` between both from `p` and frees `r`.
+*/
+static void merge(BTree *bt, BTree_node *p, size_t si, BTree_node *l, BTree_node *r) {
+    size_t stride = bt->stride;
+    if (l->leaf) {
+        memcpy(key_at(bt, l, l->count), r->keys, r->count * stride);
+        l->count += r->count;
+    } else {
+        memcpy(key_at(bt, l, l->count), key_at(bt, p, si), stride);
+        memcpy(key_at(bt, l, l->count + 1), r->keys, r->count * stride);
+        memcpy(children(bt, l) + l->count + 1, children(bt, r), (r->count + 1) * sizeof(BTree_node *));
+        l->count += r->count + 1;
+    }
+
+    BTree_node **c = children(bt, p);
+    memmove(key_at(bt, p, si), key_at(bt, p, si + 1), (p->count - si - 1) * stride);
+    memmove(c + si + 1, c + si + 2, (p->count - si - 1) * sizeof(BTree_node *));
+    p->count--;
+
+    node_dealloc(bt, r);
+}
+
+/**
+* `delete_at` removes the element an iterator with `path`, `pos` and
+* `depth` points at, and rebalances the tree along the path.
+*/
+static void delete_at(BTree *bt, BTree_node **path, size_t *pos, int depth) {
+    BTree_node *n = path[depth - 1];
+    size_t i = pos[depth - 1];
+    memmove(key_at(bt, n, i), key_at(bt, n, i + 1), (n->count - i - 1) * bt->stride);
+    n->count--;
+    bt->size--;
+
+    // Refill underfull nodes from a sibling, or merge them with one.
+    for (int d = depth - 1; d > 0; d--) {
+        n = path[d];
+        size_t min = min_count(bt, n);
+        if (n->count >= min) {
+            return;
+        }
+
+        BTree_node *p  = path[d - 1];
+        size_t ci      = pos[d - 1];
+        BTree_node *l  = ci > 0 ? children(bt, p)[ci - 1] : NULL;
+        BTree_node *r  = ci < p->count ? children(bt, p)[ci + 1] : NULL;
+        if (l != NULL && l->count > min) {
+            borrow_left(bt, p, ci, l, n);
+            return;
+        }
+        if (r != NULL && r->count > min) {
+            borrow_right(bt, p, ci, n, r);
+            return;
+        }
+        if (l != NULL) {
+            merge(bt, p, ci - 1, l, n);
+        } else {
+            merge(bt, p, ci, n, r);
+        }
+    }
+
+    // The root may shrink to a single child or become empty.
+    BTree_node *root = bt->root;
+    if (root->count == 0) {
+        bt->root = root->leaf ? NULL : children(bt, root)[0];
+        bt->height--;
+        node_dealloc(bt, root);
+    }
+}
+
+/**
+* `iter_descend` appends the path from `n` to its first (`dir` 0) or
+* last (`dir` 1) element to `it`.
+*/
+static void iter_descend(BTree_iter *it, BTree_node *n, int dir) {
+    BTree *bt = it->btree;
+    for (;;) {
+        size_t i = dir == 0 ? 0 : (n->leaf ? n->count - 1 : n->count);
+        it->path[it->depth] = n;
+        it->pos[it->depth++] = i;
+        if (n->leaf) {
+            return;
+        }
+        n = children(bt, n)[i];
+    }
+}
+
+/**
+* `iter_forward` moves `it` to the first element of the next leaf if it
+* points behind the last element of its leaf.
+*/
+static void iter_forward(BTree_iter *it) {
+    int d = it->depth - 1;
+    if (it->pos[d] < it->path[d]->count) {
+        return;
+    }
+
+    // Go up until there is a child further right.
+    while (d > 0 && it->pos[d - 1] == it->path[d - 1]->count) {
+        d--;
+    }
+    if (d == 0) {
+        it->depth = 0;
+        return;
+    }
+    it->pos[d - 1]++;
+    it->depth = d;
+    iter_descend(it, children(it->btree, it->path[d - 1])[it->pos[d - 1]], 0);
+}
+
+/**
+* `iter_in_range` returns the current element of `it`, or `NULL` if
+* `it` is past the end or its element is not below the upper bound.
+*/
+static void *iter_in_range(BTree_iter *it) {
+    if (it->depth == 0) {
+        return NULL;
+    }
+    BTree *bt = it->btree;
+    void *data = key_at(bt, it->path[it->depth - 1], it->pos[it->depth - 1]);
+    if (it->hi != NULL && bt->compare_to(data, it->hi) >= 0) {
+        return NULL;
+    }
+    return data;
+}
+
+
+BTree *BTree_create(size_t stride, int (*compare_to)(void *elem1, void *elem2)) {
+    return BTree_create_with_allocator(stride, compare_to, NULL);
+}
+
+/**
+* `BTree_create_with_allocator` works like `BTree_create`, but the tree
+* and all of its nodes are allocated from `allocator`. If `allocator`
+* is `NULL` malloc/free are used.
+*/
+BTree *BTree_create_with_allocator(size_t stride,
+                                   int (*compare_to)(void *elem1, void *elem2),
+                                   const CLIB_Allocator *allocator) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    if (stride == 0 || compare_to == NULL || stride > SIZE_MAX / (4 * (BTREE_MIN_CAPACITY + 1))) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_create error: invalid stride or compare_to is NULL.");
+        return NULL;
+    }
+
+    BTree *bt = (BTree *) a.alloc(a.ctx, sizeof(BTree) + 2 * stride);
+    if (bt == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "BTree_create failed to allocate memory for BTree.");
+        return NULL;
+    }
+
+    bt->root       = NULL;
+    bt->size       = 0;
+    bt->stride     = stride;
+    bt->compare_to = compare_to;
+    bt->allocator  = a;
+    bt->height     = 0;
+
+    // Fill a node of `BTREE_NODE_SIZE` bytes with as many keys as fit.
+    size_t room = BTREE_NODE_SIZE - sizeof(BTree_node);
+    size_t ptr  = sizeof(BTree_node *);
+    bt->leaf_capacity  = room / stride;
+    bt->inner_capacity = (room - ptr) / (stride + ptr);
+    if (bt->leaf_capacity < BTREE_MIN_CAPACITY) {
+        bt->leaf_capacity = BTREE_MIN_CAPACITY;
+    }
+    if (bt->inner_capacity < BTREE_MIN_CAPACITY) {
+        bt->inner_capacity = BTREE_MIN_CAPACITY;
+    }
+    bt->children_offset = (bt->inner_capacity * stride + ptr - 1) / ptr * ptr;
+    bt->leaf_bytes      = sizeof(BTree_node) + bt->leaf_capacity * stride;
+    bt->inner_bytes     = sizeof(BTree_node) + bt->children_offset + (bt->inner_capacity + 1) * ptr;
+
+    return bt;
+}
+
+/**
+* `BTree_free` frees all nodes of `btree` and the tree itself.
+*/
+void BTree_free(BTree *btree) {
+    if (btree == NULL) {
+        return;
+    }
+
+    CLIB_Allocator a = btree->allocator;
+    if (btree->root != NULL) {
+        node_free_all(btree, btree->root);
+    }
+    a.free(a.ctx, btree, sizeof(BTree) + 2 * btree->stride);
+}
+
+/**
+* `BTree_insert` inserts a copy of `data` into `btree`, behind all equal
+* elements. Full nodes on the way are split; the nodes this takes are
+* allocated up front, so on failure the tree is unchanged.
+* Returns 0 on success, -1 otherwise.
+*/
+int BTree_insert(BTree *btree, void *data) {
+    if (btree == NULL || data == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_insert error: provided BTree or data is NULL.");
+        return -1;
+    }
+
+    if (btree->root == NULL) {
+        btree->root = node_alloc(btree, 1);
+        if (btree->root == NULL) {
+            return -1;
+        }
+        btree->height = 1;
+    }
+
+    BTree_node *path[BTREE_MAX_HEIGHT];
+    size_t pos[BTREE_MAX_HEIGHT];
+    int depth = 0;
+    BTree_node *n = btree->root;
+    for (;;) {
+        path[depth] = n;
+        pos[depth++] = node_bound(btree, n, data, 1);
+        if (n->leaf) {
+            break;
+        }
+        n = children(btree, n)[pos[depth - 1]];
+    }
+
+    if (n->count < btree->leaf_capacity) {
+        leaf_insert_at(btree, n, pos[depth - 1], data);
+        btree->size++;
+        return 0;
+    }
+
+    // The leaf and all full nodes directly above it are split, plus a
+    // new root if the split reaches it.
+    int splits = 1;
+    while (splits < depth && path[depth - 1 - splits]->count == btree->inner_capacity) {
+        splits++;
+    }
+    int fresh_count = splits + (splits == depth);
+    BTree_node *fresh[BTREE_MAX_HEIGHT + 1];
+    for (int k = 0; k < fresh_count; k++) {
+        fresh[k] = node_alloc(btree, k == 0);
+        if (fresh[k] == NULL) {
+            while (k > 0) {
+                node_dealloc(btree, fresh[--k]);
+            }
+            return -1;
+        }
+    }
+
+    // Split the leaf. The new element goes into the half it belongs to.
+    BTree_node *right = fresh[0];
+    size_t i = pos[depth - 1];
+    size_t half = n->count / 2;
+    right->count = n->count - half;
+    memcpy(right->keys, key_at(btree, n, half), right->count * btree->stride);
+    n->count = half;
+    if (i <= half) {
+        leaf_insert_at(btree, n, i, data);
+    } else {
+        leaf_insert_at(btree, right, i - half, data);
+    }
+    btree->size++;
+
+    // Hand the separator and the new node up to the parents.
+    char *sep = btree->scratch;
+    char *up  = btree->scratch + btree->stride;
+    memcpy(sep, right->keys, btree->stride);
+    for (int k = 1; k < splits; k++) {
+        BTree_node *p = path[depth - 1 - k];
+        inner_split_insert(btree, p, fresh[k], pos[depth - 1 - k], sep, right, up);
+        right = fresh[k];
+        char *t = sep;
+        sep = up;
+        up  = t;
+    }
+
+    if (splits < depth) {
+        inner_insert_at(btree, path[depth - 1 - splits], pos[depth - 1 - splits], sep, right);
+    } else {
+        BTree_node *root = fresh[splits];
+        memcpy(root->keys, sep, btree->stride);
+        children(btree, root)[0] = btree->root;
+        children(btree, root)[1] = right;
+        root->count = 1;
+        btree->root = root;
+        btree->height++;
+    }
+
+    return 0;
+}
+
+/**
+* `BTree_remove` removes one occurrence of `data` from `btree`, if any.
+* Underfull nodes borrow from or merge with a sibling.
+* Returns 0 on success, -1 otherwise.
+*/
+int BTree_remove(BTree *btree, void *data) {
+    if (btree == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_remove error: provided BTree is NULL.");
+        return -1;
+    }
+
+    BTree_iter it;
+    BTree_iter_seek(btree, &it, data);
+    void *found = iter_in_range(&it);
+    if (found != NULL && btree->compare_to(found, data) == 0) {
+        delete_at(btree, it.path, it.pos, it.depth);
+    }
+
+    return 0;
+}
+
+/**
+* `BTree_top` returns a pointer to the smallest element of `btree`
+* (with respect to `compare_to`) without removing it.
+* Returns `NULL` if `btree` is empty or not initialized.
+*/
+void *BTree_top(BTree *btree) {
+    if (btree == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_top error: provided BTree is NULL.");
+        return NULL;
+    }
+
+    BTree_node *n = btree->root;
+    if (n == NULL) {
+        return NULL;
+    }
+    while (!n->leaf) {
+        n = children(btree, n)[0];
+    }
+
+    return n->keys;
+}
+
+/**
+* `BTree_pop` removes the smallest element of `btree`, copies it into
+* newly allocated memory and returns a pointer to it.
+* `free()` needs to be called manually!
+* Returns `NULL` if `btree` is empty or on failure.
+*/
+void *BTree_pop(BTree *btree) {
+    if (btree == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_pop error: provided BTree is NULL.");
+        return NULL;
+    }
+
+    if (btree->root == NULL) {
+        return NULL;
+    }
+
+    void *result = malloc(btree->stride);
+    if (result == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "BTree_pop error: memory allocation for result failed.");
+        return NULL;
+    }
+
+    BTree_iter it;
+    BTree_iter_begin(btree, &it);
+    memcpy(result, iter_in_range(&it), btree->stride);
+    delete_at(btree, it.path, it.pos, it.depth);
+
+    return result;
+}
+
+/**
+* `BTree_is_empty` returns 0 if `btree` is empty, 1 if it is not
+* and -1 if the provided BTree was not initialized.
+*/
+int BTree_is_empty(BTree *btree) {
+    if (btree == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_is_empty error: provided BTree is NULL.");
+        return -1;
+    }
+    return btree->size == 0 ? 0 : 1;
+}
+
+/**
+* `BTree_size` returns the number of elements in `btree`,
+* or -1 if the provided BTree was not initialized.
+*/
+long BTree_size(BTree *btree) {
+    if (btree == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_size error: provided BTree is NULL.");
+        return -1;
+    }
+    return btree->size;
+}
+
+/**
+* `BTree_contains` returns 1 if `data` occurs in `btree`,
+* 0 if it does not and -1 on failure.
+*/
+int BTree_contains(BTree *btree, void *data) {
+    if (btree == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_contains error: provided BTree is NULL.");
+        return -1;
+    }
+
+    // Usually the lower bound is in the leaf the search ends in. Only
+    // if the leaf holds just smaller elements the next one is needed.
+    BTree_node *n = btree->root;
+    if (n == NULL) {
+        return 0;
+    }
+    while (!n->leaf) {
+        n = children(btree, n)[node_bound(btree, n, data, 0)];
+    }
+    size_t i = node_bound(btree, n, data, 0);
+    if (i < n->count) {
+        return btree->compare_to(key_at(btree, n, i), data) == 0;
+    }
+
+    BTree_iter it;
+    BTree_iter_seek(btree, &it, data);
+    void *found = iter_in_range(&it);
+
+    return found != NULL && btree->compare_to(found, data) == 0;
+}
+
+/**
+* `BTree_count` returns the number of occurrences of `data` in `btree`.
+* Returns -1 on failure.
+*/
+long BTree_count(BTree *btree, void *data) {
+    if (btree == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_count error: provided BTree is NULL.");
+        return -1;
+    }
+
+    BTree_iter it;
+    long n = 0;
+    BTree_iter_seek(btree, &it, data);
+    for (void *e = iter_in_range(&it); e != NULL && btree->compare_to(e, data) == 0;
+         e = BTree_iter_next(&it)) {
+        n++;
+    }
+
+    return n;
+}
+
+/**
+* `BTree_height` returns the number of levels of `btree` (0 for an empty
+* tree), or -1 if the provided BTree was not initialized.
+*/
+int BTree_height(BTree *btree) {
+    if (btree == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_height error: provided BTree is NULL.");
+        return -1;
+    }
+    return btree->height;
+}
+
+/**
+* `BTree_iter_begin` positions `it` at the smallest element of `btree`.
+* Iterators keep the path from the root to the current leaf in a fixed
+* size array, so moving them neither recurses nor allocates. Any
+* insert or remove on `btree` invalidates its iterators.
+* Returns 0 on success, -1 otherwise.
+*/
+int BTree_iter_begin(BTree *btree, BTree_iter *it) {
+    if (btree == NULL || it == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_iter_begin error: provided BTree or iterator is NULL.");
+        return -1;
+    }
+
+    it->btree = btree;
+    it->hi    = NULL;
+    it->depth = 0;
+    if (btree->root != NULL) {
+        iter_descend(it, btree->root, 0);
+    }
+
+    return 0;
+}
+
+/**
+* `BTree_iter_last` positions `it` at the largest element of `btree`.
+* Returns 0 on success, -1 otherwise.
+*/
+int BTree_iter_last(BTree *btree, BTree_iter *it) {
+    if (btree == NULL || it == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_iter_last error: provided BTree or iterator is NULL.");
+        return -1;
+    }
+
+    it->btree = btree;
+    it->hi    = NULL;
+    it->depth = 0;
+    if (btree->root != NULL) {
+        iter_descend(it, btree->root, 1);
+    }
+
+    return 0;
+}
+
+/**
+* `BTree_iter_seek` positions `it` at the first element of `btree` that
+* is not smaller than `key`, or past the end if there is none.
+* Returns 0 on success, -1 otherwise.
+*/
+int BTree_iter_seek(BTree *btree, BTree_iter *it, void *key) {
+    if (btree == NULL || it == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "BTree_iter_seek error: provided BTree or iterator is NULL.");
+        return -1;
+    }
+
+    it->btree = btree;
+    it->hi    = NULL;
+    it->depth = 0;
+
+    BTree_node *n = btree->root;
+    if (n == NULL) {
+        return 0;
+    }
+    for (;;) {
+        size_t i = node_bound(btree, n, key, 0);
+        it->path[it->depth] = n;
+        it->pos[it->depth++] = i;
+        if (n->leaf) {
+            break;
+        }
+        n = children(btree, n)[i];
+    }
+
+    // The leaf may only hold smaller elements, the bound is then the
+    // first element of the next one.
+    iter_forward(it);
+
+    return 0;
+}
+
+/**
+* `BTree_iter_range` positions `it` at the first element not smaller
+* than `lo` and limits it to elements smaller than `hi`, i.e. it scans
+* the range [lo, hi). Either bound may be `NULL` for no limit. `hi`
+* must stay valid while iterating.
+* Returns 0 on success, -1 otherwise.
+*/
+int BTree_iter_range(BTree *btree, BTree_iter *it, void *lo, void *hi) {
+    int res = lo != NULL ? BTree_iter_seek(btree, it, lo) : BTree_iter_begin(btree, it);
+    if (res == 0) {
+        it->hi = hi;
+    }
+    return res;
+}
+
+/**
+* `BTree_iter_get` returns a pointer to the current element of `it`,
+* or `NULL` if `it` is past the end of the tree or range.
+*/
+void *BTree_iter_get(BTree_iter *it) {
+    if (it == NULL) {
+        return NULL;
+    }
+    return iter_in_range(it);
+}
+
+/**
+* `BTree_iter_next` moves `it` to the next larger element and returns
+* a pointer to it, or `NULL` once the end of the tree or range is passed.
+*/
+void *BTree_iter_next(BTree_iter *it) {
+    if (it == NULL || it->depth == 0) {
+        return NULL;
+    }
+
+    it->pos[it->depth - 1]++;
+    iter_forward(it);
+
+    return iter_in_range(it);
+}
+
+/**
+* `BTree_iter_prev` moves `it` to the next smaller element and returns
+* a pointer to it, or `NULL` once the beginning of the tree is passed.
+*/
+void *BTree_iter_prev(BTree_iter *it) {
+    if (it == NULL || it->depth == 0) {
+        return NULL;
+    }
+
+    int d = it->depth - 1;
+    if (it->pos[d] > 0) {
+        it->pos[d]--;
+        return iter_in_range(it);
+    }
+
+    // Go up until there is a child further left.
+    while (d > 0 && it->pos[d - 1] == 0) {
+        d--;
+    }
+    if (d == 0) {
+        it->depth = 0;
+        return NULL;
+    }
+    it->pos[d - 1]--;
+    it->depth = d;
+    iter_descend(it, children(it->btree, it->path[d - 1])[it->pos[d - 1]], 1);
+
+    return iter_in_range(it);
+}
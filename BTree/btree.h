@@ -0,0 +1,92 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "clib_alloc.h"
+#include "clib_log.h"
+
+// Target size of a node in bytes. Nodes hold as many elements as fit,
+// but at least `BTREE_MIN_CAPACITY`, so large elements make larger nodes.
+#ifndef BTREE_NODE_SIZE
+#define BTREE_NODE_SIZE 1024
+#endif
+#define BTREE_MIN_CAPACITY 4
+
+// Upper bound for the height of a tree with up to 2^64 elements, used
+// for fixed size path stacks. Inner nodes other than the root have at
+// least 2 children.
+#define BTREE_MAX_HEIGHT 64
+
+typedef struct BTree_node {
+    // Number of elements in a leaf, or of separators in an inner node
+    // (which then has `count + 1` children).
+    unsigned int count;
+    // 1 for leaves, 0 for inner nodes.
+    unsigned int leaf;
+    // The keys, stored contiguously: up to `leaf_capacity` elements of a
+    // leaf, or `inner_capacity` separators followed by the child pointers
+    // of an inner node.
+    _Alignas(max_align_t) char keys[];
+} BTree_node;
+
+typedef struct {
+    BTree_node *root;
+    // Number of elements in the tree.
+    size_t size;
+    size_t stride;
+    int (*compare_to)(void *elem1, void *elem2);
+    // Allocator for the tree and its nodes.
+    CLIB_Allocator allocator;
+    // Number of levels, 0 for an empty tree.
+    int height;
+    // Node layout, derived from `stride` and `BTREE_NODE_SIZE`.
+    size_t leaf_capacity;
+    size_t inner_capacity;
+    size_t children_offset;
+    size_t leaf_bytes;
+    size_t inner_bytes;
+    // Room for two separators while splitting nodes.
+    _Alignas(max_align_t) char scratch[];
+} BTree;
+
+typedef struct {
+    BTree *btree;
+    // Exclusive upper bound of a range scan, NULL if unbounded.
+    void *hi;
+    // Path from the root to the current leaf.
+    BTree_node *path[BTREE_MAX_HEIGHT];
+    // Index of the child taken in each inner node of `path`, and of the
+    // current element in the leaf.
+    size_t pos[BTREE_MAX_HEIGHT];
+    // Length of `path`, 0 once the iterator is past the end.
+    int depth;
+} BTree_iter;
+
+BTree *BTree_create(size_t stride, int (*compare_to)(void *elem1, void *elem2));
+BTree *BTree_create_with_allocator(size_t stride,
+                                   int (*compare_to)(void *elem1, void *elem2),
+                                   const CLIB_Allocator *allocator);
+void BTree_free(BTree *btree);
+int BTree_insert(BTree *btree, void *data);
+int BTree_remove(BTree *btree, void *data);
+void *BTree_pop(BTree *btree);
+void *BTree_top(BTree *btree);
+int BTree_is_empty(BTree *btree);
+long BTree_size(BTree *btree);
+int BTree_contains(BTree *btree, void *data);
+long BTree_count(BTree *btree, void *data);
+int BTree_height(BTree *btree);
+int BTree_iter_begin(BTree *btree, BTree_iter *it);
+int BTree_iter_last(BTree *btree, BTree_iter *it);
+int BTree_iter_seek(BTree *btree, BTree_iter *it, void *key);
+int BTree_iter_range(BTree *btree, BTree_iter *it, void *lo, void *hi);
+void *BTree_iter_get(BTree_iter *it);
+void *BTree_iter_next(BTree_iter *it);
+void *BTree_iter_prev(BTree_iter *it);
+
+#endif
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "btree.h"
+
+typedef struct {
+    size_t id;
+    int age;
+    float height;
+} person_t;
+
+int compare_people(void *a, void *b) {
+    size_t x = ((person_t *)a)->id;
+    size_t y = ((person_t *)b)->id;
+    return (x > y) - (x < y);
+}
+
+void print_person(person_t *p) {
+    printf("----------------------------\n");
+    printf("Person:\n");
+    printf("id = \t\t%zu\n", p->id);
+    printf("age = \t\t%d\n", p->age);
+    printf("height = \t%f\n", p->height);
+    printf("----------------------------\n");
+}
+
+int main() {
+
+    printf("----- BTree -----\n\n");
+
+
+    BTree *t = BTree_create(sizeof(person_t), compare_people);
+    if (t == NULL) {
+        printf("Creation of BTree failed.\n");
+        return 1;
+    }
+    printf("BTree created successfully (%zu elements per leaf).\n", t->leaf_capacity);
+
+    person_t p0 = {
+        .id = 0,
+        .age = 21,
+        .height = 1.76,
+    };
+    person_t p1 = {
+        .id = 1,
+        .age = 23,
+        .height = 1.86,
+    };
+    person_t p2 = {
+        .id = 2,
+        .age = 25,
+        .height = 1.80,
+    };
+    BTree_insert(t, &p0);
+    BTree_insert(t, &p1);
+    BTree_insert(t, &p1);
+    BTree_insert(t, &p2);
+
+    printf("size = %ld, height = %d\n", BTree_size(t), BTree_height(t));
+    printf("contains p1: %d\n", BTree_contains(t, &p1));
+    printf("count of p1: %ld\n", BTree_count(t, &p1));
+
+    printf("top:\n");
+    print_person((person_t *) BTree_top(t));
+
+    BTree_remove(t, &p1);
+    printf("count of p1 after removing it once: %ld\n", BTree_count(t, &p1));
+
+    printf("popping all elements:\n");
+    while (BTree_is_empty(t) == 1) {
+        person_t *p = (person_t *) BTree_pop(t);
+        print_person(p);
+        free(p);
+    }
+
+    for (size_t i = 0; i < 100000; i++) {
+        person_t p = { .id = i, .age = 0, .height = 0 };
+        BTree_insert(t, &p);
+    }
+    printf("size = %ld, height = %d after inserting 100000 sorted elements\n",
+           BTree_size(t), BTree_height(t));
+
+    // Range scan over [10, 15), then walk backwards from the last element.
+    person_t lo = { .id = 10 }, hi = { .id = 15 };
+    BTree_iter it;
+    printf("ids in [10, 15):");
+    BTree_iter_range(t, &it, &lo, &hi);
+    for (person_t *p = BTree_iter_get(&it); p != NULL; p = BTree_iter_next(&it)) {
+        printf(" %zu", p->id);
+    }
+    printf("\nlargest ids:");
+    BTree_iter_last(t, &it);
+    for (int i = 0; i < 3; i++, BTree_iter_prev(&it)) {
+        printf(" %zu", ((person_t *) BTree_iter_get(&it))->id);
+    }
+    printf("\n");
+
+    BTree_free(t);
+    printf("BTree freed successfully.\n");
+
+    return EXIT_SUCCESS;
+}
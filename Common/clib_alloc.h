@@ -0,0 +1,45 @@
+#ifndef CLIB_ALLOC_H
+#define CLIB_ALLOC_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/**
+* `CLIB_Allocator` is the memory interface used by all data structures
+* of this library. Each function receives the `ctx` pointer of the
+* allocator, so arenas, pools etc. can carry their own state.
+* `realloc` and `free` are told the size of the block, which allocators
+* without per-block headers need.
+*
+* Structures copy the allocator when they are created, but not what
+* `ctx` points to: that needs to outlive every structure using it.
+*/
+typedef struct CLIB_Allocator {
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void  (*free)(void *ctx, void *ptr, size_t size);
+    void  *ctx;
+} CLIB_Allocator;
+
+static inline void *clib_std_alloc(void *ctx, size_t size) {
+    (void) ctx;
+    return malloc(size);
+}
+
+static inline void *clib_std_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void) ctx;
+    (void) old_size;
+    return realloc(ptr, new_size);
+}
+
+static inline void clib_std_free(void *ctx, void *ptr, size_t size) {
+    (void) ctx;
+    (void) size;
+    free(ptr);
+}
+
+// The default allocator: plain malloc/realloc/free.
+#define CLIB_DEFAULT_ALLOCATOR \
+    ((CLIB_Allocator) { clib_std_alloc, clib_std_realloc, clib_std_free, NULL })
+
+#endif // CLIB_ALLOC_H
@@ -0,0 +1,226 @@
+#ifndef CLIB_BENCH_H
+#define CLIB_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "clib_alloc.h"
+
+/**
+* Small harness shared by the `bench` programs of the libraries.
+* Not installed.
+*
+* A benchmark is a function `void fn(CLIB_Bench *b, size_t n)` that
+* prepares its input, then times the measured part between
+* `clib_bench_start(b)` and `clib_bench_stop(b, ops)`. Structures it
+* creates should use `b->allocator`, which counts allocations.
+* `clib_bench_run` repeats it until enough time has passed and reports
+* ns/op, throughput, peak RSS and allocations per repetition as a
+* table, CSV or JSON.
+*
+* Command line of the bench programs:
+*   --max-n N        largest size (sizes are 1e3, 1e4, ... up to N)
+*   --format F       table (default), csv or json
+*   --filter S       only run benchmarks whose name contains S
+*/
+
+// Each benchmark is repeated until it has been timed for this long.
+#define CLIB_BENCH_MIN_TIME 0.2
+#define CLIB_BENCH_MAX_REPS 1000
+
+typedef struct {
+    size_t allocs;      // calls to alloc
+    size_t reallocs;    // calls to realloc
+    size_t frees;       // calls to free
+    size_t bytes;       // bytes currently allocated
+    size_t peak_bytes;  // maximum of `bytes`
+} CLIB_AllocStats;
+
+typedef struct CLIB_Bench {
+    const char *suite;
+    const char *format;
+    const char *filter;
+    size_t max_n;
+    int rows;
+
+    // State of the current benchmark.
+    CLIB_AllocStats alloc;
+    CLIB_Allocator allocator;
+    struct timespec start;
+    double elapsed;
+    size_t ops;
+    uint64_t rng;
+} CLIB_Bench;
+
+static void *clib_bench_alloc(void *ctx, size_t size) {
+    CLIB_AllocStats *s = (CLIB_AllocStats *) ctx;
+    s->allocs++;
+    s->bytes += size;
+    if (s->bytes > s->peak_bytes) {
+        s->peak_bytes = s->bytes;
+    }
+    return malloc(size);
+}
+
+static void *clib_bench_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    CLIB_AllocStats *s = (CLIB_AllocStats *) ctx;
+    s->reallocs++;
+    s->bytes += new_size - old_size;
+    if (s->bytes > s->peak_bytes) {
+        s->peak_bytes = s->bytes;
+    }
+    return realloc(ptr, new_size);
+}
+
+static void clib_bench_free(void *ctx, void *ptr, size_t size) {
+    CLIB_AllocStats *s = (CLIB_AllocStats *) ctx;
+    if (ptr != NULL) {
+        s->frees++;
+        s->bytes -= size;
+    }
+    free(ptr);
+}
+
+/**
+* `clib_bench_rand` returns the next number of the xorshift64 generator
+* of `b`. It is reseeded for every benchmark, so all runs see the same
+* input.
+*/
+static inline uint64_t clib_bench_rand(CLIB_Bench *b) {
+    b->rng ^= b->rng << 13;
+    b->rng ^= b->rng >> 7;
+    b->rng ^= b->rng << 17;
+    return b->rng;
+}
+
+static inline void clib_bench_start(CLIB_Bench *b) {
+    clock_gettime(CLOCK_MONOTONIC, &b->start);
+}
+
+static inline void clib_bench_stop(CLIB_Bench *b, size_t ops) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    b->elapsed += (end.tv_sec - b->start.tv_sec) + (end.tv_nsec - b->start.tv_nsec) * 1e-9;
+    b->ops += ops;
+}
+
+/**
+* `clib_bench_reset_peak_rss` resets the peak RSS of the process, so
+* the next reading only covers the current benchmark (Linux only,
+* otherwise the peak of the whole run is reported).
+*/
+static void clib_bench_reset_peak_rss(void) {
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (f != NULL) {
+        fputs("5", f);
+        fclose(f);
+    }
+}
+
+// Returns the peak RSS in KiB.
+static long clib_bench_peak_rss(void) {
+    long kb = -1;
+    char line[128];
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f != NULL) {
+        while (fgets(line, sizeof(line), f) != NULL) {
+            if (sscanf(line, "VmHWM: %ld", &kb) == 1) {
+                break;
+            }
+        }
+        fclose(f);
+    }
+    if (kb < 0) {
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        kb = ru.ru_maxrss;
+    }
+    return kb;
+}
+
+static void clib_bench_init(CLIB_Bench *b, const char *suite, int argc, char **argv) {
+    memset(b, 0, sizeof(*b));
+    b->suite  = suite;
+    b->format = "table";
+    b->filter = "";
+    b->max_n  = 1000000;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--max-n") == 0) {
+            b->max_n = (size_t) strtod(argv[i + 1], NULL);
+        } else if (strcmp(argv[i], "--format") == 0) {
+            b->format = argv[i + 1];
+        } else if (strcmp(argv[i], "--filter") == 0) {
+            b->filter = argv[i + 1];
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (strcmp(b->format, "csv") == 0) {
+        printf("suite,benchmark,n,reps,ns_per_op,mops_per_s,peak_rss_kb,allocs_per_rep,peak_alloc_bytes\n");
+    } else if (strcmp(b->format, "json") == 0) {
+        printf("[\n");
+    } else {
+        printf("%-8s %-20s %10s %6s %10s %10s %12s %8s %14s\n", "suite", "benchmark", "n", "reps",
+               "ns/op", "Mops/s", "peak_rss_kb", "allocs", "peak_alloc_B");
+    }
+}
+
+/**
+* `clib_bench_run` runs `fn` for size `n` (if it matches the filter)
+* and prints one result row.
+*/
+static void clib_bench_run(CLIB_Bench *b, const char *name, size_t n,
+                           void (*fn)(CLIB_Bench *b, size_t n)) {
+    if (strstr(name, b->filter) == NULL) {
+        return;
+    }
+
+    memset(&b->alloc, 0, sizeof(b->alloc));
+    b->allocator = (CLIB_Allocator) { clib_bench_alloc, clib_bench_realloc, clib_bench_free, &b->alloc };
+    b->elapsed = 0;
+    b->ops     = 0;
+    clib_bench_reset_peak_rss();
+
+    size_t reps = 0;
+    while (reps == 0 || (b->elapsed < CLIB_BENCH_MIN_TIME && reps < CLIB_BENCH_MAX_REPS)) {
+        b->rng = 0x9e3779b97f4a7c15ull;
+        fn(b, n);
+        reps++;
+    }
+
+    double ns_op  = b->ops > 0 ? b->elapsed * 1e9 / b->ops : 0;
+    double mops   = b->elapsed > 0 ? b->ops / b->elapsed * 1e-6 : 0;
+    long rss      = clib_bench_peak_rss();
+    double allocs = (double) (b->alloc.allocs + b->alloc.reallocs) / reps;
+
+    if (strcmp(b->format, "csv") == 0) {
+        printf("%s,%s,%zu,%zu,%.3f,%.3f,%ld,%.1f,%zu\n", b->suite, name, n, reps,
+               ns_op, mops, rss, allocs, b->alloc.peak_bytes);
+    } else if (strcmp(b->format, "json") == 0) {
+        printf("%s  {\"suite\": \"%s\", \"benchmark\": \"%s\", \"n\": %zu, \"reps\": %zu, "
+               "\"ns_per_op\": %.3f, \"mops_per_s\": %.3f, \"peak_rss_kb\": %ld, "
+               "\"allocs_per_rep\": %.1f, \"peak_alloc_bytes\": %zu}",
+               b->rows > 0 ? ",\n" : "", b->suite, name, n, reps, ns_op, mops, rss, allocs,
+               b->alloc.peak_bytes);
+    } else {
+        printf("%-8s %-20s %10zu %6zu %10.2f %10.2f %12ld %8.1f %14zu\n", b->suite, name, n, reps,
+               ns_op, mops, rss, allocs, b->alloc.peak_bytes);
+    }
+    fflush(stdout);
+    b->rows++;
+}
+
+static void clib_bench_finish(CLIB_Bench *b) {
+    if (strcmp(b->format, "json") == 0) {
+        printf("\n]\n");
+    }
+}
+
+#endif // CLIB_BENCH_H
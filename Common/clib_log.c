@@ -0,0 +1,78 @@
+#include "clib_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+static _Thread_local int last_error = CLIB_OK;
+
+static CLIB_LogSink log_sink = NULL;
+static void *log_ctx = NULL;
+
+/**
+* `clib_last_error` returns the last error recorded on this thread,
+* `CLIB_OK` if there was none since the last `clib_clear_error`.
+*/
+int clib_last_error(void) {
+    return last_error;
+}
+
+/**
+* `clib_clear_error` resets the last error of this thread to `CLIB_OK`.
+*/
+void clib_clear_error(void) {
+    last_error = CLIB_OK;
+}
+
+/**
+* `clib_set_error` records `error` as the last error of this thread.
+*/
+void clib_set_error(int error) {
+    last_error = error;
+}
+
+/**
+* `clib_strerror` returns a static description of `error`.
+*/
+const char *clib_strerror(int error) {
+    switch (error) {
+    case CLIB_OK:        return "no error";
+    case CLIB_EINVAL:    return "invalid argument";
+    case CLIB_ERANGE:    return "index out of bounds";
+    case CLIB_ENOMEM:    return "out of memory";
+    case CLIB_EOVERFLOW: return "size overflows";
+    case CLIB_EIO:       return "input/output error";
+    case CLIB_EFORMAT:   return "invalid file format";
+    default:             return "unknown error";
+    }
+}
+
+/**
+* `clib_log_set_sink` routes log messages to `sink`, which is called
+* with `ctx`. `NULL` restores the default sink, which writes to stderr.
+* Should be called before other threads start using the library.
+*/
+void clib_log_set_sink(CLIB_LogSink sink, void *ctx) {
+    log_sink = sink;
+    log_ctx  = ctx;
+}
+
+/**
+* `clib_log_write` formats a message and hands it to the current sink.
+* Use the `CLIB_LOG` macro, which drops messages above `CLIB_LOG_LEVEL`
+* at compile time, instead of calling this directly.
+*/
+void clib_log_write(int level, const char *fmt, ...) {
+    static const char *names[] = { "none", "error", "warn", "info", "debug" };
+    char msg[256];
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+
+    if (log_sink != NULL) {
+        log_sink(log_ctx, level, msg);
+    } else {
+        const char *name = level >= 0 && level <= CLIB_LOG_DEBUG ? names[level] : "log";
+        fprintf(stderr, "[clib %s] %s\n", name, msg);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef CLIB_LOG_H
+#define CLIB_LOG_H
+
+/**
+* Error reporting and diagnostics shared by all data structures.
+*
+* Functions report failure through their return value (-1, NULL, ...)
+* and record the reason in a thread-local last error, which can be
+* queried with `clib_last_error`. Like `errno`, it is only written on
+* failure, so it has to be cleared (`clib_clear_error`) before a call
+* if a later check should only see errors of that call.
+*
+* Additionally, messages can be logged. Which ones are compiled in is
+* chosen with `-DCLIB_LOG_LEVEL=<n>` when building the libraries:
+*   0  CLIB_LOG_NONE   nothing (default), logging costs nothing
+*   1  CLIB_LOG_ERROR  failures of library functions
+*   2  CLIB_LOG_WARN   suspicious, but handled situations
+*   3  CLIB_LOG_INFO   informational messages
+*   4  CLIB_LOG_DEBUG  tracing
+* Messages go to stderr unless a sink is set with `clib_log_set_sink`.
+*/
+
+#define CLIB_LOG_NONE  0
+#define CLIB_LOG_ERROR 1
+#define CLIB_LOG_WARN  2
+#define CLIB_LOG_INFO  3
+#define CLIB_LOG_DEBUG 4
+
+#ifndef CLIB_LOG_LEVEL
+#define CLIB_LOG_LEVEL CLIB_LOG_NONE
+#endif
+
+typedef enum CLIB_Error {
+    CLIB_OK = 0,
+    CLIB_EINVAL,    // NULL or otherwise invalid argument
+    CLIB_ERANGE,    // index out of bounds
+    CLIB_ENOMEM,    // allocation failed
+    CLIB_EOVERFLOW, // size computation overflows
+    CLIB_EIO,       // a file operation failed
+    CLIB_EFORMAT,   // malformed or incompatible file contents
+} CLIB_Error;
+
+/**
+* A log sink receives the `level` and the formatted `msg` (without a
+* trailing newline) together with the `ctx` pointer it was set with.
+* It may be called from several threads at once.
+*/
+typedef void (*CLIB_LogSink)(void *ctx, int level, const char *msg);
+
+int clib_last_error(void);
+void clib_clear_error(void);
+void clib_set_error(int error);
+const char *clib_strerror(int error);
+
+void clib_log_set_sink(CLIB_LogSink sink, void *ctx);
+void clib_log_write(int level, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// The level check is a constant expression, so disabled messages and
+// their arguments are removed by the compiler (but still type checked).
+#define CLIB_LOG(level, ...)                                                    \
+    do {                                                                        \
+        if ((level) <= CLIB_LOG_LEVEL) {                                        \
+            clib_log_write((level), __VA_ARGS__);                               \
+        }                                                                       \
+    } while (0)
+
+// Records `error` as the last error and logs the message as an error.
+#define CLIB_FAIL(error, ...)                                                   \
+    do {                                                                        \
+        clib_set_error(error);                                                  \
+        CLIB_LOG(CLIB_LOG_ERROR, __VA_ARGS__);                                  \
+    } while (0)
+
+#endif // CLIB_LOG_H
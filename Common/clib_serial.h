@@ -0,0 +1,147 @@
+#ifndef CLIB_SERIAL_H
+#define CLIB_SERIAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "clib_log.h"
+
+/**
+* Binary format shared by the `*_serialize` functions: a fixed header
+* followed by `count` elements of `stride` bytes each, without any
+* framing. `checksum` covers the elements. Numbers are stored in the
+* byte order of the machine, like the elements themselves.
+* Only used by the libraries' sources, not installed.
+*/
+
+#define CLIB_SERIAL_VERSION 1
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t stride;
+    uint64_t count;
+    uint64_t checksum;
+} CLIB_SerialHeader;
+
+/**
+* `CLIB_Checksum` is a streaming 64 bit hash over a byte sequence. It
+* consumes 8 byte words, so it keeps up with `fwrite`/`fread`, and does
+* not depend on how the bytes are split into updates.
+*/
+typedef struct {
+    uint64_t hash;
+    uint64_t length;
+    unsigned char tail[8];
+    size_t   n_tail;
+} CLIB_Checksum;
+
+#define CLIB_CHECKSUM_K1 0x9e3779b185ebca87ull
+#define CLIB_CHECKSUM_K2 0xc2b2ae3d27d4eb4full
+
+static inline uint64_t clib_checksum_round(uint64_t hash, uint64_t word) {
+    hash ^= word * CLIB_CHECKSUM_K2;
+    hash = (hash << 31) | (hash >> 33);
+    return hash * CLIB_CHECKSUM_K1;
+}
+
+static inline void clib_checksum_init(CLIB_Checksum *c) {
+    memset(c, 0, sizeof(*c));
+    c->hash = CLIB_CHECKSUM_K1;
+}
+
+static inline void clib_checksum_update(CLIB_Checksum *c, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *) data;
+    c->length += len;
+
+    if (c->n_tail > 0) {
+        while (len > 0 && c->n_tail < 8) {
+            c->tail[c->n_tail++] = *p++;
+            len--;
+        }
+        if (c->n_tail < 8) {
+            return;
+        }
+        uint64_t word;
+        memcpy(&word, c->tail, 8);
+        c->hash = clib_checksum_round(c->hash, word);
+        c->n_tail = 0;
+    }
+
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        c->hash = clib_checksum_round(c->hash, word);
+    }
+
+    memcpy(c->tail, p, len);
+    c->n_tail = len;
+}
+
+static inline uint64_t clib_checksum_final(CLIB_Checksum *c) {
+    uint64_t hash = c->hash;
+    if (c->n_tail > 0) {
+        uint64_t word = 0;
+        memcpy(&word, c->tail, c->n_tail);
+        hash = clib_checksum_round(hash, word);
+    }
+    hash ^= c->length;
+    hash ^= hash >> 33;
+    hash *= CLIB_CHECKSUM_K2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+/**
+* `clib_serial_read_header` reads a header from `in` and checks its
+* magic and version.
+* Returns 0 on success, or the `CLIB_Error` describing the failure.
+*/
+static inline int clib_serial_read_header(FILE *in, const char magic[8], CLIB_SerialHeader *h) {
+    if (fread(h, sizeof(*h), 1, in) != 1) {
+        return ferror(in) ? CLIB_EIO : CLIB_EFORMAT;
+    }
+    if (memcmp(h->magic, magic, 8) != 0 || h->version != CLIB_SERIAL_VERSION || h->stride == 0) {
+        return CLIB_EFORMAT;
+    }
+    return CLIB_OK;
+}
+
+/**
+* When the size of the input is unknown, `*_deserialize` allocate for at
+* most this many bytes of elements ahead of what has been read and grow
+* geometrically from there, so a forged count can't make them allocate
+* more than about twice the size of the actual input.
+*/
+#define CLIB_SERIAL_CHUNK ((size_t) 1 << 20)
+
+/**
+* `clib_serial_check_size` checks that `in`, positioned behind header
+* `h`, still holds the `count * stride` bytes of elements it announces,
+* so the whole count can be allocated up front. If `in` can't be sized
+* (a pipe or a socket), `*seekable` is set to 0 and the count can only
+* be trusted as far as the elements have been read.
+* Returns 0 on success, or the `CLIB_Error` describing the failure.
+*/
+static inline int clib_serial_check_size(FILE *in, const CLIB_SerialHeader *h, int *seekable) {
+    *seekable = 0;
+    off_t pos = ftello(in);
+    if (pos < 0 || fseeko(in, 0, SEEK_END) != 0) {
+        return CLIB_OK;
+    }
+    off_t end = ftello(in);
+    if (fseeko(in, pos, SEEK_SET) != 0) {
+        return CLIB_EIO;
+    }
+    if (end < 0) {
+        return CLIB_OK;
+    }
+    *seekable = 1;
+    uint64_t remaining = end > pos ? (uint64_t) (end - pos) : 0;
+    return h->count > remaining / h->stride ? CLIB_EFORMAT : CLIB_OK;
+}
+
+#endif // CLIB_SERIAL_H
@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "dynlist.h"
+#include "clib_bench.h"
+
+/*
+* Microbenchmarks of DynList on int32 elements.
+* Usage: ./bench [--max-n N] [--format table|csv|json] [--filter S]
+*/
+
+// Quadratic benchmarks stop at this size.
+#define QUADRATIC_MAX_N 100000
+
+static DynList *create(CLIB_Bench *b, size_t capacity) {
+    DynList *dl = DL_create_with_allocator(capacity, sizeof(int32_t), DL_cmp_int32, &b->allocator);
+    if (dl == NULL) {
+        fprintf(stderr, "DL_create failed: %s\n", clib_strerror(clib_last_error()));
+        exit(EXIT_FAILURE);
+    }
+    return dl;
+}
+
+// Fills `dl` with n elements produced by `gen`, without timing.
+static DynList *filled(CLIB_Bench *b, size_t n, int32_t (*gen)(CLIB_Bench *b, size_t i, size_t n)) {
+    int32_t *v = malloc(n * sizeof(int32_t));
+    if (v == NULL) {
+        fprintf(stderr, "Allocation of input failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < n; i++) {
+        v[i] = gen(b, i, n);
+    }
+    DynList *dl = create(b, n);
+    DL_append_n(dl, v, n);
+    free(v);
+    return dl;
+}
+
+static int32_t gen_random(CLIB_Bench *b, size_t i, size_t n) {
+    return (int32_t) clib_bench_rand(b);
+}
+
+static int32_t gen_sorted(CLIB_Bench *b, size_t i, size_t n) {
+    return (int32_t) i;
+}
+
+static int32_t gen_reversed(CLIB_Bench *b, size_t i, size_t n) {
+    return (int32_t) (n - i);
+}
+
+static int32_t gen_few_unique(CLIB_Bench *b, size_t i, size_t n) {
+    return (int32_t) (clib_bench_rand(b) % 16);
+}
+
+static void bench_append(CLIB_Bench *b, size_t n) {
+    DynList *dl = create(b, 0);
+    clib_bench_start(b);
+    for (int32_t i = 0; i < (int32_t) n; i++) {
+        DL_append(dl, &i);
+    }
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+static void bench_append_seglist(CLIB_Bench *b, size_t n) {
+    DL_SegList *sl = DL_seglist_create_with_allocator(0, sizeof(int32_t), DL_cmp_int32, &b->allocator);
+    clib_bench_start(b);
+    for (int32_t i = 0; i < (int32_t) n; i++) {
+        DL_seglist_append(sl, &i);
+    }
+    clib_bench_stop(b, n);
+    DL_seglist_free(sl);
+}
+
+// Reads n elements at random indices.
+static void bench_get_random(CLIB_Bench *b, size_t n) {
+    DynList *dl = filled(b, n, gen_sorted);
+    int64_t sum = 0;
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        sum += *(int32_t *) DL_get(dl, clib_bench_rand(b) % n);
+    }
+    clib_bench_stop(b, n);
+    volatile int64_t s = sum;
+    (void) s;
+    DL_free(dl);
+}
+
+static void bench_get_random_seglist(CLIB_Bench *b, size_t n) {
+    DL_SegList *sl = DL_seglist_create_with_allocator(0, sizeof(int32_t), DL_cmp_int32, &b->allocator);
+    for (int32_t i = 0; i < (int32_t) n; i++) {
+        DL_seglist_append(sl, &i);
+    }
+    int64_t sum = 0;
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        sum += *(int32_t *) DL_seglist_get(sl, clib_bench_rand(b) % n);
+    }
+    clib_bench_stop(b, n);
+    volatile int64_t s = sum;
+    (void) s;
+    DL_seglist_free(sl);
+}
+
+// Appends from one producer thread per CPU, `n` elements in total.
+typedef struct {
+    DynList         *dl;
+    pthread_mutex_t *lock;
+    int32_t         lo, hi;
+} producer_arg;
+
+static void *produce_locked(void *arg) {
+    producer_arg *p = (producer_arg *) arg;
+    for (int32_t i = p->lo; i < p->hi; i++) {
+        pthread_mutex_lock(p->lock);
+        DL_append(p->dl, &i);
+        pthread_mutex_unlock(p->lock);
+    }
+    return NULL;
+}
+
+static void *produce_concurrent(void *arg) {
+    producer_arg *p = (producer_arg *) arg;
+    for (int32_t i = p->lo; i < p->hi; i++) {
+        DL_append_concurrent(p->dl, &i);
+    }
+    return NULL;
+}
+
+static void run_producers(CLIB_Bench *b, size_t n, int concurrent) {
+    DynList *dl = create(b, 0);
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpu < 1 ? 1 : ncpu > 64 ? 64 : (int) ncpu;
+    pthread_t threads[64];
+    producer_arg args[64];
+
+    clib_bench_start(b);
+    if (concurrent) {
+        DL_begin_concurrent(dl);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        args[i] = (producer_arg) { dl, &lock, (int32_t) (n * i / nthreads), (int32_t) (n * (i + 1) / nthreads) };
+        pthread_create(&threads[i], NULL, concurrent ? produce_concurrent : produce_locked, &args[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    if (concurrent) {
+        DL_end_concurrent(dl);
+    }
+    clib_bench_stop(b, n);
+
+    if ((size_t) DL_size(dl) != n) {
+        fprintf(stderr, "Append failed: %d of %zu elements.\n", DL_size(dl), n);
+    }
+    DL_free(dl);
+}
+
+static void bench_append_locked_all(CLIB_Bench *b, size_t n) {
+    run_producers(b, n, 0);
+}
+
+static void bench_append_concurrent_all(CLIB_Bench *b, size_t n) {
+    run_producers(b, n, 1);
+}
+
+static void bench_insert_front(CLIB_Bench *b, size_t n) {
+    DynList *dl = create(b, 0);
+    clib_bench_start(b);
+    for (int32_t i = 0; i < (int32_t) n; i++) {
+        DL_insert(dl, &i, 0);
+    }
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+// A work queue at a depth of `n` elements: n times enqueue one element
+// and dequeue the oldest, with `DL_insert(dl, x, 0)` / `DL_pop_into`
+// at the end and with a deque.
+static void bench_queue_dynlist(CLIB_Bench *b, size_t n) {
+    DynList *dl = filled(b, n, gen_sorted);
+    int32_t out;
+    clib_bench_start(b);
+    for (int32_t i = 0; i < (int32_t) n; i++) {
+        DL_insert(dl, &i, 0);
+        DL_pop_into(dl, n, &out);
+    }
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+static void bench_queue_deque(CLIB_Bench *b, size_t n) {
+    DL_Deque *dq = DL_deque_create_with_allocator(0, sizeof(int32_t), DL_cmp_int32, &b->allocator);
+    for (int32_t i = 0; i < (int32_t) n; i++) {
+        DL_deque_push_back(dq, &i);
+    }
+    int32_t out;
+    clib_bench_start(b);
+    for (int32_t i = 0; i < (int32_t) n; i++) {
+        DL_deque_push_back(dq, &i);
+        DL_deque_pop_front(dq, &out);
+    }
+    clib_bench_stop(b, n);
+    DL_deque_free(dq);
+}
+
+// Priority queue of n elements (the hold model of event schedulers):
+// every step pops the smallest element and pushes a later one.
+static void run_heap(CLIB_Bench *b, size_t n, int flags) {
+    DynList *dl = filled(b, n, gen_random);
+    for (size_t i = 0; i < n; i++) {
+        *(int32_t *) DL_get(dl, i) &= 0xFFFFFF;
+    }
+    DL_Heap *h = DL_heap_from_dynlist(dl, flags);
+    size_t handle;
+    int32_t out;
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        DL_heap_pop(h, &out);
+        out += (int32_t) (clib_bench_rand(b) & 0xFFFF);
+        DL_heap_push(h, &out, flags & DL_HEAP_HANDLES ? &handle : NULL);
+    }
+    clib_bench_stop(b, n);
+    DL_heap_free(h);
+    DL_free(dl);
+}
+
+static void bench_heap_binary(CLIB_Bench *b, size_t n) {
+    run_heap(b, n, 0);
+}
+
+static void bench_heap_4ary(CLIB_Bench *b, size_t n) {
+    run_heap(b, n, DL_HEAP_4ARY);
+}
+
+static void bench_heap_4ary_handles(CLIB_Bench *b, size_t n) {
+    run_heap(b, n, DL_HEAP_4ARY | DL_HEAP_HANDLES);
+}
+
+static void bench_heapify(CLIB_Bench *b, size_t n) {
+    DynList *dl = filled(b, n, gen_random);
+    clib_bench_start(b);
+    DL_Heap *h = DL_heap_from_dynlist(dl, DL_HEAP_4ARY);
+    clib_bench_stop(b, n);
+    DL_heap_free(h);
+    DL_free(dl);
+}
+
+static void bench_pop(CLIB_Bench *b, size_t n) {
+    DynList *dl = filled(b, n, gen_sorted);
+    int32_t out;
+    clib_bench_start(b);
+    for (size_t i = n; i > 0; i--) {
+        DL_pop_into(dl, i - 1, &out);
+    }
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+// Extends a list with n elements from lists of 1000 elements each.
+static void bench_extend(CLIB_Bench *b, size_t n) {
+    DynList *src = filled(b, 1000, gen_sorted);
+    DynList *dl  = create(b, 0);
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i += 1000) {
+        DL_extend(dl, src);
+    }
+    clib_bench_stop(b, n);
+    DL_free(src);
+    DL_free(dl);
+}
+
+static void run_sort(CLIB_Bench *b, size_t n, int32_t (*gen)(CLIB_Bench *b, size_t i, size_t n), int flags) {
+    DynList *dl = filled(b, n, gen);
+    clib_bench_start(b);
+    DL_sort_ex(dl, flags);
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+static void bench_sort_random(CLIB_Bench *b, size_t n) {
+    run_sort(b, n, gen_random, DL_SORT_STABLE);
+}
+
+static void bench_sort_sorted(CLIB_Bench *b, size_t n) {
+    run_sort(b, n, gen_sorted, DL_SORT_STABLE);
+}
+
+static void bench_sort_reversed(CLIB_Bench *b, size_t n) {
+    run_sort(b, n, gen_reversed, DL_SORT_STABLE);
+}
+
+static void bench_sort_few_unique(CLIB_Bench *b, size_t n) {
+    run_sort(b, n, gen_few_unique, DL_SORT_STABLE);
+}
+
+static void bench_sort_unstable(CLIB_Bench *b, size_t n) {
+    run_sort(b, n, gen_random, DL_SORT_UNSTABLE);
+}
+
+// libc's qsort on the same inputs, as the baseline for DL_sort.
+static int qsort_cmp_int32(const void *a, const void *b) {
+    int32_t x = *(const int32_t *) a;
+    int32_t y = *(const int32_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void run_qsort(CLIB_Bench *b, size_t n, int32_t (*gen)(CLIB_Bench *b, size_t i, size_t n)) {
+    DynList *dl = filled(b, n, gen);
+    clib_bench_start(b);
+    qsort(dl->data, dl->size, dl->stride, qsort_cmp_int32);
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+static void bench_sort_qsort_random(CLIB_Bench *b, size_t n) {
+    run_qsort(b, n, gen_random);
+}
+
+static void bench_sort_qsort_sorted(CLIB_Bench *b, size_t n) {
+    run_qsort(b, n, gen_sorted);
+}
+
+static void bench_sort_qsort_reversed(CLIB_Bench *b, size_t n) {
+    run_qsort(b, n, gen_reversed);
+}
+
+static void bench_sort_qsort_few_unique(CLIB_Bench *b, size_t n) {
+    run_qsort(b, n, gen_few_unique);
+}
+
+static void run_sort_parallel(CLIB_Bench *b, size_t n, int nthreads) {
+    DynList *dl = filled(b, n, gen_random);
+    clib_bench_start(b);
+    DL_sort_parallel(dl, nthreads);
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+static void bench_sort_parallel_2(CLIB_Bench *b, size_t n) {
+    run_sort_parallel(b, n, 2);
+}
+
+static void bench_sort_parallel_4(CLIB_Bench *b, size_t n) {
+    run_sort_parallel(b, n, 4);
+}
+
+static void bench_sort_parallel_8(CLIB_Bench *b, size_t n) {
+    run_sort_parallel(b, n, 8);
+}
+
+static void bench_sort_parallel_all(CLIB_Bench *b, size_t n) {
+    run_sort_parallel(b, n, 0);
+}
+
+static void bench_sort_radix(CLIB_Bench *b, size_t n) {
+    DynList *dl = filled(b, n, gen_random);
+    clib_bench_start(b);
+    DL_sort_by_offset(dl, 0, DL_KEY_I32);
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+// Scans over an unsorted list, ops are elements scanned.
+static void bench_count(CLIB_Bench *b, size_t n) {
+    DynList *dl = filled(b, n, gen_few_unique);
+    int32_t x = 3;
+    clib_bench_start(b);
+    volatile int c = DL_count(dl, &x);
+    (void) c;
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+static void bench_index_missing(CLIB_Bench *b, size_t n) {
+    DynList *dl = filled(b, n, gen_few_unique);
+    int32_t x = 100;
+    clib_bench_start(b);
+    volatile int c = DL_index(dl, &x);
+    (void) c;
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+static int is_small(void *elem, void *ctx) {
+    return *(int32_t *) elem < 8;
+}
+
+static void run_count_if(CLIB_Bench *b, size_t n, int nthreads) {
+    DynList *dl = filled(b, n, gen_few_unique);
+    clib_bench_start(b);
+    volatile int c = DL_count_if(dl, is_small, NULL, nthreads);
+    (void) c;
+    clib_bench_stop(b, n);
+    DL_free(dl);
+}
+
+static void bench_count_if(CLIB_Bench *b, size_t n) {
+    run_count_if(b, n, 1);
+}
+
+static void bench_count_if_parallel(CLIB_Bench *b, size_t n) {
+    run_count_if(b, n, 0);
+}
+
+int main(int argc, char **argv) {
+    static const struct {
+        const char *name;
+        void (*fn)(CLIB_Bench *b, size_t n);
+        size_t max_n;
+    } benchmarks[] = {
+        { "append",                bench_append,                SIZE_MAX },
+        { "append_seglist",        bench_append_seglist,        SIZE_MAX },
+        { "get_random",            bench_get_random,            SIZE_MAX },
+        { "get_random_seglist",    bench_get_random_seglist,    SIZE_MAX },
+        { "append_locked_all",     bench_append_locked_all,     SIZE_MAX },
+        { "append_concurrent_all", bench_append_concurrent_all, SIZE_MAX },
+        { "insert_front",          bench_insert_front,          QUADRATIC_MAX_N },
+        { "queue_dynlist",         bench_queue_dynlist,         QUADRATIC_MAX_N },
+        { "queue_deque",           bench_queue_deque,           SIZE_MAX },
+        { "heap_binary",           bench_heap_binary,           SIZE_MAX },
+        { "heap_4ary",             bench_heap_4ary,             SIZE_MAX },
+        { "heap_4ary_handles",     bench_heap_4ary_handles,     SIZE_MAX },
+        { "heapify",               bench_heapify,               SIZE_MAX },
+        { "pop",                   bench_pop,                   SIZE_MAX },
+        { "extend",                bench_extend,                SIZE_MAX },
+        { "sort_random",           bench_sort_random,           SIZE_MAX },
+        { "sort_sorted",           bench_sort_sorted,           SIZE_MAX },
+        { "sort_reversed",         bench_sort_reversed,         SIZE_MAX },
+        { "sort_few_unique",       bench_sort_few_unique,       SIZE_MAX },
+        { "sort_unstable",         bench_sort_unstable,         SIZE_MAX },
+        { "sort_qsort_random",     bench_sort_qsort_random,     SIZE_MAX },
+        { "sort_qsort_sorted",     bench_sort_qsort_sorted,     SIZE_MAX },
+        { "sort_qsort_reversed",   bench_sort_qsort_reversed,   SIZE_MAX },
+        { "sort_qsort_few_unique", bench_sort_qsort_few_unique, SIZE_MAX },
+        { "sort_parallel_2",       bench_sort_parallel_2,       SIZE_MAX },
+        { "sort_parallel_4",       bench_sort_parallel_4,       SIZE_MAX },
+        { "sort_parallel_8",       bench_sort_parallel_8,       SIZE_MAX },
+        { "sort_parallel_all",     bench_sort_parallel_all,     SIZE_MAX },
+        { "sort_radix",            bench_sort_radix,            SIZE_MAX },
+        { "count",                 bench_count,                 SIZE_MAX },
+        { "count_if",              bench_count_if,              SIZE_MAX },
+        { "count_if_parallel",     bench_count_if_parallel,     SIZE_MAX },
+        { "index_missing",         bench_index_missing,         SIZE_MAX },
+    };
+
+    CLIB_Bench b;
+    clib_bench_init(&b, "DynList", argc, argv);
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        for (size_t n = 1000; n <= b.max_n && n <= benchmarks[i].max_n; n *= 10) {
+            clib_bench_run(&b, benchmarks[i].name, n, benchmarks[i].fn);
+        }
+    }
+    clib_bench_finish(&b);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,396 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+* Concurrent append mode. Appenders reserve their slots with an atomic
+* fetch-add on `size` and copy their elements without any lock.
+*
+* Elements never move while the mode is active: `data` becomes chunk 0,
+* of `base` elements (a power of two), of the geometric chunks described
+* in dynlist_internal.h. Chunks are allocated in order by whichever
+* appender first needs them, under a lock that is only taken for that.
+*
+* `DL_publish` finds out how many elements are complete: appenders
+* register in one of two counters per thread slot, chosen by the
+* parity of the current epoch, before reserving. Publishing reads
+* `size`, advances the epoch and waits for the counters of the old
+* parity to drain; every slot reserved before is then written.
+*/
+
+// Appender counters are spread over this many slots to keep threads on
+// different cores from contending on one cache line.
+#define CONC_SLOTS 64
+#define CACHE_LINE 64
+#define MAX_CHUNKS 64
+// Smallest number of elements of chunk 0.
+#define MIN_BASE 64
+
+typedef struct {
+    atomic_long appenders[2];
+    char        pad[CACHE_LINE - 2 * sizeof(atomic_long)];
+} conc_slot;
+
+struct DL_Concurrent {
+    conc_slot slots[CONC_SLOTS];
+    atomic_ulong epoch;
+    // Chunk k > 0 holds the elements from `base << (k - 1)` on.
+    // Chunk 0 is `data`.
+    _Atomic(char *) chunks[MAX_CHUNKS];
+    unsigned int base_shift;
+    // Elements at or beyond `limit` have no storage: the chunk holding
+    // them could not be allocated, or would overflow.
+    atomic_size_t limit;
+    // Number of complete elements found by the last `DL_publish`.
+    atomic_size_t published;
+    // Size when the mode was entered, to check the order of new elements.
+    size_t initial_size;
+    // Serializes chunk allocation, and `DL_publish` calls.
+    pthread_mutex_t chunk_lock;
+    pthread_mutex_t publish_lock;
+};
+
+static atomic_uint next_slot;
+static _Thread_local unsigned thread_slot;
+
+static inline unsigned int chunk_of(DL_Concurrent *c, size_t index) {
+    return dl_chunk_of(c->base_shift, index);
+}
+
+static inline size_t chunk_start(DL_Concurrent *c, unsigned int k) {
+    return dl_chunk_start(c->base_shift, k);
+}
+
+static inline size_t chunk_end(DL_Concurrent *c, unsigned int k) {
+    return dl_chunk_end(c->base_shift, k);
+}
+
+/**
+* `chunk_bytes` returns the size of chunk `k > 0` in bytes.
+*/
+static inline size_t chunk_bytes(DynList *dl, unsigned int k) {
+    return dl->stride << (dl->concurrent->base_shift + k - 1);
+}
+
+/**
+* `get_chunk` returns chunk `k`, allocating it and all chunks before it
+* if needed. Returns NULL if it has no storage.
+*/
+static char *get_chunk(DynList *dl, unsigned int k, const char *caller) {
+    DL_Concurrent *c = dl->concurrent;
+    char *chunk = atomic_load_explicit(&c->chunks[k], memory_order_acquire);
+    if (chunk != NULL) {
+        return chunk;
+    }
+
+    pthread_mutex_lock(&c->chunk_lock);
+    for (unsigned int i = 1; i <= k; i++) {
+        if (atomic_load_explicit(&c->chunks[i], memory_order_relaxed) != NULL) {
+            continue;
+        }
+        if (chunk_start(c, i) >= atomic_load(&c->limit)) {
+            CLIB_FAIL(CLIB_EOVERFLOW, "%s error: list exceeds the addressable size.", caller);
+            break;
+        }
+        char *p = (char *) dl->allocator.alloc(dl->allocator.ctx, chunk_bytes(dl, i));
+        if (p == NULL) {
+            CLIB_FAIL(CLIB_ENOMEM, "%s error: failed to allocate a chunk of %zu bytes.", caller, chunk_bytes(dl, i));
+            atomic_store(&c->limit, chunk_start(c, i));
+            break;
+        }
+        atomic_store_explicit(&c->chunks[i], p, memory_order_release);
+    }
+    chunk = atomic_load_explicit(&c->chunks[k], memory_order_relaxed);
+    pthread_mutex_unlock(&c->chunk_lock);
+
+    return chunk;
+}
+
+/**
+* `enter` registers the calling thread as an appender under the current
+* epoch and returns the counter to pass to `leave`.
+*/
+static atomic_long *enter(DL_Concurrent *c) {
+    if (thread_slot == 0) {
+        thread_slot = atomic_fetch_add(&next_slot, 1) % CONC_SLOTS + 1;
+    }
+    conc_slot *slot = &c->slots[thread_slot - 1];
+    for (;;) {
+        unsigned long e = atomic_load(&c->epoch);
+        atomic_fetch_add(&slot->appenders[e & 1], 1);
+        // A `DL_publish` in between may have waited for the counter
+        // before it was incremented: register again under the new epoch.
+        if (atomic_load(&c->epoch) == e) {
+            return &slot->appenders[e & 1];
+        }
+        atomic_fetch_sub(&slot->appenders[e & 1], 1);
+    }
+}
+
+static void leave(atomic_long *counter) {
+    atomic_fetch_sub_explicit(counter, 1, memory_order_release);
+}
+
+/**
+* `DL_begin_concurrent` switches `dl` to concurrent append mode, in
+* which any number of threads may append with `DL_append_concurrent`
+* and `DL_append_n_concurrent`, and read complete elements with
+* `DL_get_concurrent`. No other function may be called on `dl` until
+* `DL_end_concurrent`. Heap lists only; the allocator must be
+* thread-safe.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_begin_concurrent(DynList *dl) {
+    if (dl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_begin_concurrent error: provided DynList is NULL.");
+        return -1;
+    }
+    if (dl->concurrent != NULL) {
+        return 0;
+    }
+    if (dl->mapping != NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_begin_concurrent error: file backed lists can't be appended to concurrently.");
+        return -1;
+    }
+
+    unsigned int base_shift = 0;
+    while (((size_t) 1 << base_shift) < MIN_BASE || ((size_t) 1 << base_shift) < dl->capacity) {
+        base_shift++;
+    }
+    if (base_shift >= 63 || DL_reserve(dl, (size_t) 1 << base_shift) != 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_begin_concurrent error: failed to allocate memory.");
+        return -1;
+    }
+
+    DL_Concurrent *c = (DL_Concurrent *) dl->allocator.alloc(dl->allocator.ctx, sizeof(DL_Concurrent));
+    if (c == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_begin_concurrent error: failed to allocate memory.");
+        return -1;
+    }
+    memset(c, 0, sizeof(DL_Concurrent));
+    for (int i = 0; i < CONC_SLOTS; i++) {
+        atomic_init(&c->slots[i].appenders[0], 0);
+        atomic_init(&c->slots[i].appenders[1], 0);
+    }
+    atomic_init(&c->epoch, 0);
+    for (int i = 0; i < MAX_CHUNKS; i++) {
+        atomic_init(&c->chunks[i], NULL);
+    }
+    atomic_init(&c->chunks[0], dl->data);
+    c->base_shift = base_shift;
+
+    // The last chunk must fit into the address space.
+    size_t limit = SIZE_MAX;
+    for (unsigned int k = 1; k < MAX_CHUNKS; k++) {
+        if (base_shift + k > 63 || ((size_t) 1 << (base_shift + k - 1)) > SIZE_MAX / dl->stride) {
+            limit = chunk_start(c, k);
+            break;
+        }
+    }
+    atomic_init(&c->limit, limit);
+    atomic_init(&c->published, dl->size);
+    c->initial_size = dl->size;
+
+    if (pthread_mutex_init(&c->chunk_lock, NULL) != 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_begin_concurrent error: failed to create a lock.");
+        dl->allocator.free(dl->allocator.ctx, c, sizeof(DL_Concurrent));
+        return -1;
+    }
+    if (pthread_mutex_init(&c->publish_lock, NULL) != 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_begin_concurrent error: failed to create a lock.");
+        pthread_mutex_destroy(&c->chunk_lock);
+        dl->allocator.free(dl->allocator.ctx, c, sizeof(DL_Concurrent));
+        return -1;
+    }
+
+    dl->concurrent = c;
+    return 0;
+}
+
+/**
+* `DL_append_n_concurrent` appends `count` contiguous elements as one
+* block: they end up next to each other, in order. Thread-safe in
+* concurrent append mode. If the list runs out of storage, only the
+* elements that still fit are appended and -1 is returned.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_append_n_concurrent(DynList *dl, void *elements, size_t count) {
+    if (dl == NULL || dl->concurrent == NULL || (elements == NULL && count > 0)) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_append_n_concurrent error: DynList is NULL or not in concurrent mode.");
+        return -1;
+    }
+
+    DL_Concurrent *c = dl->concurrent;
+    atomic_long *counter = enter(c);
+
+    size_t index = __atomic_fetch_add(&dl->size, count, __ATOMIC_SEQ_CST);
+    size_t end = count > SIZE_MAX - index ? SIZE_MAX : index + count;
+    const char *src = (const char *) elements;
+    int rc = 0;
+
+    while (index < end) {
+        unsigned int k = chunk_of(c, index);
+        char *chunk = get_chunk(dl, k, "DL_append_n_concurrent");
+        if (chunk == NULL) {
+            rc = -1;
+            break;
+        }
+        size_t start = chunk_start(c, k);
+        size_t n = (end < chunk_end(c, k) ? end : chunk_end(c, k)) - index;
+
+        if (n == 1) {
+            copy_elem(chunk + (index - start) * dl->stride, src, dl->stride);
+        } else {
+            memcpy(chunk + (index - start) * dl->stride, src, n * dl->stride);
+        }
+        src   += n * dl->stride;
+        index += n;
+    }
+
+    leave(counter);
+    return rc;
+}
+
+/**
+* `DL_append_concurrent` appends a single element. Thread-safe in
+* concurrent append mode.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_append_concurrent(DynList *dl, void *element) {
+    if (element == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_append_concurrent error: element is NULL.");
+        return -1;
+    }
+    return DL_append_n_concurrent(dl, element, 1);
+}
+
+/**
+* `DL_publish` waits until all appends that have reserved their slots
+* are done, and returns the number of elements before the first slot
+* that may still be written to. Elements below are complete and are
+* never moved or changed in concurrent append mode, so they can be
+* read with `DL_get_concurrent` by any thread while appends go on.
+* Never waits for appends started later. Thread-safe.
+* Returns -1 on failure.
+*/
+long DL_publish(DynList *dl) {
+    if (dl == NULL || dl->concurrent == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_publish error: DynList is NULL or not in concurrent mode.");
+        return -1;
+    }
+
+    DL_Concurrent *c = dl->concurrent;
+    pthread_mutex_lock(&c->publish_lock);
+
+    size_t reserved = __atomic_load_n(&dl->size, __ATOMIC_SEQ_CST);
+    unsigned long e = atomic_fetch_add(&c->epoch, 1);
+    for (int i = 0; i < CONC_SLOTS; i++) {
+        while (atomic_load(&c->slots[i].appenders[e & 1]) != 0) {
+            sched_yield();
+        }
+    }
+
+    size_t limit = atomic_load(&c->limit);
+    size_t n = reserved < limit ? reserved : limit;
+    if (n > atomic_load(&c->published)) {
+        atomic_store_explicit(&c->published, n, memory_order_release);
+    }
+    n = atomic_load(&c->published);
+    pthread_mutex_unlock(&c->publish_lock);
+
+    return (long) n;
+}
+
+/**
+* `DL_get_concurrent` returns a pointer to the element at `index`,
+* which must be below the count returned by the last `DL_publish`.
+* The pointer stays valid until `DL_end_concurrent`. Thread-safe.
+*/
+void *DL_get_concurrent(DynList *dl, size_t index) {
+    if (dl == NULL || dl->concurrent == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_get_concurrent error: DynList is NULL or not in concurrent mode.");
+        return NULL;
+    }
+
+    DL_Concurrent *c = dl->concurrent;
+    if (index >= atomic_load_explicit(&c->published, memory_order_acquire)) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_get_concurrent error: index %zu is not published.", index);
+        return NULL;
+    }
+
+    unsigned int k = chunk_of(c, index);
+    char *chunk = atomic_load_explicit(&c->chunks[k], memory_order_acquire);
+    return chunk + (index - chunk_start(c, k)) * dl->stride;
+}
+
+/**
+* `dl_concurrent_free` releases the chunks and the state of the
+* concurrent append mode.
+*/
+void dl_concurrent_free(DynList *dl) {
+    DL_Concurrent *c = dl->concurrent;
+    for (unsigned int k = 1; k < MAX_CHUNKS; k++) {
+        char *chunk = atomic_load(&c->chunks[k]);
+        if (chunk != NULL) {
+            dl->allocator.free(dl->allocator.ctx, chunk, chunk_bytes(dl, k));
+        }
+    }
+    pthread_mutex_destroy(&c->chunk_lock);
+    pthread_mutex_destroy(&c->publish_lock);
+    dl->allocator.free(dl->allocator.ctx, c, sizeof(DL_Concurrent));
+    dl->concurrent = NULL;
+}
+
+/**
+* `DL_end_concurrent` leaves concurrent append mode once all appends
+* are done: the chunks are copied behind `data` (one reallocation and
+* one copy of the elements appended beyond chunk 0), and `dl` becomes a
+* regular list again. Must not run concurrently with any other call on
+* `dl`. On failure the list stays in concurrent append mode.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_end_concurrent(DynList *dl) {
+    if (dl == NULL || dl->concurrent == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_end_concurrent error: DynList is NULL or not in concurrent mode.");
+        return -1;
+    }
+
+    DL_Concurrent *c = dl->concurrent;
+    size_t limit = atomic_load(&c->limit);
+    size_t size = dl->size < limit ? dl->size : limit;
+
+    unsigned int last = 0;
+    for (unsigned int k = 1; k < MAX_CHUNKS; k++) {
+        if (atomic_load(&c->chunks[k]) != NULL) {
+            last = k;
+        }
+    }
+
+    // Chunks 0 to `last` together hold `base << last` elements.
+    if (last > 0) {
+        size_t base = (size_t) 1 << c->base_shift;
+        if (DL_reserve(dl, base << last) != 0) {
+            return -1;
+        }
+        for (unsigned int k = 1; k <= last; k++) {
+            size_t start = chunk_start(c, k);
+            if (start >= size) {
+                break;
+            }
+            size_t n = (size < chunk_end(c, k) ? size : chunk_end(c, k)) - start;
+            memcpy(dl->data + start * dl->stride, atomic_load(&c->chunks[k]), n * dl->stride);
+        }
+    }
+
+    dl->size = size;
+    if (dl->sorted && (dl->compare_to == NULL || !dl_range_in_order(dl, c->initial_size, size))) {
+        dl->sorted = 0;
+    }
+    dl_concurrent_free(dl);
+
+    return 0;
+}
@@ -0,0 +1,327 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+* Double-ended queue on a ring buffer. The elements are stored like in
+* a DynList, but start at `head` and wrap around the end of `data`, so
+* elements are added and removed at both ends without moving the others.
+*/
+
+/**
+* `slot` returns the position in `data` of the element at `index`.
+*/
+static inline size_t slot(DL_Deque *dq, size_t index) {
+    size_t i = dq->head + index;
+    return i >= dq->capacity ? i - dq->capacity : i;
+}
+
+/**
+* `set_capacity` reallocates `data` to hold `capacity >= size` elements
+* and moves the elements behind the end of the old buffer (if they wrap
+* around) to the end of the new one.
+* Returns 0 on success, -1 otherwise.
+*/
+static int set_capacity(DL_Deque *dq, size_t capacity, const char *caller) {
+    if (capacity > SIZE_MAX / dq->stride) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "%s error: capacity of %zu elements overflows.", caller, capacity);
+        return -1;
+    }
+
+    CLIB_Allocator *a = &dq->allocator;
+    char *data = (char *) a->realloc(a->ctx, dq->data, dq->capacity * dq->stride, capacity * dq->stride);
+    if (data == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "%s failed to reallocate memory to change capacity of DL_Deque: %s", caller, strerror(errno));
+        return -1;
+    }
+
+    if (dq->head + dq->size > dq->capacity) {
+        size_t n = dq->capacity - dq->head;
+        memmove(data + (capacity - n) * dq->stride, data + dq->head * dq->stride, n * dq->stride);
+        dq->head = capacity - n;
+    }
+    dq->data     = data;
+    dq->capacity = capacity;
+
+    return 0;
+}
+
+/**
+* `grow` doubles the capacity of a full deque.
+* Returns 0 on success, -1 otherwise.
+*/
+static int grow(DL_Deque *dq, const char *caller) {
+    if (dq->size < dq->capacity) {
+        return 0;
+    }
+    if (dq->capacity > SIZE_MAX / 2) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "%s error: DL_Deque is too large to grow.", caller);
+        return -1;
+    }
+    return set_capacity(dq, dq->capacity > 0 ? 2 * dq->capacity : DEFAULT_CAPACITY, caller);
+}
+
+/**
+* `DL_deque_create` creates an empty deque with room for `capacity`
+* elements of `stride` bytes. In case of allocation failure it returns
+* `NULL`.
+*/
+DL_Deque *DL_deque_create(size_t capacity, size_t stride, int (*compare_to)(void *elem1, void *elem2)) {
+    return DL_deque_create_with_allocator(capacity, stride, compare_to, NULL);
+}
+
+/**
+* `DL_deque_create_with_allocator` works like `DL_deque_create`, but all
+* memory is obtained from `allocator` (malloc/realloc/free if `NULL`).
+*/
+DL_Deque *DL_deque_create_with_allocator(size_t capacity, size_t stride,
+                                         int (*compare_to)(void *elem1, void *elem2),
+                                         const CLIB_Allocator *allocator) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    if (stride == 0 || capacity > SIZE_MAX / stride) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_deque_create error: invalid stride or capacity.");
+        return NULL;
+    }
+
+    DL_Deque *dq = (DL_Deque *) a.alloc(a.ctx, sizeof(DL_Deque));
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "Error allocating memory for DL_Deque struct: %s", strerror(errno));
+        return NULL;
+    }
+
+    memset(dq, 0, sizeof(DL_Deque));
+    dq->capacity   = capacity;
+    dq->stride     = stride;
+    dq->compare_to = compare_to;
+    dq->allocator  = a;
+
+    dq->data = (char *) a.alloc(a.ctx, capacity * stride);
+    if (dq->data == NULL && capacity > 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "Error allocating memory for DL_Deque data: %s", strerror(errno));
+        a.free(a.ctx, dq, sizeof(DL_Deque));
+        return NULL;
+    }
+
+    return dq;
+}
+
+/**
+* `DL_deque_from_dynlist` turns the elements of `dl` into a deque in
+* O(1): the deque takes over the data of `dl`, which is left empty
+* (without capacity) but valid. Heap lists only.
+* Returns NULL on failure.
+*/
+DL_Deque *DL_deque_from_dynlist(DynList *dl) {
+    if (dl == NULL || dl->mapping != NULL || dl->concurrent != NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_deque_from_dynlist error: DynList is NULL, file backed or in concurrent mode.");
+        return NULL;
+    }
+
+    DL_Deque *dq = DL_deque_create_with_allocator(0, dl->stride, dl->compare_to, &dl->allocator);
+    if (dq == NULL) {
+        return NULL;
+    }
+    if (dq->data != NULL) {
+        dq->allocator.free(dq->allocator.ctx, dq->data, 0);
+    }
+    dq->data     = dl->data;
+    dq->capacity = dl->capacity;
+    dq->size     = dl->size;
+
+    dl->data     = NULL;
+    dl->capacity = 0;
+    dl->size     = 0;
+
+    return dq;
+}
+
+/**
+* `DL_deque_to_dynlist` returns a new DynList (capacity = size) with
+* the elements of `dq` from front to back.
+* Returns NULL on failure.
+*/
+DynList *DL_deque_to_dynlist(DL_Deque *dq) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_deque_to_dynlist error: provided DL_Deque is NULL.");
+        return NULL;
+    }
+
+    DynList *dl = DL_create_with_allocator(dq->size, dq->stride, dq->compare_to, &dq->allocator);
+    if (dl == NULL) {
+        return NULL;
+    }
+
+    size_t first = dq->capacity - dq->head < dq->size ? dq->capacity - dq->head : dq->size;
+    if (first > 0) {
+        memcpy(dl->data, dq->data + dq->head * dq->stride, first * dq->stride);
+    }
+    if (dq->size > first) {
+        memcpy(dl->data + first * dq->stride, dq->data, (dq->size - first) * dq->stride);
+    }
+    dl->size = dq->size;
+
+    return dl;
+}
+
+/**
+* `DL_deque_free` frees the deque and its data.
+*/
+void DL_deque_free(DL_Deque *dq) {
+    if (dq == NULL) {
+        return;
+    }
+
+    CLIB_Allocator a = dq->allocator;
+    if (dq->data != NULL) {
+        a.free(a.ctx, dq->data, dq->capacity * dq->stride);
+    }
+    a.free(a.ctx, dq, sizeof(DL_Deque));
+}
+
+/**
+* `DL_deque_push_back` appends a copy of `element` behind the last
+* element. Only allocates if the deque is full, then doubles its
+* capacity.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_deque_push_back(DL_Deque *dq, void *element) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Deque was given to DL_deque_push_back.");
+        return -1;
+    }
+    if (grow(dq, "DL_deque_push_back") != 0) {
+        return -1;
+    }
+
+    copy_elem(dq->data + slot(dq, dq->size) * dq->stride, element, dq->stride);
+    dq->size++;
+
+    return 0;
+}
+
+/**
+* `DL_deque_push_front` inserts a copy of `element` before the first
+* element. Only allocates if the deque is full, then doubles its
+* capacity.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_deque_push_front(DL_Deque *dq, void *element) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Deque was given to DL_deque_push_front.");
+        return -1;
+    }
+    if (grow(dq, "DL_deque_push_front") != 0) {
+        return -1;
+    }
+
+    dq->head = dq->head > 0 ? dq->head - 1 : dq->capacity - 1;
+    copy_elem(dq->data + dq->head * dq->stride, element, dq->stride);
+    dq->size++;
+
+    return 0;
+}
+
+/**
+* `DL_deque_pop_front` removes the first element and copies it into
+* `out`, unless `out` is NULL.
+* Returns 0 on success, -1 if the deque is empty.
+*/
+int DL_deque_pop_front(DL_Deque *dq, void *out) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Deque was given to DL_deque_pop_front.");
+        return -1;
+    }
+    if (dq->size == 0) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_deque_pop_front error: DL_Deque is empty.");
+        return -1;
+    }
+
+    if (out != NULL) {
+        copy_elem(out, dq->data + dq->head * dq->stride, dq->stride);
+    }
+    dq->head = slot(dq, 1);
+    dq->size--;
+
+    return 0;
+}
+
+/**
+* `DL_deque_pop_back` removes the last element and copies it into
+* `out`, unless `out` is NULL.
+* Returns 0 on success, -1 if the deque is empty.
+*/
+int DL_deque_pop_back(DL_Deque *dq, void *out) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Deque was given to DL_deque_pop_back.");
+        return -1;
+    }
+    if (dq->size == 0) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_deque_pop_back error: DL_Deque is empty.");
+        return -1;
+    }
+
+    dq->size--;
+    if (out != NULL) {
+        copy_elem(out, dq->data + slot(dq, dq->size) * dq->stride, dq->stride);
+    }
+
+    return 0;
+}
+
+/**
+* `DL_deque_get` returns a pointer to the element at `index`, counted
+* from the front (0) to the back (size - 1).
+*/
+void *DL_deque_get(DL_Deque *dq, size_t index) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Deque was given to DL_deque_get.");
+        return NULL;
+    }
+    if (index >= dq->size) {
+        CLIB_FAIL(CLIB_ERANGE, "Index out of bounds for DL_deque_get: index=%zu, size=%zu", index, dq->size);
+        return NULL;
+    }
+
+    return dq->data + slot(dq, index) * dq->stride;
+}
+
+/**
+* `DL_deque_size` returns the number of elements in `dq`.
+*/
+long DL_deque_size(DL_Deque *dq) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Deque was given to DL_deque_size.");
+        return -1;
+    }
+    return (long) dq->size;
+}
+
+/**
+* `DL_deque_clear` removes all elements. The capacity remains unchanged.
+*/
+void DL_deque_clear(DL_Deque *dq) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Deque was given to DL_deque_clear.");
+        return;
+    }
+    dq->head = 0;
+    dq->size = 0;
+}
+
+/**
+* `DL_deque_reserve` makes sure `dq` can hold at least `capacity`
+* elements without reallocating. The capacity is never reduced.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_deque_reserve(DL_Deque *dq, size_t capacity) {
+    if (dq == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_deque_reserve error: provided DL_Deque is NULL.");
+        return -1;
+    }
+    if (capacity <= dq->capacity) {
+        return 0;
+    }
+    return set_capacity(dq, capacity, "DL_deque_reserve");
+}
@@ -0,0 +1,233 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+* Bulk operations with user callbacks. With `nthreads != 1` the list is
+* cut into one contiguous chunk per thread, the chunks are processed on
+* the shared worker pool and the per-chunk results are combined in
+* chunk order afterwards. Callbacks must then be safe to call from
+* several threads at once.
+*/
+
+// Each thread gets at least this many elements.
+#define FUNC_MIN_CHUNK 4096
+// Partial accumulators start on their own cache lines to avoid false
+// sharing: they are placed a multiple of CACHE_LINE bytes apart in a
+// buffer aligned to CACHE_LINE.
+#define CACHE_LINE 64
+
+typedef struct {
+    DynList *dl;
+    int     nthreads;
+    void    *ctx;
+    void    (*fn)(void *elem, void *ctx);
+    int     (*pred)(void *elem, void *ctx);
+    void    (*step)(void *acc, void *elem, void *ctx);
+    // Per-chunk results: counts, or partial accumulators of `acc_size`
+    // bytes placed `acc_stride` bytes apart.
+    size_t  *counts;
+    char    *accs;
+    size_t  acc_size;
+    size_t  acc_stride;
+    // `DL_filter_into` writes the matches of a chunk to `out`, starting
+    // at the position of the chunk's first element.
+    char    *out;
+} func_state;
+
+static inline void chunk_of(func_state *f, int id, size_t *lo, size_t *hi) {
+    *lo = f->dl->size * id / f->nthreads;
+    *hi = f->dl->size * (id + 1) / f->nthreads;
+}
+
+static void for_each_job(void *arg, int id) {
+    func_state *f = (func_state *) arg;
+    size_t lo, hi;
+    chunk_of(f, id, &lo, &hi);
+    for (size_t i = lo; i < hi; i++) {
+        f->fn(f->dl->data + i * f->dl->stride, f->ctx);
+    }
+}
+
+static void count_if_job(void *arg, int id) {
+    func_state *f = (func_state *) arg;
+    size_t lo, hi, n = 0;
+    chunk_of(f, id, &lo, &hi);
+    for (size_t i = lo; i < hi; i++) {
+        n += f->pred(f->dl->data + i * f->dl->stride, f->ctx) != 0;
+    }
+    f->counts[id] = n;
+}
+
+static void filter_job(void *arg, int id) {
+    func_state *f = (func_state *) arg;
+    size_t stride = f->dl->stride;
+    size_t lo, hi, n = 0;
+    chunk_of(f, id, &lo, &hi);
+    char *out = f->out + lo * stride;
+    for (size_t i = lo; i < hi; i++) {
+        char *elem = f->dl->data + i * stride;
+        if (f->pred(elem, f->ctx)) {
+            copy_elem(out + n * stride, elem, stride);
+            n++;
+        }
+    }
+    f->counts[id] = n;
+}
+
+static void reduce_job(void *arg, int id) {
+    func_state *f = (func_state *) arg;
+    char *acc = f->accs + id * f->acc_stride;
+    size_t lo, hi;
+    chunk_of(f, id, &lo, &hi);
+    for (size_t i = lo; i < hi; i++) {
+        f->step(acc, f->dl->data + i * f->dl->stride, f->ctx);
+    }
+}
+
+/**
+* `DL_for_each` calls `fn(elem, ctx)` for every element of `dl`, using
+* up to `nthreads` threads (1 runs on the calling thread, `<= 0` uses
+* one per CPU). `fn` may modify the elements, so `dl` leaves sorted mode.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_for_each(DynList *dl, void (*fn)(void *elem, void *ctx), void *ctx, int nthreads) {
+    if (dl == NULL || fn == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_for_each error: provided DynList or function is NULL.");
+        return -1;
+    }
+
+    func_state f = { .dl = dl, .ctx = ctx, .fn = fn };
+    f.nthreads = dl_pool_threads(nthreads, dl->size, FUNC_MIN_CHUNK);
+    dl_pool_run(for_each_job, &f, f.nthreads);
+
+    if (dl->size > 1) {
+        dl->sorted = 0;
+    }
+
+    return 0;
+}
+
+/**
+* `DL_count_if` returns the number of elements for which
+* `pred(elem, ctx)` is non-zero, using up to `nthreads` threads
+* (see `DL_for_each`). Returns -1 on error.
+*/
+int DL_count_if(DynList *dl, int (*pred)(void *elem, void *ctx), void *ctx, int nthreads) {
+    if (dl == NULL || pred == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_count_if error: provided DynList or predicate is NULL.");
+        return -1;
+    }
+
+    size_t counts[DL_POOL_MAX_THREADS];
+    func_state f = { .dl = dl, .ctx = ctx, .pred = pred, .counts = counts };
+    f.nthreads = dl_pool_threads(nthreads, dl->size, FUNC_MIN_CHUNK);
+    dl_pool_run(count_if_job, &f, f.nthreads);
+
+    size_t n = 0;
+    for (int i = 0; i < f.nthreads; i++) {
+        n += counts[i];
+    }
+    return (int) n;
+}
+
+/**
+* `DL_filter_into` appends the elements of `src` for which
+* `pred(elem, ctx)` is non-zero to `dst`, keeping their order, using
+* up to `nthreads` threads (see `DL_for_each`). `dst` needs the same
+* stride as `src` and must be a different list. Reserves room for all
+* of `src` in `dst` up front.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_filter_into(DynList *dst, DynList *src, int (*pred)(void *elem, void *ctx), void *ctx, int nthreads) {
+    if (dst == NULL || src == NULL || pred == NULL || dst == src || dst->stride != src->stride) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_filter_into error: NULL argument, same list given twice or strides differ.");
+        return -1;
+    }
+
+    if (src->size > SIZE_MAX - dst->size || DL_reserve(dst, dst->size + src->size) != 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_filter_into error: failed to reserve space in dst.");
+        return -1;
+    }
+
+    size_t counts[DL_POOL_MAX_THREADS];
+    func_state f = { .dl = src, .ctx = ctx, .pred = pred, .counts = counts };
+    f.out      = dst->data + dst->size * dst->stride;
+    f.nthreads = dl_pool_threads(nthreads, src->size, FUNC_MIN_CHUNK);
+    dl_pool_run(filter_job, &f, f.nthreads);
+
+    // Close the gaps between the chunks' matches.
+    size_t old_size = dst->size;
+    for (int i = 0; i < f.nthreads; i++) {
+        size_t lo, hi;
+        chunk_of(&f, i, &lo, &hi);
+        memmove(dst->data + dst->size * dst->stride, f.out + lo * dst->stride, counts[i] * dst->stride);
+        dst->size += counts[i];
+    }
+
+    if (dst->sorted && !dl_range_in_order(dst, old_size, dst->size)) {
+        dst->sorted = 0;
+    }
+
+    return 0;
+}
+
+/**
+* `DL_reduce` folds the elements of `dl` into the accumulator `acc` of
+* `acc_size` bytes with `step(acc, elem, ctx)`, using up to `nthreads`
+* threads (see `DL_for_each`). On entry `acc` holds the initial value,
+* which is also where every thread's partial accumulator starts, so it
+* should be an identity of `merge`. Partials are combined in chunk
+* order with `merge(acc, partial, ctx)` into `acc`. Without `merge`
+* the fold runs on the calling thread.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_reduce(DynList *dl, void *acc, size_t acc_size,
+              void (*step)(void *acc, void *elem, void *ctx),
+              void (*merge)(void *acc, void *partial, void *ctx),
+              void *ctx, int nthreads) {
+    if (dl == NULL || acc == NULL || step == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_reduce error: provided DynList, accumulator or step function is NULL.");
+        return -1;
+    }
+
+    func_state f = { .dl = dl, .ctx = ctx, .step = step, .acc_size = acc_size };
+    f.nthreads = merge != NULL ? dl_pool_threads(nthreads, dl->size, FUNC_MIN_CHUNK) : 1;
+    if (f.nthreads == 1) {
+        f.accs = acc;
+        reduce_job(&f, 0);
+        return 0;
+    }
+
+    if (acc_size > SIZE_MAX / DL_POOL_MAX_THREADS - CACHE_LINE) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "DL_reduce error: accumulator size overflows.");
+        return -1;
+    }
+    f.acc_stride = (acc_size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+    // The allocator only guarantees malloc's alignment, so over-allocate
+    // by CACHE_LINE - 1 bytes and round the address up.
+    CLIB_Allocator *a = &dl->allocator;
+    size_t block_size = f.nthreads * f.acc_stride + CACHE_LINE - 1;
+    char *block = (char *) a->alloc(a->ctx, block_size);
+    if (block == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_reduce error: failed to allocate partial accumulators.");
+        return -1;
+    }
+    f.accs = block + (-(uintptr_t) block & (CACHE_LINE - 1));
+    for (int i = 0; i < f.nthreads; i++) {
+        memcpy(f.accs + i * f.acc_stride, acc, acc_size);
+    }
+
+    dl_pool_run(reduce_job, &f, f.nthreads);
+
+    memcpy(acc, f.accs, acc_size);
+    for (int i = 1; i < f.nthreads; i++) {
+        merge(acc, f.accs + i * f.acc_stride, ctx);
+    }
+    a->free(a->ctx, block, block_size);
+
+    return 0;
+}
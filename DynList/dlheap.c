@@ -0,0 +1,508 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+* Priority queue on the storage of a DynList: the elements are kept in
+* `data` as an implicit binary or 4-ary heap, so the smallest element
+* according to `compare_to` is at index 0 and the children of index i
+* are at `(i << shift) + 1` and following.
+*
+* With DL_HEAP_HANDLES every element gets a handle that stays the same
+* while the element moves around in the heap. `handles[i]` is the handle
+* of the element at index i and `pos[h]` the index of handle h. The
+* handles of removed elements are kept behind the live ones, at indices
+* `size` to `nhandles - 1`, and are handed out again by later pushes.
+*/
+
+/**
+* `elem` returns the address of the element at `index`.
+*/
+static inline char *elem(DL_Heap *h, size_t index) {
+    return h->data + index * h->stride;
+}
+
+/**
+* `index_capacity` returns the number of handles the index arrays hold.
+*/
+static inline size_t index_capacity(DL_Heap *h) {
+    return h->pos - h->handles;
+}
+
+/**
+* `set_handle` records that the element at `index` has the handle `handle`.
+*/
+static inline void set_handle(DL_Heap *h, size_t index, size_t handle) {
+    h->handles[index] = handle;
+    h->pos[handle]    = index;
+}
+
+/**
+* `sift_up` moves the element at `index` towards the root until its
+* parent is not larger. The element is kept in `scratch` while smaller
+* parents move down into the hole.
+*/
+static void sift_up(DL_Heap *h, size_t index) {
+    size_t handle = h->handles != NULL ? h->handles[index] : 0;
+    copy_elem(h->scratch, elem(h, index), h->stride);
+
+    while (index > 0) {
+        size_t parent = (index - 1) >> h->shift;
+        if (h->compare_to(h->scratch, elem(h, parent)) >= 0) {
+            break;
+        }
+        copy_elem(elem(h, index), elem(h, parent), h->stride);
+        if (h->handles != NULL) {
+            set_handle(h, index, h->handles[parent]);
+        }
+        index = parent;
+    }
+
+    copy_elem(elem(h, index), h->scratch, h->stride);
+    if (h->handles != NULL) {
+        set_handle(h, index, handle);
+    }
+}
+
+/**
+* `sift_down` moves the element at `index` towards the leaves until none
+* of its children is smaller, moving the smallest child up each step.
+*/
+static void sift_down(DL_Heap *h, size_t index) {
+    size_t handle = h->handles != NULL ? h->handles[index] : 0;
+    size_t arity  = (size_t) 1 << h->shift;
+    copy_elem(h->scratch, elem(h, index), h->stride);
+
+    for (;;) {
+        size_t first = (index << h->shift) + 1;
+        if (first >= h->size || first <= index) {
+            break;
+        }
+        size_t end  = h->size - first > arity ? first + arity : h->size;
+        size_t best = first;
+        for (size_t c = first + 1; c < end; c++) {
+            if (h->compare_to(elem(h, c), elem(h, best)) < 0) {
+                best = c;
+            }
+        }
+        if (h->compare_to(elem(h, best), h->scratch) >= 0) {
+            break;
+        }
+        copy_elem(elem(h, index), elem(h, best), h->stride);
+        if (h->handles != NULL) {
+            set_handle(h, index, h->handles[best]);
+        }
+        index = best;
+    }
+
+    copy_elem(elem(h, index), h->scratch, h->stride);
+    if (h->handles != NULL) {
+        set_handle(h, index, handle);
+    }
+}
+
+/**
+* `sift` restores the heap order after the element at `index` changed.
+*/
+static void sift(DL_Heap *h, size_t index) {
+    if (index > 0 && h->compare_to(elem(h, index), elem(h, (index - 1) >> h->shift)) < 0) {
+        sift_up(h, index);
+    } else {
+        sift_down(h, index);
+    }
+}
+
+/**
+* `heapify` orders all elements into a heap in O(n) by sifting down
+* every parent, starting with the last one.
+*/
+static void heapify(DL_Heap *h) {
+    if (h->size < 2) {
+        return;
+    }
+    for (size_t i = ((h->size - 2) >> h->shift) + 1; i > 0; i--) {
+        sift_down(h, i - 1);
+    }
+}
+
+/**
+* `set_capacity` reallocates `data`, and the handle index if there is
+* one, to hold `capacity >= size` elements. The index is grown first and
+* keeps its size if `data` can not grow, so it is never too small.
+* Returns 0 on success, -1 otherwise.
+*/
+static int set_capacity(DL_Heap *h, size_t capacity, const char *caller) {
+    if (capacity > SIZE_MAX / h->stride || capacity > SIZE_MAX / (2 * sizeof(size_t))) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "%s error: capacity of %zu elements overflows.", caller, capacity);
+        return -1;
+    }
+
+    CLIB_Allocator *a = &h->allocator;
+    if (h->handles != NULL && capacity > index_capacity(h)) {
+        size_t old = index_capacity(h);
+        size_t *index = (size_t *) a->realloc(a->ctx, h->handles, 2 * old * sizeof(size_t),
+                                              2 * capacity * sizeof(size_t));
+        if (index == NULL) {
+            CLIB_FAIL(CLIB_ENOMEM, "%s failed to reallocate memory for DL_Heap handles: %s", caller, strerror(errno));
+            return -1;
+        }
+        memmove(index + capacity, index + old, old * sizeof(size_t));
+        h->handles = index;
+        h->pos     = index + capacity;
+    }
+
+    char *data = (char *) a->realloc(a->ctx, h->data, h->capacity * h->stride, capacity * h->stride);
+    if (data == NULL && capacity > 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "%s failed to reallocate memory to change capacity of DL_Heap: %s", caller, strerror(errno));
+        return -1;
+    }
+    h->data     = data;
+    h->capacity = capacity;
+
+    return 0;
+}
+
+/**
+* `alloc_heap` allocates an empty heap without data.
+*/
+static DL_Heap *alloc_heap(size_t stride, int (*compare_to)(void *elem1, void *elem2), int flags,
+                           const CLIB_Allocator *allocator, const char *caller) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    if (stride == 0 || stride > SIZE_MAX / 2 - sizeof(DL_Heap) || compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "%s error: invalid stride or no compare_to function.", caller);
+        return NULL;
+    }
+    if (flags & ~(DL_HEAP_4ARY | DL_HEAP_HANDLES)) {
+        CLIB_FAIL(CLIB_EINVAL, "%s error: unknown flags %d.", caller, flags);
+        return NULL;
+    }
+
+    DL_Heap *h = (DL_Heap *) a.alloc(a.ctx, sizeof(DL_Heap) + stride);
+    if (h == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "Error allocating memory for DL_Heap struct: %s", strerror(errno));
+        return NULL;
+    }
+
+    memset(h, 0, sizeof(DL_Heap));
+    h->stride     = stride;
+    h->compare_to = compare_to;
+    h->shift      = flags & DL_HEAP_4ARY ? 2 : 1;
+    h->allocator  = a;
+
+    return h;
+}
+
+/**
+* `alloc_index` allocates the handle index for `capacity` elements.
+* Returns 0 on success, -1 otherwise.
+*/
+static int alloc_index(DL_Heap *h, size_t capacity) {
+    if (capacity > SIZE_MAX / (2 * sizeof(size_t))) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "DL_Heap error: capacity of %zu handles overflows.", capacity);
+        return -1;
+    }
+    // At least one handle, so `handles` is not NULL.
+    capacity = capacity > 0 ? capacity : 1;
+    h->handles = (size_t *) h->allocator.alloc(h->allocator.ctx, 2 * capacity * sizeof(size_t));
+    if (h->handles == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "Error allocating memory for DL_Heap handles: %s", strerror(errno));
+        return -1;
+    }
+    h->pos = h->handles + capacity;
+    return 0;
+}
+
+/**
+* `DL_heap_create` creates an empty heap with room for `capacity`
+* elements of `stride` bytes, ordered by `compare_to` (the smallest
+* element is on top). `flags` is 0 or a combination of DL_HEAP_4ARY
+* (4 children per node instead of 2) and DL_HEAP_HANDLES (track
+* handles, see `DL_heap_push`). In case of failure it returns `NULL`.
+*/
+DL_Heap *DL_heap_create(size_t capacity, size_t stride, int (*compare_to)(void *elem1, void *elem2), int flags) {
+    return DL_heap_create_with_allocator(capacity, stride, compare_to, flags, NULL);
+}
+
+/**
+* `DL_heap_create_with_allocator` works like `DL_heap_create`, but all
+* memory is obtained from `allocator` (malloc/realloc/free if `NULL`).
+*/
+DL_Heap *DL_heap_create_with_allocator(size_t capacity, size_t stride,
+                                       int (*compare_to)(void *elem1, void *elem2), int flags,
+                                       const CLIB_Allocator *allocator) {
+    DL_Heap *h = alloc_heap(stride, compare_to, flags, allocator, "DL_heap_create");
+    if (h == NULL) {
+        return NULL;
+    }
+    if ((flags & DL_HEAP_HANDLES) && alloc_index(h, capacity) != 0) {
+        DL_heap_free(h);
+        return NULL;
+    }
+    if (capacity > 0 && set_capacity(h, capacity, "DL_heap_create") != 0) {
+        DL_heap_free(h);
+        return NULL;
+    }
+
+    return h;
+}
+
+/**
+* `DL_heap_from_dynlist` turns the elements of `dl` into a heap in O(n):
+* the heap takes over the data of `dl`, which is left empty (without
+* capacity) but valid, and orders it in place. Heap lists only, and `dl`
+* needs a `compare_to` function. With DL_HEAP_HANDLES the element that
+* was at index i of `dl` gets the handle i.
+* Returns NULL on failure.
+*/
+DL_Heap *DL_heap_from_dynlist(DynList *dl, int flags) {
+    if (dl == NULL || dl->mapping != NULL || dl->concurrent != NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_heap_from_dynlist error: DynList is NULL, file backed or in concurrent mode.");
+        return NULL;
+    }
+
+    DL_Heap *h = alloc_heap(dl->stride, dl->compare_to, flags, &dl->allocator, "DL_heap_from_dynlist");
+    if (h == NULL) {
+        return NULL;
+    }
+    if (flags & DL_HEAP_HANDLES) {
+        if (alloc_index(h, dl->capacity) != 0) {
+            DL_heap_free(h);
+            return NULL;
+        }
+        for (size_t i = 0; i < dl->size; i++) {
+            set_handle(h, i, i);
+        }
+        h->nhandles = dl->size;
+    }
+    h->data     = dl->data;
+    h->capacity = dl->capacity;
+    h->size     = dl->size;
+
+    dl->data     = NULL;
+    dl->capacity = 0;
+    dl->size     = 0;
+    dl->sorted   = 0;
+
+    heapify(h);
+    return h;
+}
+
+/**
+* `DL_heap_free` frees the heap and its data.
+*/
+void DL_heap_free(DL_Heap *h) {
+    if (h == NULL) {
+        return;
+    }
+
+    CLIB_Allocator a = h->allocator;
+    if (h->data != NULL) {
+        a.free(a.ctx, h->data, h->capacity * h->stride);
+    }
+    if (h->handles != NULL) {
+        a.free(a.ctx, h->handles, 2 * index_capacity(h) * sizeof(size_t));
+    }
+    a.free(a.ctx, h, sizeof(DL_Heap) + h->stride);
+}
+
+/**
+* `DL_heap_push` adds a copy of `element` in O(log n). If `handle` is
+* not NULL (only for heaps created with DL_HEAP_HANDLES), it receives
+* the handle of the element, which stays valid until the element is
+* popped or removed. Only allocates if the heap is full, then doubles
+* its capacity.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_heap_push(DL_Heap *h, void *element, size_t *handle) {
+    if (h == NULL || element == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Heap or NULL element was given to DL_heap_push.");
+        return -1;
+    }
+    if (handle != NULL && h->handles == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_heap_push error: DL_Heap was created without DL_HEAP_HANDLES.");
+        return -1;
+    }
+    if (h->size == h->capacity) {
+        if (h->capacity > SIZE_MAX / 2) {
+            CLIB_FAIL(CLIB_EOVERFLOW, "DL_heap_push error: DL_Heap is too large to grow.");
+            return -1;
+        }
+        size_t capacity = h->capacity > 0 ? 2 * h->capacity : DEFAULT_CAPACITY;
+        if (set_capacity(h, capacity, "DL_heap_push") != 0) {
+            return -1;
+        }
+    }
+
+    size_t index = h->size++;
+    copy_elem(elem(h, index), element, h->stride);
+    if (h->handles != NULL) {
+        if (index == h->nhandles) {
+            set_handle(h, index, h->nhandles++);
+        }
+        if (handle != NULL) {
+            *handle = h->handles[index];
+        }
+    }
+    sift_up(h, index);
+
+    return 0;
+}
+
+/**
+* `DL_heap_peek` returns a pointer to the smallest element without
+* removing it, or NULL if the heap is empty.
+*/
+void *DL_heap_peek(DL_Heap *h) {
+    if (h == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Heap was given to DL_heap_peek.");
+        return NULL;
+    }
+    if (h->size == 0) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_heap_peek error: DL_Heap is empty.");
+        return NULL;
+    }
+    return h->data;
+}
+
+/**
+* `remove_at` removes the element at `index`: the last element takes
+* its place and is sifted to where it belongs. The handle of the removed
+* element becomes free.
+*/
+static void remove_at(DL_Heap *h, size_t index, void *out) {
+    if (out != NULL) {
+        copy_elem(out, elem(h, index), h->stride);
+    }
+
+    size_t last = --h->size;
+    if (h->handles != NULL) {
+        size_t handle = h->handles[index];
+        set_handle(h, index, h->handles[last]);
+        set_handle(h, last, handle);
+    }
+    if (index < last) {
+        copy_elem(elem(h, index), elem(h, last), h->stride);
+        sift(h, index);
+    }
+}
+
+/**
+* `DL_heap_pop` removes the smallest element in O(log n) and copies it
+* into `out`, unless `out` is NULL.
+* Returns 0 on success, -1 if the heap is empty.
+*/
+int DL_heap_pop(DL_Heap *h, void *out) {
+    if (h == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Heap was given to DL_heap_pop.");
+        return -1;
+    }
+    if (h->size == 0) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_heap_pop error: DL_Heap is empty.");
+        return -1;
+    }
+
+    remove_at(h, 0, out);
+    return 0;
+}
+
+/**
+* `handle_index` returns the index of the element with `handle`, or
+* SIZE_MAX (after setting the error) if `handle` is not in use.
+*/
+static size_t handle_index(DL_Heap *h, size_t handle, const char *caller) {
+    if (h == NULL || h->handles == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "%s error: DL_Heap is NULL or was created without DL_HEAP_HANDLES.", caller);
+        return SIZE_MAX;
+    }
+    if (handle >= h->nhandles || h->pos[handle] >= h->size) {
+        CLIB_FAIL(CLIB_ERANGE, "%s error: handle %zu is not in use.", caller, handle);
+        return SIZE_MAX;
+    }
+    return h->pos[handle];
+}
+
+/**
+* `DL_heap_get` returns a pointer to the element with `handle`. It must
+* not be modified other than through `DL_heap_update`.
+*/
+void *DL_heap_get(DL_Heap *h, size_t handle) {
+    size_t index = handle_index(h, handle, "DL_heap_get");
+    return index != SIZE_MAX ? elem(h, index) : NULL;
+}
+
+/**
+* `DL_heap_update` replaces the element with `handle` by a copy of
+* `element` and moves it up (decrease-key) or down (increase-key) in
+* O(log n). The handle stays the same.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_heap_update(DL_Heap *h, size_t handle, void *element) {
+    size_t index = handle_index(h, handle, "DL_heap_update");
+    if (index == SIZE_MAX) {
+        return -1;
+    }
+    if (element == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "NULL element was given to DL_heap_update.");
+        return -1;
+    }
+
+    copy_elem(elem(h, index), element, h->stride);
+    sift(h, index);
+    return 0;
+}
+
+/**
+* `DL_heap_remove` removes the element with `handle` in O(log n) and
+* copies it into `out`, unless `out` is NULL.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_heap_remove(DL_Heap *h, size_t handle, void *out) {
+    size_t index = handle_index(h, handle, "DL_heap_remove");
+    if (index == SIZE_MAX) {
+        return -1;
+    }
+
+    remove_at(h, index, out);
+    return 0;
+}
+
+/**
+* `DL_heap_size` returns the number of elements in `h`.
+*/
+long DL_heap_size(DL_Heap *h) {
+    if (h == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Heap was given to DL_heap_size.");
+        return -1;
+    }
+    return (long) h->size;
+}
+
+/**
+* `DL_heap_clear` removes all elements and frees all handles. The
+* capacity remains unchanged.
+*/
+void DL_heap_clear(DL_Heap *h) {
+    if (h == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_Heap was given to DL_heap_clear.");
+        return;
+    }
+    h->size = 0;
+}
+
+/**
+* `DL_heap_reserve` makes sure `h` can hold at least `capacity`
+* elements without reallocating. The capacity is never reduced.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_heap_reserve(DL_Heap *h, size_t capacity) {
+    if (h == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_heap_reserve error: provided DL_Heap is NULL.");
+        return -1;
+    }
+    if (capacity <= h->capacity) {
+        return 0;
+    }
+    return set_capacity(h, capacity, "DL_heap_reserve");
+}
@@ -0,0 +1,240 @@
+#define _GNU_SOURCE
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+* File backed DynLists. The file starts with a header of
+* `HEADER_SIZE` bytes, followed by the elements. The whole file is
+* mapped, `data` points right behind the header and the capacity is
+* whatever fits into the file. Numbers in the header use the byte
+* order of the machine.
+*/
+
+#define HEADER_SIZE 64
+#define MAGIC "CLIB_DL"
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t stride;
+    uint64_t size;
+} mmap_header;
+
+struct DL_Mapping {
+    int     fd;
+    int     writable;
+    char    *base;
+    // Mapped bytes, header included.
+    size_t  length;
+};
+
+static void write_header(DynList *dl) {
+    mmap_header h = {
+        .magic       = MAGIC,
+        .version     = DL_MMAP_VERSION,
+        .header_size = HEADER_SIZE,
+        .stride      = dl->stride,
+        .size        = dl->size,
+    };
+    memcpy(dl->mapping->base, &h, sizeof(h));
+}
+
+/**
+* `DL_open_mmap` opens the list stored in the file at `path` and maps
+* the file as its storage. `flags` is `DL_MMAP_RDONLY` or `DL_MMAP_RDWR`,
+* optionally or'ed with `DL_MMAP_CREATE` to create an empty list if the
+* file does not exist or is empty.
+* With `DL_MMAP_RDWR` the list grows the file as needed and all changes
+* reach the file; the size in the header is updated by `DL_sync` and
+* `DL_free`. With `DL_MMAP_RDONLY` the file is mapped copy-on-write:
+* processes share its pages, changes stay private and the list cannot
+* grow beyond the file.
+* `stride` must match the stored one, or be 0 to take it from the file.
+* The list has no `compare_to` function, set it if one is needed.
+* `DL_free` unmaps and closes the file.
+* Returns `NULL` on failure.
+*/
+DynList *DL_open_mmap(const char *path, size_t stride, int flags) {
+    if (path == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_open_mmap error: path is NULL.");
+        return NULL;
+    }
+
+    int writable = (flags & DL_MMAP_RDWR) != 0;
+    int oflags = writable ? O_RDWR : O_RDONLY;
+    if (writable && (flags & DL_MMAP_CREATE)) {
+        oflags |= O_CREAT;
+    }
+    int fd = open(path, oflags, 0644);
+    if (fd < 0) {
+        CLIB_FAIL(CLIB_EIO, "DL_open_mmap error: cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        CLIB_FAIL(CLIB_EIO, "DL_open_mmap error: cannot stat %s: %s", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    int fresh = st.st_size == 0;
+    if (fresh) {
+        if (!writable || !(flags & DL_MMAP_CREATE) || stride == 0) {
+            CLIB_FAIL(CLIB_EFORMAT, "DL_open_mmap error: %s is empty.", path);
+            close(fd);
+            return NULL;
+        }
+        if (ftruncate(fd, HEADER_SIZE) != 0) {
+            CLIB_FAIL(CLIB_EIO, "DL_open_mmap error: cannot resize %s: %s", path, strerror(errno));
+            close(fd);
+            return NULL;
+        }
+        st.st_size = HEADER_SIZE;
+    }
+
+    if (st.st_size < HEADER_SIZE) {
+        CLIB_FAIL(CLIB_EFORMAT, "DL_open_mmap error: %s is too short for a header.", path);
+        close(fd);
+        return NULL;
+    }
+
+    size_t length = (size_t) st.st_size;
+    char *base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                      writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        CLIB_FAIL(CLIB_EIO, "DL_open_mmap error: cannot map %s: %s", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    mmap_header h;
+    memcpy(&h, base, sizeof(h));
+    if (!fresh) {
+        if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != DL_MMAP_VERSION ||
+            h.header_size != HEADER_SIZE || h.stride == 0 || (stride != 0 && h.stride != stride) ||
+            h.size > (length - HEADER_SIZE) / h.stride) {
+            CLIB_FAIL(CLIB_EFORMAT, "DL_open_mmap error: %s has an invalid or incompatible header.", path);
+            munmap(base, length);
+            close(fd);
+            return NULL;
+        }
+        stride = h.stride;
+    }
+
+    CLIB_Allocator a = CLIB_DEFAULT_ALLOCATOR;
+    DynList *dl = (DynList *) a.alloc(a.ctx, sizeof(DynList));
+    DL_Mapping *m = (DL_Mapping *) a.alloc(a.ctx, sizeof(DL_Mapping));
+    if (dl == NULL || m == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_open_mmap error: out of memory.");
+        a.free(a.ctx, dl, sizeof(DynList));
+        a.free(a.ctx, m, sizeof(DL_Mapping));
+        munmap(base, length);
+        close(fd);
+        return NULL;
+    }
+
+    *m = (DL_Mapping) { .fd = fd, .writable = writable, .base = base, .length = length };
+    memset(dl, 0, sizeof(DynList));
+    dl->data      = base + HEADER_SIZE;
+    dl->stride    = stride;
+    dl->capacity  = (length - HEADER_SIZE) / stride;
+    dl->size      = fresh ? 0 : h.size;
+    dl->allocator = a;
+    dl->mapping   = m;
+
+    if (fresh) {
+        write_header(dl);
+    }
+
+    return dl;
+}
+
+/**
+* `dl_mmap_resize` changes the capacity of a file backed list by
+* resizing the file and remapping it.
+*/
+int dl_mmap_resize(DynList *dl, size_t capacity, const char *caller) {
+    DL_Mapping *m = dl->mapping;
+    if (!m->writable) {
+        CLIB_FAIL(CLIB_EINVAL, "%s error: read-only file backed DynList cannot grow.", caller);
+        return -1;
+    }
+
+    size_t length = HEADER_SIZE + capacity * dl->stride;
+    if (length < HEADER_SIZE) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "%s error: capacity of %zu elements overflows.", caller, capacity);
+        return -1;
+    }
+
+    // Grow the file before the mapping, shrink it after.
+    if (length > m->length && ftruncate(m->fd, length) != 0) {
+        CLIB_FAIL(CLIB_EIO, "%s error: cannot grow file of DynList: %s", caller, strerror(errno));
+        return -1;
+    }
+
+    char *base = mremap(m->base, m->length, length, MREMAP_MAYMOVE);
+    if (base == MAP_FAILED) {
+        CLIB_FAIL(CLIB_ENOMEM, "%s error: cannot remap file of DynList: %s", caller, strerror(errno));
+        return -1;
+    }
+
+    if (length < m->length && ftruncate(m->fd, length) != 0) {
+        CLIB_LOG(CLIB_LOG_WARN, "%s: cannot shrink file of DynList: %s", caller, strerror(errno));
+    }
+
+    m->base     = base;
+    m->length   = length;
+    dl->data     = base + HEADER_SIZE;
+    dl->capacity = capacity;
+
+    return 0;
+}
+
+/**
+* `dl_mmap_close` stores the size of a file backed list, then unmaps
+* and closes its file. The struct itself is left to `DL_free`.
+*/
+void dl_mmap_close(DynList *dl) {
+    DL_Mapping *m = dl->mapping;
+    if (m->writable) {
+        write_header(dl);
+    }
+    munmap(m->base, m->length);
+    close(m->fd);
+    dl->allocator.free(dl->allocator.ctx, m, sizeof(DL_Mapping));
+    dl->mapping = NULL;
+    dl->data    = NULL;
+}
+
+/**
+* `DL_sync` writes the size of a file backed `dl` to its header and
+* flushes all changes to the file. Does nothing for read-only lists.
+* Returns 0 on success, -1 otherwise (also if `dl` is not file backed).
+*/
+int DL_sync(DynList *dl) {
+    if (dl == NULL || dl->mapping == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_sync error: provided DynList is NULL or not file backed.");
+        return -1;
+    }
+
+    DL_Mapping *m = dl->mapping;
+    if (!m->writable) {
+        return 0;
+    }
+
+    write_header(dl);
+    if (msync(m->base, m->length, MS_SYNC) != 0) {
+        CLIB_FAIL(CLIB_EIO, "DL_sync error: msync failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
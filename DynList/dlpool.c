@@ -0,0 +1,122 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <pthread.h>
+#include <unistd.h>
+
+/*
+* Worker pool shared by the parallel functions of the library. Workers
+* are started on first use and then wait for batches of jobs. A batch
+* is run by the workers and the calling thread together, one batch at
+* a time. If the pool is busy (another thread, or a job that itself
+* runs a batch), the batch runs on the calling thread instead.
+*/
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t run_lock  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  done_cond = PTHREAD_COND_INITIALIZER;
+
+static int n_workers;
+
+// Current batch, guarded by `pool_lock`.
+static dl_job_fn batch_fn;
+static void *batch_arg;
+static int batch_jobs;
+static int batch_next;
+static int batch_done;
+static unsigned long batch_gen;
+
+/**
+* `claim_jobs` runs jobs of the current batch until none are left.
+* Called and returns with `pool_lock` held.
+*/
+static void claim_jobs(void) {
+    while (batch_next < batch_jobs) {
+        int id = batch_next++;
+        dl_job_fn fn = batch_fn;
+        void *arg = batch_arg;
+
+        pthread_mutex_unlock(&pool_lock);
+        fn(arg, id);
+        pthread_mutex_lock(&pool_lock);
+
+        if (++batch_done == batch_jobs) {
+            pthread_cond_broadcast(&done_cond);
+        }
+    }
+}
+
+static void *worker(void *unused) {
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (batch_gen == seen) {
+            pthread_cond_wait(&work_cond, &pool_lock);
+        }
+        seen = batch_gen;
+        claim_jobs();
+    }
+
+    return NULL;
+}
+
+/**
+* `dl_pool_threads` returns how many threads to use for `n` elements
+* if each thread should get at least `min_chunk` of them. `nthreads <= 0`
+* asks for one thread per online CPU.
+*/
+int dl_pool_threads(int nthreads, size_t n, size_t min_chunk) {
+    if (nthreads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (int) cpus : 1;
+    }
+    if (nthreads > DL_POOL_MAX_THREADS) {
+        nthreads = DL_POOL_MAX_THREADS;
+    }
+    if ((size_t) nthreads > n / min_chunk) {
+        nthreads = (int) (n / min_chunk);
+    }
+    return nthreads > 1 ? nthreads : 1;
+}
+
+/**
+* `dl_pool_run` calls `fn(arg, id)` for every `id` in `[0, njobs)` and
+* returns once all calls have returned. Up to `njobs - 1` workers are
+* started if the pool has fewer; jobs run on the calling thread if no
+* worker is available.
+*/
+void dl_pool_run(dl_job_fn fn, void *arg, int njobs) {
+    if (njobs <= 1 || pthread_mutex_trylock(&run_lock) != 0) {
+        for (int id = 0; id < njobs; id++) {
+            fn(arg, id);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    while (n_workers < njobs - 1 && n_workers < DL_POOL_MAX_THREADS - 1) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker, NULL) != 0) {
+            break;
+        }
+        pthread_detach(thread);
+        n_workers++;
+    }
+
+    batch_fn   = fn;
+    batch_arg  = arg;
+    batch_jobs = njobs;
+    batch_next = 0;
+    batch_done = 0;
+    batch_gen++;
+    pthread_cond_broadcast(&work_cond);
+
+    claim_jobs();
+    while (batch_done < batch_jobs) {
+        pthread_cond_wait(&done_cond, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    pthread_mutex_unlock(&run_lock);
+}
@@ -0,0 +1,175 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+* LSD radix sort engine for `DL_sort_by_key` and `DL_sort_by_offset`.
+* Elements are ordered by an unsigned key, one byte per pass from the
+* least significant one. Each pass scatters the elements stably into
+* the other of two buffers, so sorting needs a scratch buffer of n
+* elements and no comparisons.
+*/
+
+#define RADIX_BITS    8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_MAX_PASSES 8
+
+typedef struct {
+    DL_KeyFn key_fn;
+    size_t   offset;
+    int      key_type;
+} key_source;
+
+static inline uint64_t key_f32(const char *p) {
+    float f;
+    memcpy(&f, p, sizeof(f));
+    // Same order as `DL_cmp_float`: -0.0 equals 0.0, NaN sorts last.
+    if (f != f) {
+        return UINT32_MAX;
+    }
+    return DL_key_f32(f == 0.0f ? 0.0f : f);
+}
+
+static inline uint64_t key_f64(const char *p) {
+    double d;
+    memcpy(&d, p, sizeof(d));
+    if (d != d) {
+        return UINT64_MAX;
+    }
+    return DL_key_f64(d == 0.0 ? 0.0 : d);
+}
+
+static inline uint64_t key_of(const key_source *k, const char *elem) {
+    if (k->key_fn != NULL) {
+        return k->key_fn(elem);
+    }
+
+    const char *p = elem + k->offset;
+    uint32_t u32;
+    uint64_t u64;
+    switch (k->key_type) {
+        case DL_KEY_U32: memcpy(&u32, p, 4); return u32;
+        case DL_KEY_I32: memcpy(&u32, p, 4); return DL_key_i32((int32_t) u32);
+        case DL_KEY_F32: return key_f32(p);
+        case DL_KEY_U64: memcpy(&u64, p, 8); return u64;
+        case DL_KEY_I64: memcpy(&u64, p, 8); return DL_key_i64((int64_t) u64);
+        default:         return key_f64(p);
+    }
+}
+
+/**
+* `radix_sort` sorts `dl` by the keys of `k`, of which only the lower
+* `key_bytes` bytes are looked at. All byte histograms are built in one
+* pass up front; passes in which every key has the same byte are skipped.
+*/
+static int radix_sort(DynList *dl, const key_source *k, size_t key_bytes, const char *caller) {
+    size_t n = dl->size;
+    size_t stride = dl->stride;
+    if (n < 2) {
+        return 0;
+    }
+
+    if (n > SIZE_MAX / stride) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "%s error: scratch buffer size overflows.", caller);
+        return -1;
+    }
+    CLIB_Allocator *a = &dl->allocator;
+    char *scratch = (char *) a->alloc(a->ctx, n * stride);
+    if (scratch == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "%s error: failed to allocate scratch buffer: %s", caller, strerror(errno));
+        return -1;
+    }
+
+    size_t counts[RADIX_MAX_PASSES][RADIX_BUCKETS];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t key = key_of(k, dl->data + i * stride);
+        for (size_t pass = 0; pass < key_bytes; pass++) {
+            counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    char *src = dl->data, *dst = scratch;
+    for (size_t pass = 0; pass < key_bytes; pass++) {
+        size_t *count = counts[pass];
+        size_t shift = pass * RADIX_BITS;
+
+        // Skip the pass if all keys land in one bucket.
+        uint64_t first = (key_of(k, src) >> shift) & (RADIX_BUCKETS - 1);
+        if (count[first] == n) {
+            continue;
+        }
+
+        size_t pos[RADIX_BUCKETS];
+        size_t sum = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            pos[b] = sum;
+            sum += count[b];
+        }
+        for (size_t i = 0; i < n; i++) {
+            char *elem = src + i * stride;
+            size_t b = (key_of(k, elem) >> shift) & (RADIX_BUCKETS - 1);
+            copy_elem(dst + pos[b]++ * stride, elem, stride);
+        }
+
+        char *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != dl->data) {
+        memcpy(dl->data, src, n * stride);
+    }
+    a->free(a->ctx, scratch, n * stride);
+
+    // The key order need not match `compare_to`.
+    dl->sorted = 0;
+
+    return 0;
+}
+
+/**
+* `DL_sort_by_key` sorts `dl` stably by the unsigned keys `key_fn`
+* returns for its elements, without calling `compare_to`. Only the
+* lower `key_bytes` (1 to 8) bytes of the keys are used, one radix
+* pass per byte. Signed and floating point values can be turned into
+* keys with `DL_key_i32`, `DL_key_f64`, ...
+* The list is not put into sorted mode.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_sort_by_key(DynList *dl, DL_KeyFn key_fn, size_t key_bytes) {
+    if (dl == NULL || key_fn == NULL || key_bytes == 0 || key_bytes > RADIX_MAX_PASSES) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_sort_by_key error: DynList or key function is NULL, or key_bytes is not within 1 to 8.");
+        return -1;
+    }
+
+    key_source k = { .key_fn = key_fn };
+    return radix_sort(dl, &k, key_bytes, "DL_sort_by_key");
+}
+
+/**
+* `DL_sort_by_offset` sorts `dl` stably by a key stored `offset` bytes
+* into each element, with a `key_type` of `DL_KEY_U32`, `DL_KEY_I32`,
+* `DL_KEY_F32`, `DL_KEY_U64`, `DL_KEY_I64` or `DL_KEY_F64`. Floats are
+* ordered like `DL_cmp_float`/`DL_cmp_double` do: -0.0 equals 0.0 and
+* NaNs go last.
+* The list is not put into sorted mode.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_sort_by_offset(DynList *dl, size_t offset, int key_type) {
+    if (dl == NULL || key_type < DL_KEY_U32 || key_type > DL_KEY_F64) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_sort_by_offset error: provided DynList is NULL or key_type is unknown.");
+        return -1;
+    }
+
+    size_t key_bytes = key_type <= DL_KEY_F32 ? 4 : 8;
+    if (offset > dl->stride || dl->stride - offset < key_bytes) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_sort_by_offset error: key at offset %zu does not fit into stride %zu.", offset, dl->stride);
+        return -1;
+    }
+
+    key_source k = { .offset = offset, .key_type = key_type };
+    return radix_sort(dl, &k, key_bytes, "DL_sort_by_offset");
+}
@@ -0,0 +1,404 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+* List in geometric chunks (see dynlist_internal.h). Growing allocates
+* one more chunk, which doubles the capacity, instead of reallocating:
+* elements are never copied or moved, so pointers to them stay valid
+* until they are removed, and the memory in use is at most twice the
+* size of the elements (plus the smallest chunk).
+*/
+
+// Smallest number of elements of chunk 0.
+#define MIN_BASE 64
+
+/**
+* `base_shift_for` returns the base shift of a list whose first chunk
+* holds at least `capacity` elements, or 64 if there is none.
+*/
+static unsigned int base_shift_for(size_t capacity) {
+    unsigned int base_shift = 0;
+    while (base_shift < 63 && (((size_t) 1 << base_shift) < MIN_BASE || ((size_t) 1 << base_shift) < capacity)) {
+        base_shift++;
+    }
+    return ((size_t) 1 << base_shift) >= capacity ? base_shift : 64;
+}
+
+/**
+* `chunk_bytes` returns the size of chunk `k` in bytes, or 0 if the
+* chunk can not exist.
+*/
+static size_t chunk_bytes(DL_SegList *sl, unsigned int k) {
+    if (k >= DL_SEGLIST_MAX_CHUNKS || sl->base_shift + k > 62) {
+        return 0;
+    }
+    size_t n = dl_chunk_end(sl->base_shift, k) - dl_chunk_start(sl->base_shift, k);
+    return n <= SIZE_MAX / sl->stride ? n * sl->stride : 0;
+}
+
+/**
+* `add_chunk` allocates the next chunk.
+* Returns 0 on success, -1 otherwise.
+*/
+static int add_chunk(DL_SegList *sl, const char *caller) {
+    unsigned int k = sl->nchunks;
+    size_t bytes = chunk_bytes(sl, k);
+    if (bytes == 0) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "%s error: DL_SegList exceeds the addressable size.", caller);
+        return -1;
+    }
+
+    char *chunk = (char *) sl->allocator.alloc(sl->allocator.ctx, bytes);
+    if (chunk == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "%s error: failed to allocate a chunk of %zu bytes: %s", caller, bytes, strerror(errno));
+        return -1;
+    }
+    sl->chunks[k] = chunk;
+    sl->nchunks   = k + 1;
+    sl->capacity  = dl_chunk_end(sl->base_shift, k);
+
+    return 0;
+}
+
+/**
+* `grow` allocates chunks until `sl` holds at least `capacity` elements.
+* A list without chunks gets a first chunk large enough on its own.
+* Returns 0 on success, -1 otherwise.
+*/
+static int grow(DL_SegList *sl, size_t capacity, const char *caller) {
+    if (sl->nchunks == 0) {
+        unsigned int base_shift = base_shift_for(capacity);
+        if (base_shift >= 63) {
+            CLIB_FAIL(CLIB_EOVERFLOW, "%s error: capacity of %zu elements overflows.", caller, capacity);
+            return -1;
+        }
+        sl->base_shift = base_shift;
+    }
+    while (sl->capacity < capacity) {
+        if (add_chunk(sl, caller) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+* `DL_seglist_create` creates an empty list of elements of `stride`
+* bytes, with room for `capacity` elements in its first chunk (at least
+* 64, rounded up to a power of two). In case of failure it returns
+* `NULL`.
+*/
+DL_SegList *DL_seglist_create(size_t capacity, size_t stride, int (*compare_to)(void *elem1, void *elem2)) {
+    return DL_seglist_create_with_allocator(capacity, stride, compare_to, NULL);
+}
+
+/**
+* `DL_seglist_create_with_allocator` works like `DL_seglist_create`, but
+* all memory is obtained from `allocator` (malloc/realloc/free if `NULL`).
+*/
+DL_SegList *DL_seglist_create_with_allocator(size_t capacity, size_t stride,
+                                             int (*compare_to)(void *elem1, void *elem2),
+                                             const CLIB_Allocator *allocator) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    if (stride == 0) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_seglist_create error: invalid stride.");
+        return NULL;
+    }
+
+    DL_SegList *sl = (DL_SegList *) a.alloc(a.ctx, sizeof(DL_SegList));
+    if (sl == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "Error allocating memory for DL_SegList struct: %s", strerror(errno));
+        return NULL;
+    }
+
+    memset(sl, 0, sizeof(DL_SegList));
+    sl->base_shift = base_shift_for(0);
+    sl->stride     = stride;
+    sl->compare_to = compare_to;
+    sl->allocator  = a;
+
+    if (capacity > 0 && grow(sl, capacity, "DL_seglist_create") != 0) {
+        a.free(a.ctx, sl, sizeof(DL_SegList));
+        return NULL;
+    }
+
+    return sl;
+}
+
+/**
+* `DL_seglist_from_dynlist` turns the elements of `dl` into a DL_SegList:
+* the data of `dl` becomes its first chunk, after growing it to a power
+* of two if needed (which may copy it once). `dl` is left empty (without
+* capacity) but valid. Heap lists only.
+* Returns NULL on failure.
+*/
+DL_SegList *DL_seglist_from_dynlist(DynList *dl) {
+    if (dl == NULL || dl->mapping != NULL || dl->concurrent != NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_seglist_from_dynlist error: DynList is NULL, file backed or in concurrent mode.");
+        return NULL;
+    }
+
+    unsigned int base_shift = base_shift_for(dl->capacity);
+    if (base_shift >= 63) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "DL_seglist_from_dynlist error: DynList is too large.");
+        return NULL;
+    }
+    if (DL_reserve(dl, (size_t) 1 << base_shift) != 0) {
+        return NULL;
+    }
+
+    DL_SegList *sl = DL_seglist_create_with_allocator(0, dl->stride, dl->compare_to, &dl->allocator);
+    if (sl == NULL) {
+        return NULL;
+    }
+    sl->base_shift = base_shift;
+    sl->chunks[0]  = dl->data;
+    sl->nchunks    = 1;
+    sl->capacity   = dl->capacity;
+    sl->size       = dl->size;
+
+    dl->data     = NULL;
+    dl->capacity = 0;
+    dl->size     = 0;
+
+    return sl;
+}
+
+/**
+* `DL_seglist_to_dynlist` returns a new DynList (capacity = size) with
+* the elements of `sl`.
+* Returns NULL on failure.
+*/
+DynList *DL_seglist_to_dynlist(DL_SegList *sl) {
+    if (sl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_seglist_to_dynlist error: provided DL_SegList is NULL.");
+        return NULL;
+    }
+
+    DynList *dl = DL_create_with_allocator(sl->size, sl->stride, sl->compare_to, &sl->allocator);
+    if (dl == NULL) {
+        return NULL;
+    }
+
+    size_t count;
+    char *chunk;
+    for (unsigned int k = 0; (chunk = DL_seglist_chunk(sl, k, &count)) != NULL; k++) {
+        memcpy(dl->data + dl_chunk_start(sl->base_shift, k) * sl->stride, chunk, count * sl->stride);
+    }
+    dl->size = sl->size;
+
+    return dl;
+}
+
+/**
+* `DL_seglist_free` frees the list and all its chunks.
+*/
+void DL_seglist_free(DL_SegList *sl) {
+    if (sl == NULL) {
+        return;
+    }
+
+    CLIB_Allocator a = sl->allocator;
+    for (unsigned int k = 0; k < sl->nchunks; k++) {
+        a.free(a.ctx, sl->chunks[k], chunk_bytes(sl, k));
+    }
+    a.free(a.ctx, sl, sizeof(DL_SegList));
+}
+
+/**
+* `DL_seglist_append` appends a copy of `element`. Only allocates if the
+* list is full, then adds a chunk as large as the whole list; nothing
+* is copied or moved.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_seglist_append(DL_SegList *sl, void *element) {
+    if (sl == NULL || element == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_SegList or NULL element was given to DL_seglist_append.");
+        return -1;
+    }
+    if (sl->size == sl->capacity && grow(sl, sl->size + 1, "DL_seglist_append") != 0) {
+        return -1;
+    }
+
+    unsigned int k = dl_chunk_of(sl->base_shift, sl->size);
+    size_t offset  = sl->size - dl_chunk_start(sl->base_shift, k);
+    copy_elem(sl->chunks[k] + offset * sl->stride, element, sl->stride);
+    sl->size++;
+
+    return 0;
+}
+
+/**
+* `DL_seglist_append_n` appends `count` contiguous elements. Either all
+* or none of them are appended.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_seglist_append_n(DL_SegList *sl, void *elements, size_t count) {
+    if (sl == NULL || (elements == NULL && count > 0)) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_SegList or NULL elements were given to DL_seglist_append_n.");
+        return -1;
+    }
+    if (count > SIZE_MAX - sl->size) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "DL_seglist_append_n error: size overflows.");
+        return -1;
+    }
+    if (grow(sl, sl->size + count, "DL_seglist_append_n") != 0) {
+        return -1;
+    }
+
+    const char *src = (const char *) elements;
+    size_t end = sl->size + count;
+    while (sl->size < end) {
+        unsigned int k = dl_chunk_of(sl->base_shift, sl->size);
+        size_t start   = dl_chunk_start(sl->base_shift, k);
+        size_t n       = (end < dl_chunk_end(sl->base_shift, k) ? end : dl_chunk_end(sl->base_shift, k)) - sl->size;
+        memcpy(sl->chunks[k] + (sl->size - start) * sl->stride, src, n * sl->stride);
+        src      += n * sl->stride;
+        sl->size += n;
+    }
+
+    return 0;
+}
+
+/**
+* `DL_seglist_get` returns a pointer to the element at `index` in O(1).
+* The pointer stays valid until the element is removed (by
+* `DL_seglist_pop_back`, `DL_seglist_clear` or `DL_seglist_free`), no
+* matter how much the list grows.
+*/
+void *DL_seglist_get(DL_SegList *sl, size_t index) {
+    if (sl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_SegList was given to DL_seglist_get.");
+        return NULL;
+    }
+    if (index >= sl->size) {
+        CLIB_FAIL(CLIB_ERANGE, "Index out of bounds for DL_seglist_get: index=%zu, size=%zu", index, sl->size);
+        return NULL;
+    }
+
+    unsigned int k = dl_chunk_of(sl->base_shift, index);
+    return sl->chunks[k] + (index - dl_chunk_start(sl->base_shift, k)) * sl->stride;
+}
+
+/**
+* `DL_seglist_set` overwrites the element at `index` with a copy of
+* `element`.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_seglist_set(DL_SegList *sl, size_t index, void *element) {
+    if (element == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "NULL element was given to DL_seglist_set.");
+        return -1;
+    }
+    void *slot = DL_seglist_get(sl, index);
+    if (slot == NULL) {
+        return -1;
+    }
+    copy_elem(slot, element, sl->stride);
+    return 0;
+}
+
+/**
+* `DL_seglist_pop_back` removes the last element and copies it into
+* `out`, unless `out` is NULL. Chunks are kept for later appends, see
+* `DL_seglist_shrink_to_fit`.
+* Returns 0 on success, -1 if the list is empty.
+*/
+int DL_seglist_pop_back(DL_SegList *sl, void *out) {
+    if (sl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_SegList was given to DL_seglist_pop_back.");
+        return -1;
+    }
+    if (sl->size == 0) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_seglist_pop_back error: DL_SegList is empty.");
+        return -1;
+    }
+
+    if (out != NULL) {
+        copy_elem(out, DL_seglist_get(sl, sl->size - 1), sl->stride);
+    }
+    sl->size--;
+
+    return 0;
+}
+
+/**
+* `DL_seglist_chunk` returns the elements in chunk `k` as one array and
+* stores their number in `count`. Returns NULL (without an error) once
+* `k` is past the last chunk with elements, so all elements can be
+* scanned chunk by chunk:
+*
+*     for (unsigned int k = 0; (p = DL_seglist_chunk(sl, k, &n)) != NULL; k++)
+*/
+void *DL_seglist_chunk(DL_SegList *sl, unsigned int k, size_t *count) {
+    if (sl == NULL || count == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_seglist_chunk error: DL_SegList or count is NULL.");
+        return NULL;
+    }
+
+    *count = 0;
+    if (k >= sl->nchunks || dl_chunk_start(sl->base_shift, k) >= sl->size) {
+        return NULL;
+    }
+    size_t end = dl_chunk_end(sl->base_shift, k);
+    *count = (sl->size < end ? sl->size : end) - dl_chunk_start(sl->base_shift, k);
+    return sl->chunks[k];
+}
+
+/**
+* `DL_seglist_size` returns the number of elements in `sl`.
+*/
+long DL_seglist_size(DL_SegList *sl) {
+    if (sl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_SegList was given to DL_seglist_size.");
+        return -1;
+    }
+    return (long) sl->size;
+}
+
+/**
+* `DL_seglist_clear` removes all elements. The chunks are kept.
+*/
+void DL_seglist_clear(DL_SegList *sl) {
+    if (sl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DL_SegList was given to DL_seglist_clear.");
+        return;
+    }
+    sl->size = 0;
+}
+
+/**
+* `DL_seglist_reserve` makes sure `sl` can hold at least `capacity`
+* elements without allocating.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_seglist_reserve(DL_SegList *sl, size_t capacity) {
+    if (sl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_seglist_reserve error: provided DL_SegList is NULL.");
+        return -1;
+    }
+    return grow(sl, capacity, "DL_seglist_reserve");
+}
+
+/**
+* `DL_seglist_shrink_to_fit` frees the chunks behind the last element.
+* The first chunk is always kept. Elements do not move.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_seglist_shrink_to_fit(DL_SegList *sl) {
+    if (sl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_seglist_shrink_to_fit error: provided DL_SegList is NULL.");
+        return -1;
+    }
+
+    while (sl->nchunks > 1 && dl_chunk_start(sl->base_shift, sl->nchunks - 1) >= sl->size) {
+        unsigned int k = --sl->nchunks;
+        sl->allocator.free(sl->allocator.ctx, sl->chunks[k], chunk_bytes(sl, k));
+        sl->chunks[k] = NULL;
+        sl->capacity  = dl_chunk_start(sl->base_shift, k);
+    }
+    return 0;
+}
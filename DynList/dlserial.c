@@ -0,0 +1,118 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include "clib_serial.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAGIC "CLIB_DLS"
+
+/**
+* `DL_serialize` writes `dl` to `out`: a header with stride, count and a
+* checksum of the elements, followed by the elements as stored in
+* `data` in a single write. To serialize into memory, use
+* `open_memstream` or `fmemopen` for `out`.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_serialize(DynList *dl, FILE *out) {
+    if (dl == NULL || out == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_serialize error: provided DynList or FILE is NULL.");
+        return -1;
+    }
+
+    CLIB_Checksum c;
+    clib_checksum_init(&c);
+    clib_checksum_update(&c, dl->data, dl->size * dl->stride);
+
+    CLIB_SerialHeader h = {
+        .magic    = MAGIC,
+        .version  = CLIB_SERIAL_VERSION,
+        .stride   = dl->stride,
+        .count    = dl->size,
+        .checksum = clib_checksum_final(&c),
+    };
+    if (fwrite(&h, sizeof(h), 1, out) != 1 ||
+        fwrite(dl->data, dl->stride, dl->size, out) != dl->size) {
+        CLIB_FAIL(CLIB_EIO, "DL_serialize error: write failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+* `DL_deserialize` reads a list written by `DL_serialize` from `in`
+* into a new list with capacity for exactly its elements, which are
+* read in a single read. The count in the header is checked against the
+* size of `in` first; if `in` is not seekable, the elements are read in
+* chunks instead and the list grows as they arrive. The checksum is
+* verified.
+* Returns `NULL` on failure, with the last error `CLIB_EFORMAT` for
+* malformed, truncated or corrupted input.
+*/
+DynList *DL_deserialize(FILE *in, int (*compare_to)(void *elem1, void *elem2)) {
+    if (in == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_deserialize error: provided FILE is NULL.");
+        return NULL;
+    }
+
+    CLIB_SerialHeader h;
+    int err = clib_serial_read_header(in, MAGIC, &h);
+    if (err != CLIB_OK) {
+        CLIB_FAIL(err, "DL_deserialize error: missing or invalid header.");
+        return NULL;
+    }
+    if (h.count > SIZE_MAX / h.stride) {
+        CLIB_FAIL(CLIB_EFORMAT, "DL_deserialize error: %llu elements of %llu bytes overflow.",
+                  (unsigned long long) h.count, (unsigned long long) h.stride);
+        return NULL;
+    }
+
+    int seekable;
+    err = clib_serial_check_size(in, &h, &seekable);
+    if (err != CLIB_OK) {
+        CLIB_FAIL(err, "DL_deserialize error: input is truncated.");
+        return NULL;
+    }
+
+    // Without the size of the input, only CLIB_SERIAL_CHUNK bytes are
+    // allocated ahead of the elements read so far.
+    size_t count = h.count;
+    size_t capacity = count;
+    if (!seekable && capacity > CLIB_SERIAL_CHUNK / h.stride) {
+        capacity = CLIB_SERIAL_CHUNK / h.stride + 1;
+    }
+    DynList *dl = DL_create(capacity, h.stride, compare_to);
+    if (dl == NULL) {
+        return NULL;
+    }
+
+    while (dl->size < count) {
+        if (dl->size == dl->capacity) {
+            size_t grown = dl->capacity <= count / 2 ? 2 * dl->capacity : count;
+            if (DL_reserve(dl, grown) != 0) {
+                DL_free(dl);
+                return NULL;
+            }
+        }
+        size_t want = (dl->capacity < count ? dl->capacity : count) - dl->size;
+        size_t got = fread(dl->data + dl->size * dl->stride, dl->stride, want, in);
+        dl->size += got;
+        if (got != want) {
+            CLIB_FAIL(ferror(in) ? CLIB_EIO : CLIB_EFORMAT, "DL_deserialize error: input is truncated.");
+            DL_free(dl);
+            return NULL;
+        }
+    }
+
+    CLIB_Checksum c;
+    clib_checksum_init(&c);
+    clib_checksum_update(&c, dl->data, dl->size * dl->stride);
+    if (clib_checksum_final(&c) != h.checksum) {
+        CLIB_FAIL(CLIB_EFORMAT, "DL_deserialize error: checksum mismatch.");
+        DL_free(dl);
+        return NULL;
+    }
+
+    return dl;
+}
@@ -0,0 +1,348 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define DL_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/**
+* Built-in comparators. Passing one of these to `DL_create` lets
+* `DL_count`, `DL_contains`, `DL_index` and `DL_remove` compare
+* several elements per instruction instead of calling `compare_to`
+* once per element.
+*
+* The floating point comparators order NaN after all other values and
+* consider two NaNs equal, so they form a total order that sorting can
+* rely on. -0.0 and 0.0 are equal.
+*/
+int DL_cmp_int32(void *elem1, void *elem2) {
+    int32_t a = *(int32_t *) elem1;
+    int32_t b = *(int32_t *) elem2;
+    return (a > b) - (a < b);
+}
+
+int DL_cmp_int64(void *elem1, void *elem2) {
+    int64_t a = *(int64_t *) elem1;
+    int64_t b = *(int64_t *) elem2;
+    return (a > b) - (a < b);
+}
+
+int DL_cmp_float(void *elem1, void *elem2) {
+    float a = *(float *) elem1;
+    float b = *(float *) elem2;
+    if (a < b) {
+        return -1;
+    }
+    if (a > b) {
+        return 1;
+    }
+    // Equal, or at least one of them is NaN.
+    return (a != a) - (b != b);
+}
+
+int DL_cmp_double(void *elem1, void *elem2) {
+    double a = *(double *) elem1;
+    double b = *(double *) elem2;
+    if (a < b) {
+        return -1;
+    }
+    if (a > b) {
+        return 1;
+    }
+    return (a != a) - (b != b);
+}
+
+typedef enum {
+    KEY_NONE,
+    KEY_INT32,
+    KEY_INT64,
+    KEY_FLOAT,
+    KEY_DOUBLE,
+} key_kind;
+
+static key_kind kind_of(DynList *dl) {
+    if (dl->compare_to == DL_cmp_int32 && dl->stride == 4) {
+        return KEY_INT32;
+    }
+    if (dl->compare_to == DL_cmp_int64 && dl->stride == 8) {
+        return KEY_INT64;
+    }
+    if (dl->compare_to == DL_cmp_float && dl->stride == 4) {
+        return KEY_FLOAT;
+    }
+    if (dl->compare_to == DL_cmp_double && dl->stride == 8) {
+        return KEY_DOUBLE;
+    }
+    return KEY_NONE;
+}
+
+/**
+* `dl_simd_supported` returns 1 if `dl` uses one of the built-in
+* comparators with a matching stride, 0 otherwise.
+*/
+int dl_simd_supported(DynList *dl) {
+    return kind_of(dl) != KEY_NONE;
+}
+
+#ifdef DL_X86_SIMD
+
+/*
+* Every `mask_*` function compares one vector worth of elements against
+* the broadcast key and returns a bitmask with one bit per element.
+* The `*_nan` variants are used when the key itself is NaN and match
+* all NaN elements instead.
+*/
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline unsigned mask_i32_avx2(const void *p, __m256i k) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) p);
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, k)));
+}
+
+AVX2 static inline unsigned mask_i64_avx2(const void *p, __m256i k) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) p);
+    return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(x, k)));
+}
+
+AVX2 static inline unsigned mask_f32_avx2(const void *p, __m256 k) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p), k, _CMP_EQ_OQ));
+}
+
+AVX2 static inline unsigned mask_f32_nan_avx2(const void *p, __m256 k) {
+    __m256 x = _mm256_loadu_ps(p);
+    return _mm256_movemask_ps(_mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+}
+
+AVX2 static inline unsigned mask_f64_avx2(const void *p, __m256d k) {
+    return _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), k, _CMP_EQ_OQ));
+}
+
+AVX2 static inline unsigned mask_f64_nan_avx2(const void *p, __m256d k) {
+    __m256d x = _mm256_loadu_pd(p);
+    return _mm256_movemask_pd(_mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+static inline unsigned mask_i32_sse2(const void *p, __m128i k) {
+    __m128i x = _mm_loadu_si128((const __m128i *) p);
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, k)));
+}
+
+static inline unsigned mask_i64_sse2(const void *p, __m128i k) {
+    // SSE2 has no 64 bit compare: both 32 bit halves need to match.
+    __m128i e = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) p), k);
+    e = _mm_and_si128(e, _mm_shuffle_epi32(e, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_movemask_pd(_mm_castsi128_pd(e));
+}
+
+static inline unsigned mask_f32_sse2(const void *p, __m128 k) {
+    return _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(p), k));
+}
+
+static inline unsigned mask_f32_nan_sse2(const void *p, __m128 k) {
+    __m128 x = _mm_loadu_ps(p);
+    return _mm_movemask_ps(_mm_cmpunord_ps(x, x));
+}
+
+static inline unsigned mask_f64_sse2(const void *p, __m128d k) {
+    return _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(p), k));
+}
+
+static inline unsigned mask_f64_nan_sse2(const void *p, __m128d k) {
+    __m128d x = _mm_loadu_pd(p);
+    return _mm_movemask_pd(_mm_cmpunord_pd(x, x));
+}
+
+/*
+* `DEFINE_SCAN` generates a count and an index kernel from a mask
+* function. Both only look at whole vectors, i.e. the first
+* `n - n % lanes` elements, the tail is left to the caller. The count
+* kernel processes two vectors per iteration.
+* `index_*` returns the index of the first match or `n` if there is none.
+*/
+#define DEFINE_SCAN(name, attr, key_t, elem_size, lanes)                        \
+attr static size_t count_##name(const char *v, size_t n, key_t k) {             \
+    size_t c = 0;                                                               \
+    size_t i = 0;                                                               \
+    for (; i + 2 * (lanes) <= n; i += 2 * (lanes)) {                            \
+        c += __builtin_popcount(mask_##name(v + i * (elem_size), k));           \
+        c += __builtin_popcount(mask_##name(v + (i + (lanes)) * (elem_size), k)); \
+    }                                                                           \
+    for (; i + (lanes) <= n; i += (lanes)) {                                    \
+        c += __builtin_popcount(mask_##name(v + i * (elem_size), k));           \
+    }                                                                           \
+    return c;                                                                   \
+}                                                                               \
+attr static size_t index_##name(const char *v, size_t n, key_t k) {             \
+    for (size_t i = 0; i + (lanes) <= n; i += (lanes)) {                        \
+        unsigned m = mask_##name(v + i * (elem_size), k);                       \
+        if (m != 0) {                                                           \
+            return i + __builtin_ctz(m);                                        \
+        }                                                                       \
+    }                                                                           \
+    return n;                                                                   \
+}
+
+DEFINE_SCAN(i32_avx2,     AVX2, __m256i, 4, 8)
+DEFINE_SCAN(i64_avx2,     AVX2, __m256i, 8, 4)
+DEFINE_SCAN(f32_avx2,     AVX2, __m256,  4, 8)
+DEFINE_SCAN(f32_nan_avx2, AVX2, __m256,  4, 8)
+DEFINE_SCAN(f64_avx2,     AVX2, __m256d, 8, 4)
+DEFINE_SCAN(f64_nan_avx2, AVX2, __m256d, 8, 4)
+DEFINE_SCAN(i32_sse2,         , __m128i, 4, 4)
+DEFINE_SCAN(i64_sse2,         , __m128i, 8, 2)
+DEFINE_SCAN(f32_sse2,         , __m128,  4, 4)
+DEFINE_SCAN(f32_nan_sse2,     , __m128,  4, 4)
+DEFINE_SCAN(f64_sse2,         , __m128d, 8, 2)
+DEFINE_SCAN(f64_nan_sse2,     , __m128d, 8, 2)
+
+// Set by `dl_simd_use_avx2` to run the SSE2 kernels on AVX2 machines.
+static int avx2_disabled = 0;
+
+static int has_avx2(void) {
+    return !avx2_disabled && __builtin_cpu_supports("avx2");
+}
+
+// The broadcasts need to be compiled for AVX2 as well.
+AVX2 static size_t scan_avx2(key_kind kind, int count, const char *v, size_t n, void *elem) {
+    switch (kind) {
+        case KEY_INT32: {
+            __m256i k = _mm256_set1_epi32(*(int32_t *) elem);
+            return count ? count_i32_avx2(v, n, k) : index_i32_avx2(v, n, k);
+        }
+        case KEY_INT64: {
+            __m256i k = _mm256_set1_epi64x(*(int64_t *) elem);
+            return count ? count_i64_avx2(v, n, k) : index_i64_avx2(v, n, k);
+        }
+        case KEY_FLOAT: {
+            float f = *(float *) elem;
+            __m256 k = _mm256_set1_ps(f);
+            if (f != f) {
+                return count ? count_f32_nan_avx2(v, n, k) : index_f32_nan_avx2(v, n, k);
+            }
+            return count ? count_f32_avx2(v, n, k) : index_f32_avx2(v, n, k);
+        }
+        case KEY_DOUBLE: {
+            double d = *(double *) elem;
+            __m256d k = _mm256_set1_pd(d);
+            if (d != d) {
+                return count ? count_f64_nan_avx2(v, n, k) : index_f64_nan_avx2(v, n, k);
+            }
+            return count ? count_f64_avx2(v, n, k) : index_f64_avx2(v, n, k);
+        }
+        default:
+            return count ? 0 : n;
+    }
+}
+
+static size_t scan_sse2(key_kind kind, int count, const char *v, size_t n, void *elem) {
+    switch (kind) {
+        case KEY_INT32: {
+            __m128i k = _mm_set1_epi32(*(int32_t *) elem);
+            return count ? count_i32_sse2(v, n, k) : index_i32_sse2(v, n, k);
+        }
+        case KEY_INT64: {
+            __m128i k = _mm_set1_epi64x(*(int64_t *) elem);
+            return count ? count_i64_sse2(v, n, k) : index_i64_sse2(v, n, k);
+        }
+        case KEY_FLOAT: {
+            float f = *(float *) elem;
+            __m128 k = _mm_set1_ps(f);
+            if (f != f) {
+                return count ? count_f32_nan_sse2(v, n, k) : index_f32_nan_sse2(v, n, k);
+            }
+            return count ? count_f32_sse2(v, n, k) : index_f32_sse2(v, n, k);
+        }
+        case KEY_DOUBLE: {
+            double d = *(double *) elem;
+            __m128d k = _mm_set1_pd(d);
+            if (d != d) {
+                return count ? count_f64_nan_sse2(v, n, k) : index_f64_nan_sse2(v, n, k);
+            }
+            return count ? count_f64_sse2(v, n, k) : index_f64_sse2(v, n, k);
+        }
+        default:
+            return count ? 0 : n;
+    }
+}
+
+#endif // DL_X86_SIMD
+
+/**
+* `vector_prefix` returns how many leading elements the vector kernels
+* cover for `n` elements of `dl`. The remaining tail is compared with
+* the built-in comparator itself.
+*/
+static size_t vector_prefix(DynList *dl, size_t n) {
+#ifdef DL_X86_SIMD
+    size_t lanes = (has_avx2() ? 32 : 16) / dl->stride;
+    return n - n % lanes;
+#else
+    return 0;
+#endif
+}
+
+static size_t scan(key_kind kind, int count, const char *v, size_t n, void *elem) {
+#ifdef DL_X86_SIMD
+    if (has_avx2()) {
+        return scan_avx2(kind, count, v, n, elem);
+    }
+    return scan_sse2(kind, count, v, n, elem);
+#else
+    return count ? 0 : n;
+#endif
+}
+
+/**
+* `dl_simd_use_avx2` enables (the default) or disables the AVX2 kernels,
+* so tests can cover both kernel sets on one machine. Not thread-safe.
+* Returns 1 if the AVX2 kernels are used from now on, 0 otherwise.
+*/
+int dl_simd_use_avx2(int enable) {
+#ifdef DL_X86_SIMD
+    avx2_disabled = !enable;
+    return has_avx2();
+#else
+    return 0;
+#endif
+}
+
+/**
+* `dl_simd_count` returns the number of elements of `dl` equal to
+* `elem`. `dl_simd_supported(dl)` must hold.
+*/
+size_t dl_simd_count(DynList *dl, void *elem) {
+    key_kind kind = kind_of(dl);
+    size_t head = vector_prefix(dl, dl->size);
+
+    size_t n = scan(kind, 1, dl->data, head, elem);
+    for (size_t i = head; i < dl->size; i++) {
+        n += dl->compare_to(dl->data + i * dl->stride, elem) == 0;
+    }
+
+    return n;
+}
+
+/**
+* `dl_simd_index` returns the index of the first element of `dl` equal
+* to `elem`, or `dl->size` if there is none.
+* `dl_simd_supported(dl)` must hold.
+*/
+size_t dl_simd_index(DynList *dl, void *elem) {
+    key_kind kind = kind_of(dl);
+    size_t head = vector_prefix(dl, dl->size);
+
+    size_t index = scan(kind, 0, dl->data, head, elem);
+    if (index < head) {
+        return index;
+    }
+    for (size_t i = head; i < dl->size; i++) {
+        if (dl->compare_to(dl->data + i * dl->stride, elem) == 0) {
+            return i;
+        }
+    }
+
+    return dl->size;
+}
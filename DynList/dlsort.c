@@ -0,0 +1,692 @@
+#include "dynlist.h"
+#include "dynlist_internal.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// Runs shorter than this are extended with binary insertion sort.
+#define MIN_MERGE 32
+// Upper bound for pending runs on the merge stack. Run lengths grow at
+// least like the fibonacci numbers, so 85 suffices for 2^64 elements.
+#define MAX_RUNS 85
+// Partitions smaller than this are finished with insertion sort.
+#define INSERTION_CUTOFF 16
+// Partitions larger than this use the median of three medians as pivot.
+#define NINTHER_THRESHOLD 128
+// `DL_sort_parallel` gives every thread at least this many elements.
+#define PARALLEL_MIN_CHUNK 32768
+
+#define ELEM(s, i) ((s)->base + (size_t)(i) * (s)->stride)
+
+/**
+* `sort_state` bundles everything the sort engines need, so the
+* helpers below neither allocate nor go through `DL_get`/`DL_set`.
+*/
+typedef struct {
+    char    *base;
+    size_t  stride;
+    int     (*compare_to)(void *elem1, void *elem2);
+    // Merge buffer for at most half of the elements (stable sort only).
+    char    *scratch;
+    // Space for a single element used by swaps and insertions.
+    char    *tmp;
+    // Stack of pending runs (stable sort only).
+    size_t  run_base[MAX_RUNS];
+    size_t  run_len[MAX_RUNS];
+    int     n_runs;
+} sort_state;
+
+static inline int cmp_at(sort_state *s, size_t i, size_t j) {
+    return s->compare_to(ELEM(s, i), ELEM(s, j));
+}
+
+static inline void swap_at(sort_state *s, size_t i, size_t j) {
+    copy_elem(s->tmp, ELEM(s, i), s->stride);
+    copy_elem(ELEM(s, i), ELEM(s, j), s->stride);
+    copy_elem(ELEM(s, j), s->tmp, s->stride);
+}
+
+static void reverse_range(sort_state *s, size_t lo, size_t hi) {
+    while (hi - lo > 1) {
+        hi--;
+        swap_at(s, lo, hi);
+        lo++;
+    }
+}
+
+/**
+* `min_run_length` picks a run length in [MIN_MERGE/2, MIN_MERGE] such
+* that `n / min_run` is close to, but not above, a power of two.
+*/
+static size_t min_run_length(size_t n) {
+    size_t r = 0;
+    while (n >= MIN_MERGE) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+/**
+* `upper_bound` returns the number of elements in the sorted range
+* `base[0..len)` that are smaller than or equal to `key`.
+*/
+static size_t upper_bound(sort_state *s, void *key, char *base, size_t len) {
+    size_t lo = 0;
+    while (lo < len) {
+        size_t mid = lo + (len - lo) / 2;
+        if (s->compare_to(key, base + mid * s->stride) < 0) {
+            len = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/**
+* `lower_bound` returns the number of elements in the sorted range
+* `base[0..len)` that are strictly smaller than `key`.
+*/
+static size_t lower_bound(sort_state *s, void *key, char *base, size_t len) {
+    size_t lo = 0;
+    while (lo < len) {
+        size_t mid = lo + (len - lo) / 2;
+        if (s->compare_to(base + mid * s->stride, key) < 0) {
+            lo = mid + 1;
+        } else {
+            len = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+* `binary_insertion_sort` sorts `[lo, hi)` given that `[lo, start)` is
+* already sorted. Equal elements keep their relative order.
+*/
+static void binary_insertion_sort(sort_state *s, size_t lo, size_t hi, size_t start) {
+    for (size_t i = start; i < hi; i++) {
+        copy_elem(s->tmp, ELEM(s, i), s->stride);
+        size_t pos = lo + upper_bound(s, s->tmp, ELEM(s, lo), i - lo);
+        if (pos == i) {
+            continue;
+        }
+        memmove(ELEM(s, pos + 1), ELEM(s, pos), (i - pos) * s->stride);
+        copy_elem(ELEM(s, pos), s->tmp, s->stride);
+    }
+}
+
+/**
+* `count_run` returns the length of the natural run starting at `lo`.
+* Strictly descending runs are reversed in place, so the returned run
+* is always ascending. (Strictness keeps the sort stable.)
+*/
+static size_t count_run(sort_state *s, size_t lo, size_t hi) {
+    size_t run = lo + 1;
+    if (run == hi) {
+        return 1;
+    }
+
+    if (cmp_at(s, run, lo) < 0) {
+        run++;
+        while (run < hi && cmp_at(s, run, run - 1) < 0) {
+            run++;
+        }
+        reverse_range(s, lo, run);
+    } else {
+        run++;
+        while (run < hi && cmp_at(s, run, run - 1) >= 0) {
+            run++;
+        }
+    }
+
+    return run - lo;
+}
+
+/**
+* `merge_lo` merges two adjacent runs where the first one is the
+* shorter one. The first run is moved into the scratch buffer and
+* the result is written front to back.
+*/
+static void merge_lo(sort_state *s, size_t base_a, size_t len_a, size_t len_b) {
+    size_t stride = s->stride;
+    memcpy(s->scratch, ELEM(s, base_a), len_a * stride);
+
+    char *a     = s->scratch;
+    char *a_end = s->scratch + len_a * stride;
+    char *b     = ELEM(s, base_a + len_a);
+    char *b_end = b + len_b * stride;
+    char *dst   = ELEM(s, base_a);
+
+    while (a < a_end && b < b_end) {
+        if (s->compare_to(b, a) < 0) {
+            copy_elem(dst, b, stride);
+            b += stride;
+        } else {
+            copy_elem(dst, a, stride);
+            a += stride;
+        }
+        dst += stride;
+    }
+
+    // Whatever is left of the second run is already in place.
+    memcpy(dst, a, a_end - a);
+}
+
+/**
+* `merge_hi` merges two adjacent runs where the second one is the
+* shorter one. The second run is moved into the scratch buffer and
+* the result is written back to front.
+*/
+static void merge_hi(sort_state *s, size_t base_a, size_t len_a, size_t len_b) {
+    size_t stride = s->stride;
+    memcpy(s->scratch, ELEM(s, base_a + len_a), len_b * stride);
+
+    char *a_begin = ELEM(s, base_a);
+    char *a       = a_begin + len_a * stride;
+    char *b_begin = s->scratch;
+    char *b       = s->scratch + len_b * stride;
+    char *dst     = a + len_b * stride;
+
+    while (a > a_begin && b > b_begin) {
+        dst -= stride;
+        if (s->compare_to(b - stride, a - stride) < 0) {
+            a -= stride;
+            copy_elem(dst, a, stride);
+        } else {
+            b -= stride;
+            copy_elem(dst, b, stride);
+        }
+    }
+
+    // Whatever is left of the first run is already in place.
+    memcpy(a_begin, b_begin, b - b_begin);
+}
+
+/**
+* `merge_at` merges the pending runs `i` and `i+1`. Elements of the
+* first run that are not larger than the head of the second run, and
+* elements of the second run that are not smaller than the tail of the
+* first run, are already in place and are trimmed off beforehand.
+*/
+static void merge_at(sort_state *s, int i) {
+    size_t base_a = s->run_base[i];
+    size_t len_a  = s->run_len[i];
+    size_t base_b = s->run_base[i + 1];
+    size_t len_b  = s->run_len[i + 1];
+
+    s->run_len[i] = len_a + len_b;
+    if (i == s->n_runs - 3) {
+        s->run_base[i + 1] = s->run_base[i + 2];
+        s->run_len[i + 1]  = s->run_len[i + 2];
+    }
+    s->n_runs--;
+
+    size_t k = upper_bound(s, ELEM(s, base_b), ELEM(s, base_a), len_a);
+    base_a += k;
+    len_a  -= k;
+    if (len_a == 0) {
+        return;
+    }
+
+    len_b = lower_bound(s, ELEM(s, base_a + len_a - 1), ELEM(s, base_b), len_b);
+    if (len_b == 0) {
+        return;
+    }
+
+    if (len_a <= len_b) {
+        merge_lo(s, base_a, len_a, len_b);
+    } else {
+        merge_hi(s, base_a, len_a, len_b);
+    }
+}
+
+/**
+* `merge_collapse` restores the timsort invariants on the run stack:
+* len[i-2] > len[i-1] + len[i] and len[i-1] > len[i].
+*/
+static void merge_collapse(sort_state *s) {
+    while (s->n_runs > 1) {
+        int n = s->n_runs - 2;
+        size_t *len = s->run_len;
+        if ((n > 0 && len[n - 1] <= len[n] + len[n + 1]) ||
+            (n > 1 && len[n - 2] <= len[n - 1] + len[n])) {
+            if (len[n - 1] < len[n + 1]) {
+                n--;
+            }
+        } else if (len[n] > len[n + 1]) {
+            break;
+        }
+        merge_at(s, n);
+    }
+}
+
+static void merge_force_collapse(sort_state *s) {
+    while (s->n_runs > 1) {
+        int n = s->n_runs - 2;
+        if (n > 0 && s->run_len[n - 1] < s->run_len[n + 1]) {
+            n--;
+        }
+        merge_at(s, n);
+    }
+}
+
+/**
+* `tim_sort` is a stable natural merge sort. Ascending and strictly
+* descending runs already present in the input are detected and used
+* as is, short runs are extended to `min_run` elements with binary
+* insertion sort. Merging needs at most n/2 elements of scratch space.
+*/
+static void tim_sort(sort_state *s, size_t n) {
+    if (n < MIN_MERGE) {
+        size_t run = count_run(s, 0, n);
+        binary_insertion_sort(s, 0, n, run);
+        return;
+    }
+
+    size_t min_run = min_run_length(n);
+    size_t lo = 0;
+    s->n_runs = 0;
+
+    while (lo < n) {
+        size_t run = count_run(s, lo, n);
+        if (run < min_run) {
+            size_t forced = n - lo < min_run ? n - lo : min_run;
+            binary_insertion_sort(s, lo, lo + forced, lo + run);
+            run = forced;
+        }
+
+        s->run_base[s->n_runs] = lo;
+        s->run_len[s->n_runs]  = run;
+        s->n_runs++;
+        merge_collapse(s);
+
+        lo += run;
+    }
+
+    merge_force_collapse(s);
+}
+
+static void insertion_sort(sort_state *s, size_t lo, size_t hi) {
+    for (size_t i = lo + 1; i < hi; i++) {
+        for (size_t j = i; j > lo && cmp_at(s, j, j - 1) < 0; j--) {
+            swap_at(s, j, j - 1);
+        }
+    }
+}
+
+static void sift_down(sort_state *s, size_t lo, size_t root, size_t n) {
+    for (;;) {
+        size_t child = 2 * root + 1;
+        if (child >= n) {
+            return;
+        }
+        if (child + 1 < n && cmp_at(s, lo + child, lo + child + 1) < 0) {
+            child++;
+        }
+        if (cmp_at(s, lo + root, lo + child) >= 0) {
+            return;
+        }
+        swap_at(s, lo + root, lo + child);
+        root = child;
+    }
+}
+
+static void heap_sort(sort_state *s, size_t lo, size_t hi) {
+    size_t n = hi - lo;
+    for (size_t i = n / 2; i > 0; i--) {
+        sift_down(s, lo, i - 1, n);
+    }
+    for (size_t end = n - 1; end > 0; end--) {
+        swap_at(s, lo, lo + end);
+        sift_down(s, lo, 0, end);
+    }
+}
+
+/**
+* `sort3` orders the elements at `a`, `b` and `c` in place.
+*/
+static void sort3(sort_state *s, size_t a, size_t b, size_t c) {
+    if (cmp_at(s, b, a) < 0) {
+        swap_at(s, a, b);
+    }
+    if (cmp_at(s, c, b) < 0) {
+        swap_at(s, b, c);
+        if (cmp_at(s, b, a) < 0) {
+            swap_at(s, a, b);
+        }
+    }
+}
+
+/**
+* `partition` picks a pivot (median of three, or Tukey's ninther for
+* large ranges), moves it to `lo` and partitions `[lo, hi)` around it.
+* Elements equal to the pivot stop both scans, so inputs with few
+* unique keys still split evenly. Returns the final position of the pivot.
+*/
+static size_t partition(sort_state *s, size_t lo, size_t hi) {
+    size_t n   = hi - lo;
+    size_t mid = lo + n / 2;
+    if (n > NINTHER_THRESHOLD) {
+        size_t d = n / 8;
+        sort3(s, lo + 1, lo + 1 + d, lo + 1 + 2 * d);
+        sort3(s, mid - d, mid, mid + d);
+        sort3(s, hi - 2 - 2 * d, hi - 2 - d, hi - 2);
+        sort3(s, lo + 1 + d, mid, hi - 2 - d);
+    } else {
+        sort3(s, lo + 1, mid, hi - 1);
+    }
+    // `lo` itself is not sampled: after a previous partition step it
+    // holds the maximum of the range.
+    swap_at(s, lo, mid);
+
+    size_t i = lo;
+    size_t j = hi;
+    for (;;) {
+        do {
+            i++;
+        } while (i < hi && cmp_at(s, i, lo) < 0);
+        do {
+            j--;
+        } while (cmp_at(s, j, lo) > 0);
+        if (i >= j) {
+            break;
+        }
+        swap_at(s, i, j);
+    }
+    swap_at(s, lo, j);
+
+    return j;
+}
+
+/**
+* `intro_sort` is an in-place quicksort that falls back to heap sort
+* once the recursion gets too deep, bounding it at O(n log n). Only the
+* smaller partition is recursed into, so the stack stays O(log n).
+*/
+static void intro_sort(sort_state *s, size_t lo, size_t hi, int depth) {
+    while (hi - lo > INSERTION_CUTOFF) {
+        if (depth == 0) {
+            heap_sort(s, lo, hi);
+            return;
+        }
+        depth--;
+
+        size_t p = partition(s, lo, hi);
+        if (p - lo < hi - p) {
+            intro_sort(s, lo, p, depth);
+            lo = p + 1;
+        } else {
+            intro_sort(s, p + 1, hi, depth);
+            hi = p;
+        }
+    }
+    insertion_sort(s, lo, hi);
+}
+
+/**
+* `DL_sort` sorts the given DynList `dl` based on the
+* specified compare function `compare_to`. This is done inplace
+* and the sort is stable.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_sort(DynList *dl) {
+    return DL_sort_ex(dl, DL_SORT_STABLE);
+}
+
+/**
+* `DL_sort_ex` sorts `dl` in place based on `compare_to`.
+* With `DL_SORT_STABLE` a natural merge sort (timsort) is used which
+* keeps equal elements in order and is fast on partially sorted input.
+* It allocates a single scratch buffer of n/2 elements up front.
+* With `DL_SORT_UNSTABLE` an introsort is used which needs no scratch
+* buffer besides a single element.
+* Afterwards `dl` is in sorted mode, see `DL_lower_bound`.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_sort_ex(DynList *dl, int flags) {
+    if (dl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_sort error: provided DynList is NULL.");
+        return -1;
+    }
+
+    if (dl->compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_sort error: DynList doesn't have a compare_to function specified.");
+        return -1;
+    }
+
+    if (dl->size < 2) {
+        dl->sorted = 1;
+        return 0;
+    }
+
+    sort_state s = {
+        .base       = dl->data,
+        .stride     = dl->stride,
+        .compare_to = dl->compare_to,
+    };
+
+    // One element for `tmp`, plus n/2 elements to merge with.
+    size_t n_buf = 1;
+    if (!(flags & DL_SORT_UNSTABLE) && dl->size >= MIN_MERGE) {
+        n_buf += dl->size / 2;
+    }
+    if (n_buf > SIZE_MAX / dl->stride) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "DL_sort error: scratch buffer size overflows.");
+        return -1;
+    }
+
+    CLIB_Allocator *a = &dl->allocator;
+    char *buffer = (char *) a->alloc(a->ctx, n_buf * dl->stride);
+    if (buffer == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_sort error: failed to allocate scratch buffer: %s", strerror(errno));
+        return -1;
+    }
+    s.tmp     = buffer;
+    s.scratch = buffer + dl->stride;
+
+    if (flags & DL_SORT_UNSTABLE) {
+        int depth = 0;
+        for (size_t n = dl->size; n > 1; n >>= 1) {
+            depth += 2;
+        }
+        intro_sort(&s, 0, dl->size, depth);
+    } else {
+        tim_sort(&s, dl->size);
+    }
+
+    a->free(a->ctx, buffer, n_buf * dl->stride);
+    dl->sorted = 1;
+
+    return 0;
+}
+
+/**
+* `par_sort` is shared by the threads of `DL_sort_parallel`. The list
+* is cut into one chunk per thread, the chunks are sorted concurrently
+* and then merged pairwise in rounds, alternating between `data` and
+* `buf`. In each round every thread writes an equal share of the
+* output, splitting the merges with merge path partitioning.
+*/
+typedef struct {
+    char    *data;
+    char    *buf;
+    char    *tmp;
+    size_t  n;
+    size_t  stride;
+    int     (*compare_to)(void *elem1, void *elem2);
+    int     nthreads;
+    // Phase to run: 0 sorts chunks, 1 merges `src` into `dst`, 2 copies `src` to `dst`.
+    int     phase;
+    char    *src;
+    char    *dst;
+    // Sorted runs of `src` are [bounds[i], bounds[i + 1]).
+    size_t  bounds[DL_POOL_MAX_THREADS + 1];
+    int     n_runs;
+} par_sort;
+
+/**
+* `merge_path` returns how many of the first `diag` merged elements of
+* `a` and `b` come from `a`. Ties go to `a`, like in the sequential merge.
+*/
+static size_t merge_path(par_sort *ps, char *a, size_t len_a, char *b, size_t len_b, size_t diag) {
+    size_t lo = diag > len_b ? diag - len_b : 0;
+    size_t hi = diag < len_a ? diag : len_a;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ps->compare_to(a + mid * ps->stride, b + (diag - mid - 1) * ps->stride) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void merge_into(par_sort *ps, char *dst, char *a, size_t len_a, char *b, size_t len_b) {
+    size_t stride = ps->stride;
+    while (len_a > 0 && len_b > 0) {
+        if (ps->compare_to(b, a) < 0) {
+            copy_elem(dst, b, stride);
+            b += stride;
+            len_b--;
+        } else {
+            copy_elem(dst, a, stride);
+            a += stride;
+            len_a--;
+        }
+        dst += stride;
+    }
+    memcpy(dst, a, len_a * stride);
+    memcpy(dst + len_a * stride, b, len_b * stride);
+}
+
+// Merges the part of the current round's output in [out_lo, out_hi).
+static void merge_share(par_sort *ps, size_t out_lo, size_t out_hi) {
+    size_t stride = ps->stride;
+    for (int k = 0; k < ps->n_runs; k += 2) {
+        size_t a0 = ps->bounds[k];
+        size_t a1 = ps->bounds[k + 1];
+        size_t b1 = k + 2 <= ps->n_runs ? ps->bounds[k + 2] : a1;
+        if (a0 >= out_hi) {
+            break;
+        }
+        size_t lo = out_lo > a0 ? out_lo : a0;
+        size_t hi = out_hi < b1 ? out_hi : b1;
+        if (lo >= hi) {
+            continue;
+        }
+
+        char *a = ps->src + a0 * stride;
+        char *b = ps->src + a1 * stride;
+        size_t len_a = a1 - a0, len_b = b1 - a1;
+        size_t i_lo = merge_path(ps, a, len_a, b, len_b, lo - a0);
+        size_t i_hi = merge_path(ps, a, len_a, b, len_b, hi - a0);
+        size_t j_lo = lo - a0 - i_lo, j_hi = hi - a0 - i_hi;
+        merge_into(ps, ps->dst + lo * stride, a + i_lo * stride, i_hi - i_lo,
+                   b + j_lo * stride, j_hi - j_lo);
+    }
+}
+
+static void par_sort_job(void *arg, int id) {
+    par_sort *ps = (par_sort *) arg;
+    size_t lo = ps->n * id / ps->nthreads;
+    size_t hi = ps->n * (id + 1) / ps->nthreads;
+
+    if (ps->phase == 0) {
+        // The chunk's part of `buf` serves as its merge buffer.
+        sort_state s = {
+            .base       = ps->data + lo * ps->stride,
+            .stride     = ps->stride,
+            .compare_to = ps->compare_to,
+            .scratch    = ps->buf + lo * ps->stride,
+            .tmp        = ps->tmp + id * ps->stride,
+        };
+        tim_sort(&s, hi - lo);
+    } else if (ps->phase == 1) {
+        merge_share(ps, lo, hi);
+    } else {
+        memcpy(ps->dst + lo * ps->stride, ps->src + lo * ps->stride, (hi - lo) * ps->stride);
+    }
+}
+
+/**
+* `DL_sort_parallel` sorts `dl` like `DL_sort` (stable, identical
+* result), using up to `nthreads` threads. With `nthreads <= 0` the
+* number of online CPUs is used. Every thread gets at least
+* `PARALLEL_MIN_CHUNK` elements, so small lists are sorted on the
+* calling thread. Needs a scratch buffer of n elements.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_sort_parallel(DynList *dl, int nthreads) {
+    if (dl == NULL || dl->compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_sort_parallel error: provided DynList is NULL or has no compare_to function.");
+        return -1;
+    }
+
+    nthreads = dl_pool_threads(nthreads, dl->size, PARALLEL_MIN_CHUNK);
+    if (nthreads <= 1) {
+        return DL_sort_ex(dl, DL_SORT_STABLE);
+    }
+
+    size_t n_buf = dl->size + nthreads;
+    if (n_buf > SIZE_MAX / dl->stride) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "DL_sort_parallel error: scratch buffer size overflows.");
+        return -1;
+    }
+
+    CLIB_Allocator *a = &dl->allocator;
+    char *buffer = (char *) a->alloc(a->ctx, n_buf * dl->stride);
+    if (buffer == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_sort_parallel error: failed to allocate scratch buffer: %s", strerror(errno));
+        return -1;
+    }
+
+    par_sort ps = {
+        .data       = dl->data,
+        .buf        = buffer,
+        .tmp        = buffer + dl->size * dl->stride,
+        .n          = dl->size,
+        .stride     = dl->stride,
+        .compare_to = dl->compare_to,
+        .nthreads   = nthreads,
+        .n_runs     = nthreads,
+    };
+    for (int i = 0; i <= nthreads; i++) {
+        ps.bounds[i] = ps.n * i / nthreads;
+    }
+
+    ps.phase = 0;
+    dl_pool_run(par_sort_job, &ps, ps.nthreads);
+
+    ps.phase = 1;
+    ps.src   = ps.data;
+    ps.dst   = ps.buf;
+    while (ps.n_runs > 1) {
+        dl_pool_run(par_sort_job, &ps, ps.nthreads);
+
+        // Every pair of runs became one run.
+        int k = 0;
+        for (int i = 0; i < ps.n_runs; i += 2) {
+            ps.bounds[k++] = ps.bounds[i];
+        }
+        ps.bounds[k] = ps.n;
+        ps.n_runs    = k;
+
+        char *t = ps.src;
+        ps.src  = ps.dst;
+        ps.dst  = t;
+    }
+
+    if (ps.src != ps.data) {
+        ps.phase = 2;
+        ps.dst   = ps.data;
+        dl_pool_run(par_sort_job, &ps, ps.nthreads);
+    }
+
+    a->free(a->ctx, buffer, n_buf * dl->stride);
+    dl->sorted = 1;
+
+    return 0;
+}
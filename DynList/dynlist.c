@@ -1,31 +1,143 @@
 #include "dynlist.h"
+#include "dynlist_internal.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 
+/**
+* `in_order_at` returns 1 if the element at `index` is not smaller than
+* its predecessor and not larger than its successor, 0 otherwise. Used
+* to keep the `sorted` flag up to date on mutations.
+*/
+static int in_order_at(DynList *dl, size_t index) {
+    char *elem = dl->data + index * dl->stride;
+    if (index > 0 && dl->compare_to(elem - dl->stride, elem) > 0) {
+        return 0;
+    }
+    if (index + 1 < dl->size && dl->compare_to(elem, elem + dl->stride) > 0) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+* `range_in_order` is `in_order_at` for all elements in `[start, end)`.
+*/
+static int range_in_order(DynList *dl, size_t start, size_t end) {
+    size_t lo = start > 0 ? start - 1 : 0;
+    size_t hi = end < dl->size ? end + 1 : dl->size;
+    for (size_t i = lo + 1; i < hi; i++) {
+        char *elem = dl->data + i * dl->stride;
+        if (dl->compare_to(elem - dl->stride, elem) > 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int dl_range_in_order(DynList *dl, size_t start, size_t end) {
+    return range_in_order(dl, start, end);
+}
+
+/**
+* `set_capacity` reallocates the data of `dl` such that it holds
+* exactly `capacity` elements. `caller` is used for error messages.
+* Returns 0 on success, -1 otherwise.
+*/
+static int set_capacity(DynList *dl, size_t capacity, const char *caller) {
+    if (capacity > SIZE_MAX / dl->stride) {
+        CLIB_FAIL(CLIB_EOVERFLOW, "%s error: capacity of %zu elements overflows.", caller, capacity);
+        return -1;
+    }
+
+    if (dl->mapping != NULL) {
+        return dl_mmap_resize(dl, capacity, caller);
+    }
+
+    char *new_data = (char *) dl->allocator.realloc(dl->allocator.ctx, dl->data,
+                                                    dl->stride * dl->capacity,
+                                                    dl->stride * capacity);
+    if (new_data == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "%s failed to reallocate memory to change capacity of DynList: %s", caller, strerror(errno));
+        return -1;
+    }
+
+    // Update dl pointer and capacity.
+    dl->data     = new_data;
+    dl->capacity = capacity;
+
+    return 0;
+}
+
+/**
+* `grow` makes sure `dl` can hold at least `min_capacity` elements.
+* The capacity is doubled until it is sufficient, so repeated growth
+* stays amortized O(1) per element and reallocates at most once.
+* Returns 0 on success, -1 otherwise.
+*/
+static int grow(DynList *dl, size_t min_capacity, const char *caller) {
+    if (min_capacity <= dl->capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = dl->capacity > 0 ? dl->capacity : DEFAULT_CAPACITY;
+    while (new_capacity < min_capacity) {
+        if (new_capacity > SIZE_MAX / 2) {
+            new_capacity = min_capacity;
+            break;
+        }
+        new_capacity *= 2;
+    }
+
+    return set_capacity(dl, new_capacity, caller);
+}
+
 /**
 * `DL_create` allocates data for the DynList struct and it's data
 * with the speicified `capacity` and size of elements `stride` on 
 * the heap. In case of allocation failure it returns `NULL`.
 */
 DynList* DL_create(size_t capacity, size_t stride, int (*compare_to)(void *elem1, void *elem2)) {
-    // Allocate memory on the heap for the DynList struct.
-    DynList *dl  = (DynList *) calloc(1, sizeof(DynList)); 
+    return DL_create_with_allocator(capacity, stride, compare_to, NULL);
+}
+
+/**
+* `DL_create_with_allocator` works like `DL_create`, but all memory of
+* the DynList (the struct, its data and scratch space for sorting) is
+* obtained from `allocator`. If `allocator` is `NULL` malloc/realloc/free
+* are used. In case of allocation failure it returns `NULL`.
+*/
+DynList* DL_create_with_allocator(size_t capacity, size_t stride,
+                                  int (*compare_to)(void *elem1, void *elem2),
+                                  const CLIB_Allocator *allocator) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    if (stride == 0 || capacity > SIZE_MAX / stride) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_create error: invalid stride or capacity.");
+        return NULL;
+    }
+
+    // Allocate memory for the DynList struct.
+    DynList *dl  = (DynList *) a.alloc(a.ctx, sizeof(DynList));
     if (dl == NULL) {
-        fprintf(stderr, "Error allocating memory for DynList struct: %s\n", strerror(errno));
+        CLIB_FAIL(CLIB_ENOMEM, "Error allocating memory for DynList struct: %s", strerror(errno));
         return NULL;
     }
 
     // Initialize components
+    memset(dl, 0, sizeof(DynList));
     dl->capacity   = capacity;
     dl->stride     = stride;
     dl->size       = 0;
     dl->compare_to = compare_to;
+    dl->sorted     = 0;
+    dl->allocator  = a;
 
     // Allocate memory for data.
-    dl->data     = (char *) calloc(capacity, stride);
-    if (dl->data == NULL) {
-        fprintf(stderr, "Error allocating memory for DynList Data: %s\n", strerror(errno));
-        free(dl);
+    dl->data     = (char *) a.alloc(a.ctx, capacity * stride);
+    if (dl->data == NULL && capacity > 0) {
+        CLIB_FAIL(CLIB_ENOMEM, "Error allocating memory for DynList Data: %s", strerror(errno));
+        a.free(a.ctx, dl, sizeof(DynList));
         return NULL;
     }
 
@@ -42,13 +154,21 @@ void DL_free(DynList *dl) {
         return;
     }
 
+    CLIB_Allocator a = dl->allocator;
+
+    if (dl->concurrent != NULL) {
+        dl_concurrent_free(dl);
+    }
+
     // Free data of DynList.
-    if (dl->data != NULL) {
-        free(dl->data);
+    if (dl->mapping != NULL) {
+        dl_mmap_close(dl);
+    } else if (dl->data != NULL) {
+        a.free(a.ctx, dl->data, dl->capacity * dl->stride);
     }
 
     // Free DynList struct.
-    free(dl);
+    a.free(a.ctx, dl, sizeof(DynList));
 }
 
 
@@ -59,32 +179,23 @@ void DL_free(DynList *dl) {
 */
 int DL_append(DynList *dl, void *element) {
     if (dl == NULL) {
-        fprintf(stderr, "Non-initialized DynList was given: Can't append.");
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DynList was given: Can't append.");
         return -1;
     }
 
     // Reallocate data if list is full.
-    if (dl->size == dl->capacity) {
-        // Allocate new data.
-        char *new_data = (char *) realloc(dl->data, dl->stride * dl->capacity * 2);
-        if (new_data == NULL) {
-            fprintf(stderr, "DL_append failed to reallocate memory to increase capacity of DynList: %s\n", strerror(errno));
-            return -1;
-        }
-
-        // Update dl pointer and capacity.
-        dl->data = new_data;
-        dl->capacity *= 2;
+    if (dl->size == dl->capacity && grow(dl, dl->size + 1, "DL_append") != 0) {
+        return -1;
     }
 
     // Copy new element into DynList.
-    void *new_item = memcpy(dl->data + dl->stride * dl->size, element, dl->stride);
-    if (new_item == NULL) {
-        fprintf(stderr, "memcpy failed to copy new element into DynList.\n");
-        return -1;
-    }
+    memcpy(dl->data + dl->stride * dl->size, element, dl->stride);
     dl->size++;
 
+    if (dl->sorted && !in_order_at(dl, dl->size - 1)) {
+        dl->sorted = 0;
+    }
+
     return 0;
 }
 
@@ -97,12 +208,12 @@ int DL_append(DynList *dl, void *element) {
 */
 void* DL_get(DynList *dl, size_t index) {
     if (dl == NULL) {
-        fprintf(stderr, "Non-initialized DynList was given to DL_get.");
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DynList was given to DL_get.");
         return NULL;
     }
 
     if (index >= dl->size) {
-        fprintf(stderr, "Index out of bounds for DL_get: index=%zu, size=%zu\n", index, dl->size);
+        CLIB_FAIL(CLIB_ERANGE, "Index out of bounds for DL_get: index=%zu, size=%zu", index, dl->size);
         return NULL;
     }
 
@@ -117,40 +228,57 @@ void* DL_get(DynList *dl, size_t index) {
  */
 void* DL_pop(DynList *dl, size_t index) {
     if (dl == NULL) {
-        fprintf(stderr, "Non-initialized DynList was given to DL_pop.");
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DynList was given to DL_pop.");
         return NULL;
     }
 
     if (index >= dl->size) {
-        fprintf(stderr, "Index out of bounds for DL_pop: index=%zu, size=%zu\n", index, dl->size);
+        CLIB_FAIL(CLIB_ERANGE, "Index out of bounds for DL_pop: index=%zu, size=%zu", index, dl->size);
         return NULL;
     }
 
     // Allocate memory for return
     void *result = malloc(dl->stride);
     if (result == NULL) {
-        fprintf(stderr, "Memory allocation for result failed in DL_pop.\n");
+        CLIB_FAIL(CLIB_ENOMEM, "Memory allocation for result failed in DL_pop.");
         return NULL;
     }
 
-    // copy over element
-    if (memcpy(result, dl->data + index * dl->stride, dl->stride) == NULL) {
-        fprintf(stderr, "Failed to copy return value to different address.\n");
+    if (DL_pop_into(dl, index, result) != 0) {
+        free(result);
         return NULL;
     }
 
-    // Move elements in DynList one element to the left.
-    void *dst = memmove(dl->data + (index) * dl->stride,
-                        dl->data + (index+1) * dl->stride, 
-                        dl->stride * (dl->size - index - 1));
-    if (dst == NULL) {
-        fprintf(stderr, "DL_pop failed to move elements to the left: %s\n", strerror(errno));
-        return NULL;
+    return result;
+}
+
+/**
+* `DL_pop_into` copies the element at the given `index` into `out`
+* and removes it from `dl`. Unlike `DL_pop` nothing is allocated.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_pop_into(DynList *dl, size_t index, void *out) {
+    if (dl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DynList was given to DL_pop_into.");
+        return -1;
+    }
+
+    if (index >= dl->size) {
+        CLIB_FAIL(CLIB_ERANGE, "Index out of bounds for DL_pop_into: index=%zu, size=%zu", index, dl->size);
+        return -1;
     }
 
+    // copy over element
+    memcpy(out, dl->data + index * dl->stride, dl->stride);
+
+    // Move elements in DynList one element to the left.
+    memmove(dl->data + index * dl->stride,
+            dl->data + (index + 1) * dl->stride,
+            dl->stride * (dl->size - index - 1));
+
     dl->size--;
 
-    return result;
+    return 0;
 }
 
 /**
@@ -159,7 +287,7 @@ void* DL_pop(DynList *dl, size_t index) {
 */
 void DL_clear(DynList *dl) {
     if (dl == NULL) {
-        fprintf(stderr, "Non-initialized DynList was given to DL_clear.");
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DynList was given to DL_clear.");
         return;
     }
 
@@ -173,7 +301,7 @@ void DL_clear(DynList *dl) {
 */
 int DL_size(DynList *dl) {
     if (dl == NULL) {
-        fprintf(stderr, "Non-initialized DynList was given to DL_size.");
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DynList was given to DL_size.");
         return -1;
     }
     return dl->size;
@@ -185,7 +313,7 @@ int DL_size(DynList *dl) {
 */
 int DL_is_empty(DynList *dl) {
     if (dl == NULL) {
-        fprintf(stderr, "Non-initialized DynList was given to DL_is_empty.");
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DynList was given to DL_is_empty.");
         return -1;
     }
     return dl->size == 0 ? 0 : 1;
@@ -197,42 +325,29 @@ int DL_is_empty(DynList *dl) {
 */
 int DL_insert(DynList *dl, void *element, size_t index) {
     if (dl == NULL) {
-        fprintf(stderr, "Non-initialized DynList was given to DL_insert.");
+        CLIB_FAIL(CLIB_EINVAL, "Non-initialized DynList was given to DL_insert.");
         return -1;
     }
 
     // Check if DynList capacity needs to be doubled
-    if (dl->size == dl->capacity) {
-        // Allocate new data.
-        char *new_data = (char *) realloc(dl->data, dl->stride * dl->capacity * 2);
-        if (new_data == NULL) {
-            fprintf(stderr, "DL_insert failed to reallocate memory to increase capacity of DynList: %s\n", strerror(errno));
-            return -1;
-        }
-
-        // Update dl pointer and capacity.
-        dl->data = new_data;
-        dl->capacity *= 2;
+    if (dl->size == dl->capacity && grow(dl, dl->size + 1, "DL_insert") != 0) {
+        return -1;
     }
 
     // copy dl[index] - dl[size-1] one slot to the right
-    void *dst = memmove(dl->data + (index+1) * dl->stride,
+    memmove(dl->data + (index+1) * dl->stride,
                         dl->data + index * dl->stride, 
                         dl->stride * (dl->size - index));
-    if (dst == NULL) {
-        fprintf(stderr, "DL_insert failed to move elements: %s\n", strerror(errno));
-        return -1;
-    }
 
     // insert new item
-    dst = memcpy(dl->data + index * dl->stride, element, dl->stride);
-    if (dst == NULL) {
-        fprintf(stderr, "DL_insert failed to copy new element into list: %s\n", strerror(errno));
-        return -1;
-    }
+    memcpy(dl->data + index * dl->stride, element, dl->stride);
 
     dl->size++;
 
+    if (dl->sorted && !in_order_at(dl, index)) {
+        dl->sorted = 0;
+    }
+
     return 0;
 }
 
@@ -243,21 +358,21 @@ int DL_insert(DynList *dl, void *element, size_t index) {
 */
 int DL_set(DynList *dl, void *element, int index) {
     if (dl == NULL) {
-        fprintf(stderr, "DL_set error: provided DynList is NULL.\n");
+        CLIB_FAIL(CLIB_EINVAL, "DL_set error: provided DynList is NULL.");
         return -1;
     }
 
     // check for out of bounds index.
     if (index >= dl->size) {
-        fprintf(stderr, "DL_set error: index out of bounds.\n");
+        CLIB_FAIL(CLIB_ERANGE, "DL_set error: index out of bounds.");
         return -1;
     }
 
     // Copy bytes of elem into specified index.
-    void *dst = memcpy(dl->data + dl->stride * index, element, dl->stride);
-    if (dst == NULL) {
-        fprintf(stderr, "DL_set error: Failed to copy element into DynList.\n");
-        return -1;
+    memcpy(dl->data + dl->stride * index, element, dl->stride);
+
+    if (dl->sorted && !in_order_at(dl, index)) {
+        dl->sorted = 0;
     }
 
     return 0;
@@ -270,42 +385,31 @@ int DL_set(DynList *dl, void *element, int index) {
 */
 int DL_extend(DynList *dl1, DynList *dl2) {
     if (dl1 == NULL || dl2 == NULL) {
-        fprintf(stderr, "DL_extend error: one of the provided DynList is NULL.\n");
+        CLIB_FAIL(CLIB_EINVAL, "DL_extend error: one of the provided DynList is NULL.");
         return -1;
     }
 
     if (dl1->stride != dl2->stride) {
-        fprintf(stderr, "DL_extend error: functions with different strides given.\n");
+        CLIB_FAIL(CLIB_EINVAL, "DL_extend error: functions with different strides given.");
         return -1;
     }
 
-    // find new capacity
-    size_t new_capacity = dl1->capacity;
-    while (new_capacity < dl1->size + dl2->size) {
-        new_capacity *= 2;
-    }
-
     // Adjust capacity of dl1
-    if (new_capacity != dl1->capacity) {
-        // Allocate new data.
-        char *new_data = (char *) realloc(dl1->data, dl1->stride * new_capacity);
-        if (new_data == NULL) {
-            fprintf(stderr, "DL_extend failed to reallocate memory to increase capacity of DynList: %s\n", strerror(errno));
-            return -1;
-        }
-
-        // Update dl pointer and capacity.
-        dl1->data = new_data;
-        dl1->capacity = new_capacity;
+    if (grow(dl1, dl1->size + dl2->size, "DL_extend") != 0) {
+        return -1;
     }
 
     // copy over data
-    void *dst = memcpy(dl1->data + dl1->stride * dl1->size, 
+    memcpy(dl1->data + dl1->stride * dl1->size, 
                        dl2->data, 
                        dl2->size * dl2->stride);
-    if (dst == NULL) {
-        fprintf(stderr, "DL_extend error: Failed to copy data to dl1.\n");
-        return -1;
+
+    // dl1 stays sorted if dl2 is sorted the same way and continues it.
+    if (dl1->sorted && dl2->size > 0) {
+        if (!dl2->sorted || dl2->compare_to != dl1->compare_to ||
+            (dl1->size > 0 && !in_order_at(dl1, dl1->size))) {
+            dl1->sorted = 0;
+        }
     }
 
     // update size
@@ -314,23 +418,156 @@ int DL_extend(DynList *dl1, DynList *dl2) {
     return 0;
 }
 
+/**
+* `DL_reserve` makes sure `dl` can hold at least `capacity` elements
+* without reallocating. The capacity is never reduced.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_reserve(DynList *dl, size_t capacity) {
+    if (dl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_reserve error: provided DynList is NULL.");
+        return -1;
+    }
+
+    if (capacity <= dl->capacity) {
+        return 0;
+    }
+
+    return set_capacity(dl, capacity, "DL_reserve");
+}
+
+/**
+* `DL_shrink_to_fit` reduces the capacity of `dl` to its size
+* (but at least 1 element) and releases the remaining memory.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_shrink_to_fit(DynList *dl) {
+    if (dl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_shrink_to_fit error: provided DynList is NULL.");
+        return -1;
+    }
+
+    size_t capacity = dl->size > 0 ? dl->size : 1;
+    if (capacity == dl->capacity) {
+        return 0;
+    }
+
+    return set_capacity(dl, capacity, "DL_shrink_to_fit");
+}
+
+/**
+* `DL_append_n` appends `count` elements stored contiguously at
+* `elements` to `dl`. The list is resized at most once and the
+* elements are copied with a single memcpy. `elements` must not point
+* into `dl` itself.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_append_n(DynList *dl, void *elements, size_t count) {
+    if (dl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_append_n error: provided DynList is NULL.");
+        return -1;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    if (count > SIZE_MAX - dl->size || grow(dl, dl->size + count, "DL_append_n") != 0) {
+        return -1;
+    }
+
+    memcpy(dl->data + dl->stride * dl->size, elements, dl->stride * count);
+    dl->size += count;
+
+    if (dl->sorted && !range_in_order(dl, dl->size - count, dl->size)) {
+        dl->sorted = 0;
+    }
+
+    return 0;
+}
+
+/**
+* `DL_insert_n` inserts `count` elements stored contiguously at
+* `elements` into `dl`, such that the first one ends up at `index`.
+* The list is resized at most once and the tail is moved once.
+* `elements` must not point into `dl` itself.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_insert_n(DynList *dl, void *elements, size_t count, size_t index) {
+    if (dl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_insert_n error: provided DynList is NULL.");
+        return -1;
+    }
+
+    if (index > dl->size) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_insert_n error: index out of bounds: index=%zu, size=%zu", index, dl->size);
+        return -1;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    if (count > SIZE_MAX - dl->size || grow(dl, dl->size + count, "DL_insert_n") != 0) {
+        return -1;
+    }
+
+    // move dl[index] - dl[size-1] count slots to the right
+    memmove(dl->data + (index + count) * dl->stride,
+            dl->data + index * dl->stride,
+            dl->stride * (dl->size - index));
+    memcpy(dl->data + index * dl->stride, elements, dl->stride * count);
+    dl->size += count;
+
+    if (dl->sorted && !range_in_order(dl, index, index + count)) {
+        dl->sorted = 0;
+    }
+
+    return 0;
+}
+
+/**
+* `DL_remove_range` removes the elements from index `start` to `end`
+* from `dl`, of which `start` is inclusive while `end` is exclusive.
+* The remaining tail is moved once.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_remove_range(DynList *dl, size_t start, size_t end) {
+    if (dl == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_remove_range error: provided DynList is NULL.");
+        return -1;
+    }
+
+    if (start > end || end > dl->size) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_remove_range error: index out of bounds: start=%zu, end=%zu, size=%zu", start, end, dl->size);
+        return -1;
+    }
+
+    memmove(dl->data + start * dl->stride,
+            dl->data + end * dl->stride,
+            dl->stride * (dl->size - end));
+    dl->size -= end - start;
+
+    return 0;
+}
+
 
 /**
 * `DL_reverse` reverses `dl` in place. returns 0 on success, -1 otherwise.
 */
 int DL_reverse(DynList *dl) {
     if (dl == NULL) {
-        fprintf(stderr, "DL_reverse error: provided DynList is NULL.\n");
+        CLIB_FAIL(CLIB_EINVAL, "DL_reverse error: provided DynList is NULL.");
         return -1;
     }
 
+    if (dl->size > 1) {
+        dl->sorted = 0;
+    }
+
     char temp[dl->stride];
     for (int i = 0; i < dl->size / 2; i++) {
-        void *dst = memcpy(temp, dl->data + dl->stride * i, dl->stride);
-        if (dst == NULL) {
-            fprintf(stderr, "DL_reverse error: failed to copy data into temporary variable.\n");
-            return -1;
-        }
+        memcpy(temp, dl->data + dl->stride * i, dl->stride);
         DL_set(dl, dl->data + dl->stride * (dl->size - i - 1), i);
         DL_set(dl, temp, dl->size - i - 1);
     }
@@ -344,10 +581,18 @@ int DL_reverse(DynList *dl) {
 */
 int DL_count(DynList *dl, void *elem) {
     if (dl == NULL) {
-        fprintf(stderr, "DL_count error: provided DynList is NULL.\n");
+        CLIB_FAIL(CLIB_EINVAL, "DL_count error: provided DynList is NULL.");
         return -1;
     }
 
+    if (dl->sorted) {
+        return DL_upper_bound(dl, elem) - DL_lower_bound(dl, elem);
+    }
+
+    if (dl_simd_supported(dl)) {
+        return dl_simd_count(dl, elem);
+    }
+
     int n = 0;
     for (int i = 0; i < dl->size; i++) {
         if (dl->compare_to(dl->data + dl->stride * i, elem) == 0) {
@@ -364,10 +609,18 @@ int DL_count(DynList *dl, void *elem) {
 */
 int DL_contains(DynList *dl, void *elem) {
     if (dl == NULL) {
-        fprintf(stderr, "DL_contains error: provided DynList is NULL.\n");
+        CLIB_FAIL(CLIB_EINVAL, "DL_contains error: provided DynList is NULL.");
         return -1;
     }
 
+    if (dl->sorted) {
+        return DL_bsearch(dl, elem) >= 0;
+    }
+
+    if (dl_simd_supported(dl)) {
+        return dl_simd_index(dl, elem) < dl->size;
+    }
+
     for (int i = 0; i < dl->size; i++) {
         if (dl->compare_to(dl->data + dl->stride * i, elem) == 0) {
             return 1;
@@ -384,10 +637,19 @@ int DL_contains(DynList *dl, void *elem) {
 */
 int DL_index(DynList *dl, void *elem) {
     if (dl == NULL) {
-        fprintf(stderr, "DL_index error: provided DynList is NULL.\n");
+        CLIB_FAIL(CLIB_EINVAL, "DL_index error: provided DynList is NULL.");
         return -1;
     }
 
+    if (dl->sorted) {
+        return DL_bsearch(dl, elem);
+    }
+
+    if (dl_simd_supported(dl)) {
+        size_t index = dl_simd_index(dl, elem);
+        return index < dl->size ? (int) index : -2;
+    }
+
     for (int i = 0; i < dl->size; i++) {
         if (dl->compare_to(dl->data + dl->stride * i, elem) == 0) {
             return i;
@@ -398,96 +660,134 @@ int DL_index(DynList *dl, void *elem) {
 }
 
 /**
-* `DL_copy` returns a new DynList that contains the elements
-* from index `start` to `end`, of which `start` is inclusive
-* while `end` is exclusive.
+* `bound` returns the index of the first element of the sorted `dl`
+* that is not smaller than `elem` (`upper == 0`), or larger than `elem`
+* (`upper == 1`).
 */
-DynList *DL_copy(DynList *dl, int start, int end) {
-    if (dl == NULL) {
-        fprintf(stderr, "DL_copy error: provided DynList is NULL.\n");
-        return NULL;
+static size_t bound(DynList *dl, void *elem, int upper) {
+    size_t lo = 0;
+    size_t hi = dl->size;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = dl->compare_to(dl->data + mid * dl->stride, elem);
+        if (c < 0 || (upper && c == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
+    return lo;
+}
 
-    // Check for index out of bounds.
-    if (start < 0 || end > dl->size || start >= end) {
-        fprintf(stderr, "DL_copy error: index out of bounds.\n");
-        return NULL;
+/**
+* `DL_lower_bound` returns the index of the first element in `dl`
+* that is not smaller than `elem`, or the size of `dl` if there is none.
+* `dl` needs to be sorted with respect to `compare_to`.
+* Returns -1 on failure.
+*/
+int DL_lower_bound(DynList *dl, void *elem) {
+    if (dl == NULL || dl->compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_lower_bound error: provided DynList is NULL or has no compare_to function.");
+        return -1;
     }
 
-    // Create new DynList.
-    DynList *res = DL_create(2*(end - start), dl->stride, dl->compare_to);
-    if (res == NULL) {
-        fprintf(stderr, "DL_copy error: failed to create new DynList.\n");
-        return NULL;
-    }
+    return bound(dl, elem, 0);
+}
 
-    // Copy data into new DynList
-    void *dst = memcpy(res->data, 
-                       dl->data + dl->stride * start, 
-                       dl->stride * (end - start));
-    if (dst == NULL) {
-        fprintf(stderr, "DL_copy error: Copying data into new DynList failed.\n");
-        return NULL;
+/**
+* `DL_upper_bound` returns the index of the first element in `dl`
+* that is larger than `elem`, or the size of `dl` if there is none.
+* `dl` needs to be sorted with respect to `compare_to`.
+* Returns -1 on failure.
+*/
+int DL_upper_bound(DynList *dl, void *elem) {
+    if (dl == NULL || dl->compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_upper_bound error: provided DynList is NULL or has no compare_to function.");
+        return -1;
     }
 
-    // Update size of resulting DynList
-    res->size = end - start;
-
-    return res;
+    return bound(dl, elem, 1);
 }
 
-void merge(DynList *dl, int left, int m, int right) {
-    int pL = left;
-    int pR = m + 1;
-    DynList *buffer = DL_create(dl->capacity, dl->stride, dl->compare_to);
-    buffer->size = buffer->capacity;
-
-    for (int i = left; i <= right; i++) {
-        if (pR > right ||
-            (pL <= m && dl->compare_to(DL_get(dl, pL), DL_get(dl, pR)) <= 0)) {
-
-            DL_set(buffer, DL_get(dl, pL), i - left);
-            pL++;
-        } else {
-            DL_set(buffer, DL_get(dl, pR), i - left);
-            pR++;
-        }
+/**
+* `DL_bsearch` returns the index of the first occurrence of `elem`
+* in `dl` using binary search. `dl` needs to be sorted with respect to
+* `compare_to`. Returns -1 on failure and -2 if `elem` does not occur
+* in `dl`.
+*/
+int DL_bsearch(DynList *dl, void *elem) {
+    if (dl == NULL || dl->compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_bsearch error: provided DynList is NULL or has no compare_to function.");
+        return -1;
     }
 
-    for (int i = left; i <= right; i++) {
-        DL_set(dl, DL_get(buffer, i - left), i);
+    size_t index = bound(dl, elem, 0);
+    if (index == dl->size || dl->compare_to(dl->data + index * dl->stride, elem) != 0) {
+        return -2;
     }
 
+    return index;
 }
 
-void merge_sort(DynList *dl, int left, int right) {
-    if (left < right) {
-        int m = (left + right) / 2;
-        merge_sort(dl, left, m);
-        merge_sort(dl, m+1, right);
-        merge(dl, left, m, right);
+/**
+* `DL_insert_sorted` inserts `element` into the sorted DynList `dl`
+* behind all elements that compare equal to it, so `dl` stays sorted.
+* The position is found by binary search. `dl` needs to be in sorted
+* mode (see `DL_sort`), lists with less than two elements are
+* switched to sorted mode.
+* Returns 0 on success, -1 otherwise.
+*/
+int DL_insert_sorted(DynList *dl, void *element) {
+    if (dl == NULL || dl->compare_to == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "DL_insert_sorted error: provided DynList is NULL or has no compare_to function.");
+        return -1;
     }
+
+    if (!dl->sorted) {
+        if (dl->size > 1) {
+            CLIB_FAIL(CLIB_EINVAL, "DL_insert_sorted error: DynList is not sorted.");
+            return -1;
+        }
+        dl->sorted = 1;
+    }
+
+    return DL_insert(dl, element, bound(dl, element, 1));
 }
 
 /**
-* `DL_sort` sorts the given DynList `dl` based on the 
-* specified compare function `compare_to`. This is done inplace.
-* Returns 0 on success, -1 otherwise.
+* `DL_copy` returns a new DynList that contains the elements
+* from index `start` to `end`, of which `start` is inclusive
+* while `end` is exclusive.
 */
-int DL_sort(DynList *dl) {
+DynList *DL_copy(DynList *dl, int start, int end) {
     if (dl == NULL) {
-        fprintf(stderr, "DL_sort error: provided DynList is NULL.\n");
-        return -1;
+        CLIB_FAIL(CLIB_EINVAL, "DL_copy error: provided DynList is NULL.");
+        return NULL;
     }
 
-    if (dl->compare_to == NULL) {
-        fprintf(stderr, "DL_sort error: DynList doesn't have a compare_to function specified.\n");
-        return -1;
+    // Check for index out of bounds.
+    if (start < 0 || end > dl->size || start >= end) {
+        CLIB_FAIL(CLIB_ERANGE, "DL_copy error: index out of bounds.");
+        return NULL;
+    }
+
+    // Create new DynList.
+    DynList *res = DL_create_with_allocator(2*(end - start), dl->stride, dl->compare_to, &dl->allocator);
+    if (res == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "DL_copy error: failed to create new DynList.");
+        return NULL;
     }
 
-    merge_sort(dl, 0, dl->size-1);
+    // Copy data into new DynList
+    memcpy(res->data, 
+                       dl->data + dl->stride * start, 
+                       dl->stride * (end - start));
 
-    return 0;
+    // Update size of resulting DynList
+    res->size   = end - start;
+    res->sorted = dl->sorted;
+
+    return res;
 }
 
 /**
@@ -496,16 +796,24 @@ int DL_sort(DynList *dl) {
 */
 int DL_remove(DynList *dl, void *elem) {
     if (dl == NULL) {
-        fprintf(stderr, "DL_remove error: provided DynList is NULL.\n");
+        CLIB_FAIL(CLIB_EINVAL, "DL_remove error: provided DynList is NULL.");
         return -1;
     }
 
     // find index of first occurrence.
     int index = -1;
-    for (int i = 0; i < dl->size; i++) {
-        if (dl->compare_to(DL_get(dl, i), elem) == 0) {
-            index = i;
-            break;
+    if (dl->sorted) {
+        index = DL_bsearch(dl, elem);
+        index = index < 0 ? -1 : index;
+    } else if (dl_simd_supported(dl)) {
+        size_t i = dl_simd_index(dl, elem);
+        index = i < dl->size ? (int) i : -1;
+    } else {
+        for (int i = 0; i < dl->size; i++) {
+            if (dl->compare_to(DL_get(dl, i), elem) == 0) {
+                index = i;
+                break;
+            }
         }
     }
 
@@ -521,13 +829,9 @@ int DL_remove(DynList *dl, void *elem) {
     }
 
     // shift items to the left
-    void *dst = memmove(dl->data + dl->stride * index, 
+    memmove(dl->data + dl->stride * index, 
                         dl->data + dl->stride * (index + 1), 
-                        dl->stride * (dl->size - index));
-    if (dst == NULL) {
-        fprintf(stderr, "DL_remove error: moving of data failed.\n");
-        return -1;
-    }
+                        dl->stride * (dl->size - index - 1));
 
     // update size
     dl->size--;
@@ -2,24 +2,151 @@
 #define DYNLIST_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "clib_alloc.h"
+#include "clib_log.h"
+
 #define DEFAULT_CAPACITY 10
 
+// Flags for `DL_sort_ex`.
+#define DL_SORT_STABLE   0
+#define DL_SORT_UNSTABLE 1
+
+// Flags for `DL_open_mmap`.
+#define DL_MMAP_RDONLY 0
+#define DL_MMAP_RDWR   1
+#define DL_MMAP_CREATE 2
+// Format version of files written by `DL_open_mmap`.
+#define DL_MMAP_VERSION 1
+
+// Flags for `DL_heap_create`.
+#define DL_HEAP_4ARY    1
+#define DL_HEAP_HANDLES 2
+
+// Maximum number of chunks of a DL_SegList.
+#define DL_SEGLIST_MAX_CHUNKS 64
+
+// Key types for `DL_sort_by_offset`.
+#define DL_KEY_U32 0
+#define DL_KEY_I32 1
+#define DL_KEY_F32 2
+#define DL_KEY_U64 3
+#define DL_KEY_I64 4
+#define DL_KEY_F64 5
+
+// Extracts the radix sort key of an element, see `DL_sort_by_key`.
+typedef uint64_t (*DL_KeyFn)(const void *elem);
+
+// Map signed and floating point values to unsigned keys of the same order.
+static inline uint64_t DL_key_i32(int32_t v) {
+    return (uint32_t) v ^ 0x80000000u;
+}
+
+static inline uint64_t DL_key_i64(int64_t v) {
+    return (uint64_t) v ^ 0x8000000000000000ull;
+}
+
+static inline uint64_t DL_key_f32(float v) {
+    uint32_t u;
+    memcpy(&u, &v, sizeof(u));
+    return u & 0x80000000u ? ~u : u | 0x80000000u;
+}
+
+static inline uint64_t DL_key_f64(double v) {
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    return u & 0x8000000000000000ull ? ~u : u | 0x8000000000000000ull;
+}
+
+typedef struct DL_Mapping DL_Mapping;
+typedef struct DL_Concurrent DL_Concurrent;
+
 typedef struct DynList {
     char    *data;
     size_t  capacity;
     size_t  size;
     size_t  stride;
     int     (*compare_to)(void *elem1, void *elem2);
+    int     sorted;
+    CLIB_Allocator allocator;
+    // File backing `data` (see `DL_open_mmap`), NULL for heap lists.
+    DL_Mapping *mapping;
+    // State of the concurrent append mode (see `DL_begin_concurrent`),
+    // NULL otherwise.
+    DL_Concurrent *concurrent;
 } DynList;
 
+// Double-ended queue with the storage model of a DynList, see `DL_deque_create`.
+typedef struct DL_Deque {
+    char    *data;
+    size_t  capacity;
+    // Position of the first element in `data`. The elements wrap around
+    // the end of `data`.
+    size_t  head;
+    size_t  size;
+    size_t  stride;
+    int     (*compare_to)(void *elem1, void *elem2);
+    CLIB_Allocator allocator;
+} DL_Deque;
+
+// Priority queue with the storage model of a DynList, see `DL_heap_create`.
+typedef struct DL_Heap {
+    char    *data;
+    size_t  capacity;
+    size_t  size;
+    size_t  stride;
+    int     (*compare_to)(void *elem1, void *elem2);
+    // log2 of the number of children per node: 1 (binary) or 2 (4-ary).
+    unsigned int shift;
+    // With DL_HEAP_HANDLES: the handle of the element at each index and
+    // the index of each handle (one allocation), and the number of
+    // handles handed out so far. NULL otherwise.
+    size_t  *handles;
+    size_t  *pos;
+    size_t  nhandles;
+    CLIB_Allocator allocator;
+    // Room for one element while sifting.
+    _Alignas(max_align_t) char scratch[];
+} DL_Heap;
+
+// List in geometrically growing chunks whose elements never move, see
+// `DL_seglist_create`.
+typedef struct DL_SegList {
+    // Chunk 0 holds the first `1 << base_shift` elements, every further
+    // chunk as many elements as all chunks before it. The first
+    // `nchunks` chunks are allocated.
+    char    *chunks[DL_SEGLIST_MAX_CHUNKS];
+    unsigned int base_shift;
+    unsigned int nchunks;
+    // Number of elements the allocated chunks hold.
+    size_t  capacity;
+    size_t  size;
+    size_t  stride;
+    int     (*compare_to)(void *elem1, void *elem2);
+    CLIB_Allocator allocator;
+} DL_SegList;
+
 DynList* DL_create(size_t capacity, size_t stride, int (*compare_to)(void *elem1, void *elem2));
+DynList* DL_create_with_allocator(size_t capacity, size_t stride,
+                                  int (*compare_to)(void *elem1, void *elem2),
+                                  const CLIB_Allocator *allocator);
+DynList *DL_open_mmap(const char *path, size_t stride, int flags);
+int DL_sync(DynList *dl);
+int DL_serialize(DynList *dl, FILE *out);
+DynList *DL_deserialize(FILE *in, int (*compare_to)(void *elem1, void *elem2));
 void DL_free(DynList *dl);
+int DL_begin_concurrent(DynList *dl);
+int DL_append_concurrent(DynList *dl, void *element);
+int DL_append_n_concurrent(DynList *dl, void *elements, size_t count);
+long DL_publish(DynList *dl);
+void *DL_get_concurrent(DynList *dl, size_t index);
+int DL_end_concurrent(DynList *dl);
 int DL_append(DynList *dl, void *element);
 void* DL_get(DynList *dl, size_t index);
 void DL_clear(DynList *dl);
@@ -29,12 +156,90 @@ int DL_insert(DynList *dl, void *element, size_t index);
 int DL_set(DynList *dl, void *element, int index);
 void* DL_pop(DynList *dl, size_t index);
 int DL_extend(DynList *dl1, DynList *dl2);
+int DL_reserve(DynList *dl, size_t capacity);
+int DL_shrink_to_fit(DynList *dl);
+int DL_append_n(DynList *dl, void *elements, size_t count);
+int DL_insert_n(DynList *dl, void *elements, size_t count, size_t index);
+int DL_remove_range(DynList *dl, size_t start, size_t end);
+int DL_pop_into(DynList *dl, size_t index, void *out);
 int DL_reverse(DynList *dl);
 int DL_count(DynList *dl, void *elem);
 int DL_contains(DynList *dl, void *elem);
 int DL_index(DynList *dl, void *elem);
 int DL_sort(DynList *dl);
+int DL_sort_ex(DynList *dl, int flags);
+int DL_sort_parallel(DynList *dl, int nthreads);
+int DL_sort_by_key(DynList *dl, DL_KeyFn key_fn, size_t key_bytes);
+int DL_sort_by_offset(DynList *dl, size_t offset, int key_type);
+int DL_for_each(DynList *dl, void (*fn)(void *elem, void *ctx), void *ctx, int nthreads);
+int DL_count_if(DynList *dl, int (*pred)(void *elem, void *ctx), void *ctx, int nthreads);
+int DL_filter_into(DynList *dst, DynList *src, int (*pred)(void *elem, void *ctx), void *ctx, int nthreads);
+int DL_reduce(DynList *dl, void *acc, size_t acc_size,
+              void (*step)(void *acc, void *elem, void *ctx),
+              void (*merge)(void *acc, void *partial, void *ctx),
+              void *ctx, int nthreads);
 DynList *DL_copy(DynList *dl, int start, int end);
 int DL_remove(DynList *dl, void *elem);
+int DL_lower_bound(DynList *dl, void *elem);
+int DL_upper_bound(DynList *dl, void *elem);
+int DL_bsearch(DynList *dl, void *elem);
+int DL_insert_sorted(DynList *dl, void *element);
+
+DL_Deque *DL_deque_create(size_t capacity, size_t stride, int (*compare_to)(void *elem1, void *elem2));
+DL_Deque *DL_deque_create_with_allocator(size_t capacity, size_t stride,
+                                         int (*compare_to)(void *elem1, void *elem2),
+                                         const CLIB_Allocator *allocator);
+DL_Deque *DL_deque_from_dynlist(DynList *dl);
+DynList *DL_deque_to_dynlist(DL_Deque *dq);
+void DL_deque_free(DL_Deque *dq);
+int DL_deque_push_back(DL_Deque *dq, void *element);
+int DL_deque_push_front(DL_Deque *dq, void *element);
+int DL_deque_pop_front(DL_Deque *dq, void *out);
+int DL_deque_pop_back(DL_Deque *dq, void *out);
+void *DL_deque_get(DL_Deque *dq, size_t index);
+long DL_deque_size(DL_Deque *dq);
+void DL_deque_clear(DL_Deque *dq);
+int DL_deque_reserve(DL_Deque *dq, size_t capacity);
+
+DL_Heap *DL_heap_create(size_t capacity, size_t stride, int (*compare_to)(void *elem1, void *elem2), int flags);
+DL_Heap *DL_heap_create_with_allocator(size_t capacity, size_t stride,
+                                       int (*compare_to)(void *elem1, void *elem2), int flags,
+                                       const CLIB_Allocator *allocator);
+DL_Heap *DL_heap_from_dynlist(DynList *dl, int flags);
+void DL_heap_free(DL_Heap *h);
+int DL_heap_push(DL_Heap *h, void *element, size_t *handle);
+void *DL_heap_peek(DL_Heap *h);
+int DL_heap_pop(DL_Heap *h, void *out);
+void *DL_heap_get(DL_Heap *h, size_t handle);
+int DL_heap_update(DL_Heap *h, size_t handle, void *element);
+int DL_heap_remove(DL_Heap *h, size_t handle, void *out);
+long DL_heap_size(DL_Heap *h);
+void DL_heap_clear(DL_Heap *h);
+int DL_heap_reserve(DL_Heap *h, size_t capacity);
+
+DL_SegList *DL_seglist_create(size_t capacity, size_t stride, int (*compare_to)(void *elem1, void *elem2));
+DL_SegList *DL_seglist_create_with_allocator(size_t capacity, size_t stride,
+                                             int (*compare_to)(void *elem1, void *elem2),
+                                             const CLIB_Allocator *allocator);
+DL_SegList *DL_seglist_from_dynlist(DynList *dl);
+DynList *DL_seglist_to_dynlist(DL_SegList *sl);
+void DL_seglist_free(DL_SegList *sl);
+int DL_seglist_append(DL_SegList *sl, void *element);
+int DL_seglist_append_n(DL_SegList *sl, void *elements, size_t count);
+void *DL_seglist_get(DL_SegList *sl, size_t index);
+int DL_seglist_set(DL_SegList *sl, size_t index, void *element);
+int DL_seglist_pop_back(DL_SegList *sl, void *out);
+void *DL_seglist_chunk(DL_SegList *sl, unsigned int k, size_t *count);
+long DL_seglist_size(DL_SegList *sl);
+void DL_seglist_clear(DL_SegList *sl);
+int DL_seglist_reserve(DL_SegList *sl, size_t capacity);
+int DL_seglist_shrink_to_fit(DL_SegList *sl);
+
+// Built-in comparators. Lists created with one of these (and a matching
+// stride) use vectorized scans in DL_count, DL_contains, DL_index and DL_remove.
+int DL_cmp_int32(void *elem1, void *elem2);
+int DL_cmp_int64(void *elem1, void *elem2);
+int DL_cmp_float(void *elem1, void *elem2);
+int DL_cmp_double(void *elem1, void *elem2);
 
 #endif // DYNLIST_H
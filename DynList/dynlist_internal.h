@@ -0,0 +1,78 @@
+#ifndef DYNLIST_INTERNAL_H
+#define DYNLIST_INTERNAL_H
+
+#include <string.h>
+#include "dynlist.h"
+
+/*
+* Functions shared between the translation units of the library.
+* Not part of the public interface and not installed.
+*/
+
+// dlsimd.c: vectorized scans for lists using a built-in comparator.
+int dl_simd_supported(DynList *dl);
+size_t dl_simd_count(DynList *dl, void *elem);
+size_t dl_simd_index(DynList *dl, void *elem);
+int dl_simd_use_avx2(int enable);
+
+// dlpool.c: worker pool shared by the parallel functions.
+#define DL_POOL_MAX_THREADS 256
+typedef void (*dl_job_fn)(void *arg, int id);
+int dl_pool_threads(int nthreads, size_t n, size_t min_chunk);
+void dl_pool_run(dl_job_fn fn, void *arg, int njobs);
+
+// dlmmap.c: storage of file backed lists.
+int dl_mmap_resize(DynList *dl, size_t capacity, const char *caller);
+void dl_mmap_close(DynList *dl);
+
+// dlconc.c: state of the concurrent append mode.
+void dl_concurrent_free(DynList *dl);
+
+// dynlist.c
+int dl_range_in_order(DynList *dl, size_t start, size_t end);
+
+/*
+* Geometric chunks, used by the concurrent append mode (dlconc.c) and
+* by DL_SegList (dlseglist.c): chunk 0 holds the first `1 << base_shift`
+* elements, and chunk k > 0 the `1 << (base_shift + k - 1)` elements
+* from index `1 << (base_shift + k - 1)` on, so every chunk doubles the
+* total capacity and the chunk of an index is found with one bit scan.
+*/
+
+/**
+* `dl_chunk_of` returns the chunk holding element `index`.
+*/
+static inline unsigned int dl_chunk_of(unsigned int base_shift, size_t index) {
+    size_t q = index >> base_shift;
+    return q == 0 ? 0 : 64 - __builtin_clzll(q);
+}
+
+/**
+* `dl_chunk_start` returns the index of the first element of chunk `k`.
+*/
+static inline size_t dl_chunk_start(unsigned int base_shift, unsigned int k) {
+    return k == 0 ? 0 : (size_t) 1 << (base_shift + k - 1);
+}
+
+/**
+* `dl_chunk_end` returns the index behind the last element of chunk `k`.
+*/
+static inline size_t dl_chunk_end(unsigned int base_shift, unsigned int k) {
+    return (size_t) 1 << (base_shift + k);
+}
+
+/**
+* `copy_elem` copies a single element. Common element sizes get a
+* fixed-size copy the compiler can turn into plain loads and stores.
+*/
+static inline void copy_elem(void *dst, const void *src, size_t stride) {
+    switch (stride) {
+        case 4:  memcpy(dst, src, 4);  break;
+        case 8:  memcpy(dst, src, 8);  break;
+        case 12: memcpy(dst, src, 12); break;
+        case 16: memcpy(dst, src, 16); break;
+        default: memcpy(dst, src, stride);
+    }
+}
+
+#endif // DYNLIST_INTERNAL_H
@@ -0,0 +1,212 @@
+#ifndef DYNLIST_TYPED_H
+#define DYNLIST_TYPED_H
+
+#include "dynlist.h"
+
+/**
+* Type-specialized DynList functions generated by macros.
+*
+* `DL_DEFINE(T)` generates `DL_T_create`, `DL_T_append`, `DL_T_sort`, ...
+* for an arithmetic type `T`. For other types (structs, or type names
+* consisting of several words) use
+*   `DL_DEFINE_CMP(T, cmp)`            where `cmp(const T *a, const T *b)`
+*                                      returns <0, 0 or >0 like `compare_to`,
+*   `DL_DEFINE_NAMED(name, T, cmp)`    to choose the `name` in `DL_name_*`.
+* `cmp` may be a function or a function-like macro, in both cases the
+* comparison is inlined into the generated loops.
+*
+* The generated functions work on a plain `DynList` and the ones that
+* can grow the list fall back to the generic functions. Thus typed and
+* generic code can share one list, as long as it was created with
+* `stride == sizeof(T)`; the typed functions fail with `CLIB_EINVAL` on
+* any other list. `DL_T_create` registers `DL_T_cmp` as `compare_to`,
+* so the generic functions order elements the same way.
+* Lists in sorted mode (see `DL_sort`) are handed to the generic
+* functions, which use binary search and maintain the mode.
+*/
+
+// Orders NaN like `DL_cmp_float`/`DL_cmp_double`: after every number and
+// equal to itself. The last two terms are always 0 for integer types.
+#define DL_DEFAULT_CMP(a, b)                                                    \
+    ((*(a) > *(b)) - (*(a) < *(b)) + (*(a) != *(a)) - (*(b) != *(b)))
+
+// Runs shorter than this are sorted with insertion sort by `DL_T_sort`.
+#define DL_TYPED_RUN 32
+
+#define DL_DEFINE(T) DL_DEFINE_NAMED(T, T, DL_DEFAULT_CMP)
+#define DL_DEFINE_CMP(T, cmp) DL_DEFINE_NAMED(T, T, cmp)
+
+#define DL_DEFINE_NAMED(name, T, cmp)                                           \
+                                                                                \
+static inline int DL_##name##_cmp(void *elem1, void *elem2) {                   \
+    return cmp((const T *) elem1, (const T *) elem2);                           \
+}                                                                               \
+                                                                                \
+/* Fails unless `dl` is NULL (left to the generic functions) or holds       */ \
+/* elements of type T.                                                      */ \
+static inline int DL_##name##_check_(DynList *dl, const char *func) {           \
+    if (dl != NULL && dl->stride != sizeof(T)) {                                \
+        CLIB_FAIL(CLIB_EINVAL, "%s error: stride %zu is not the size of " #T    \
+                  ".", func, dl->stride);                                       \
+        return -1;                                                              \
+    }                                                                           \
+    return 0;                                                                   \
+}                                                                               \
+                                                                                \
+static inline DynList *DL_##name##_create(size_t capacity) {                    \
+    return DL_create(capacity, sizeof(T), DL_##name##_cmp);                     \
+}                                                                               \
+                                                                                \
+static inline int DL_##name##_append(DynList *dl, T element) {                  \
+    if (DL_##name##_check_(dl, "DL_" #name "_append") != 0) {                   \
+        return -1;                                                              \
+    }                                                                           \
+    if (dl != NULL && dl->size < dl->capacity && !dl->sorted) {                 \
+        ((T *) dl->data)[dl->size++] = element;                                 \
+        return 0;                                                               \
+    }                                                                           \
+    return DL_append(dl, &element);                                             \
+}                                                                               \
+                                                                                \
+static inline int DL_##name##_insert(DynList *dl, T element, size_t index) {    \
+    if (DL_##name##_check_(dl, "DL_" #name "_insert") != 0) {                   \
+        return -1;                                                              \
+    }                                                                           \
+    return DL_insert(dl, &element, index);                                      \
+}                                                                               \
+                                                                                \
+static inline T *DL_##name##_get(DynList *dl, size_t index) {                   \
+    if (DL_##name##_check_(dl, "DL_" #name "_get") != 0) {                      \
+        return NULL;                                                            \
+    }                                                                           \
+    if (dl == NULL || index >= dl->size) {                                      \
+        return (T *) DL_get(dl, index);                                         \
+    }                                                                           \
+    return (T *) dl->data + index;                                              \
+}                                                                               \
+                                                                                \
+static inline int DL_##name##_set(DynList *dl, T element, size_t index) {       \
+    if (DL_##name##_check_(dl, "DL_" #name "_set") != 0) {                      \
+        return -1;                                                              \
+    }                                                                           \
+    if (dl == NULL || index >= dl->size || dl->sorted) {                        \
+        return DL_set(dl, &element, index);                                     \
+    }                                                                           \
+    ((T *) dl->data)[index] = element;                                          \
+    return 0;                                                                   \
+}                                                                               \
+                                                                                \
+static inline int DL_##name##_count(DynList *dl, T element) {                   \
+    if (DL_##name##_check_(dl, "DL_" #name "_count") != 0) {                    \
+        return -1;                                                              \
+    }                                                                           \
+    if (dl == NULL || dl->sorted) {                                             \
+        return DL_count(dl, &element);                                          \
+    }                                                                           \
+    const T *v = (const T *) dl->data;                                          \
+    int n = 0;                                                                  \
+    for (size_t i = 0; i < dl->size; i++) {                                     \
+        n += cmp(&v[i], &element) == 0;                                         \
+    }                                                                           \
+    return n;                                                                   \
+}                                                                               \
+                                                                                \
+static inline int DL_##name##_index(DynList *dl, T element) {                   \
+    if (DL_##name##_check_(dl, "DL_" #name "_index") != 0) {                    \
+        return -1;                                                              \
+    }                                                                           \
+    if (dl == NULL || dl->sorted) {                                             \
+        return DL_index(dl, &element);                                          \
+    }                                                                           \
+    const T *v = (const T *) dl->data;                                          \
+    for (size_t i = 0; i < dl->size; i++) {                                     \
+        if (cmp(&v[i], &element) == 0) {                                        \
+            return i;                                                           \
+        }                                                                       \
+    }                                                                           \
+    return -2;                                                                  \
+}                                                                               \
+                                                                                \
+static inline int DL_##name##_contains(DynList *dl, T element) {                \
+    int index = DL_##name##_index(dl, element);                                 \
+    if (index == -1) {                                                          \
+        return -1;                                                              \
+    }                                                                           \
+    return index >= 0;                                                          \
+}                                                                               \
+                                                                                \
+/* Merges the sorted runs a[0..len_a) and a[len_a..len_a+len_b),           */ \
+/* buffering the shorter one in `buf`.                                      */ \
+static inline void DL_##name##_merge_(T *a, size_t len_a, size_t len_b,        \
+                                      T *buf) {                                 \
+    T *b = a + len_a;                                                           \
+    if (cmp(b, b - 1) >= 0) {                                                   \
+        return;                                                                 \
+    }                                                                           \
+    if (len_a <= len_b) {                                                       \
+        memcpy(buf, a, len_a * sizeof(T));                                      \
+        T *x = buf, *x_end = buf + len_a, *y = b, *y_end = b + len_b, *d = a;   \
+        while (x < x_end && y < y_end) {                                        \
+            *d++ = cmp(y, x) < 0 ? *y++ : *x++;                                 \
+        }                                                                       \
+        memcpy(d, x, (x_end - x) * sizeof(T));                                  \
+    } else {                                                                    \
+        memcpy(buf, b, len_b * sizeof(T));                                      \
+        T *x = b, *y = buf + len_b, *d = b + len_b;                             \
+        while (x > a && y > buf) {                                              \
+            *--d = cmp(y - 1, x - 1) < 0 ? *--x : *--y;                         \
+        }                                                                       \
+        memcpy(a, buf, (y - buf) * sizeof(T));                                  \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* Stable bottom-up merge sort with insertion sorted base runs. Needs a    */ \
+/* scratch buffer of n/2 elements. Sorted mode is only set if `compare_to`  */ \
+/* is DL_name_cmp, otherwise the generic binary search would use another    */ \
+/* order.                                                                   */ \
+static inline int DL_##name##_sort(DynList *dl) {                               \
+    if (dl == NULL) {                                                           \
+        return DL_sort(dl);                                                     \
+    }                                                                           \
+    if (DL_##name##_check_(dl, "DL_" #name "_sort") != 0) {                     \
+        return -1;                                                              \
+    }                                                                           \
+    T *v = (T *) dl->data;                                                      \
+    size_t n = dl->size;                                                        \
+                                                                                \
+    for (size_t lo = 0; lo < n; lo += DL_TYPED_RUN) {                           \
+        size_t hi = n - lo < DL_TYPED_RUN ? n : lo + DL_TYPED_RUN;              \
+        for (size_t i = lo + 1; i < hi; i++) {                                  \
+            T x = v[i];                                                         \
+            size_t j = i;                                                       \
+            while (j > lo && cmp(&x, &v[j - 1]) < 0) {                          \
+                v[j] = v[j - 1];                                                \
+                j--;                                                            \
+            }                                                                   \
+            v[j] = x;                                                           \
+        }                                                                       \
+    }                                                                           \
+    if (n <= DL_TYPED_RUN) {                                                    \
+        dl->sorted = dl->compare_to == DL_##name##_cmp;                         \
+        return 0;                                                               \
+    }                                                                           \
+                                                                                \
+    CLIB_Allocator *a = &dl->allocator;                                         \
+    T *buf = (T *) a->alloc(a->ctx, (n / 2 + 1) * sizeof(T));                   \
+    if (buf == NULL) {                                                          \
+        CLIB_FAIL(CLIB_ENOMEM, "DL_" #name "_sort error: out of memory.");      \
+        return -1;                                                              \
+    }                                                                           \
+    for (size_t w = DL_TYPED_RUN; w < n; w *= 2) {                              \
+        for (size_t lo = 0; lo + w < n; lo += 2 * w) {                          \
+            size_t len_b = n - lo - w < w ? n - lo - w : w;                     \
+            DL_##name##_merge_(v + lo, w, len_b, buf);                          \
+        }                                                                       \
+    }                                                                           \
+    a->free(a->ctx, buf, (n / 2 + 1) * sizeof(T));                              \
+    dl->sorted = dl->compare_to == DL_##name##_cmp;                             \
+                                                                                \
+    return 0;                                                                   \
+}
+
+#endif // DYNLIST_TYPED_H
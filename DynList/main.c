@@ -1,7 +1,25 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <math.h>
 
 #include "dynlist.h"
+#include "dynlist_typed.h"
+#include "dynlist_internal.h"
+#include "clib_serial.h"
+
+static int failures = 0;
+
+// Records a failed check; main fails if there were any.
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("CHECK failed (line %d): %s\n", __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
 
 struct Person {
     int id;
@@ -24,6 +42,905 @@ int compare_people(void *a, void *b) {
     return (((struct Person *)a)->id - ((struct Person *)b)->id);
 }
 
+#define PERSON_CMP(a, b) ((a)->id - (b)->id)
+
+DL_DEFINE(int)
+DL_DEFINE(float)
+DL_DEFINE(double)
+DL_DEFINE_NAMED(person, struct Person, PERSON_CMP)
+
+// The serialized form of a list in memory, read back through fmemopen.
+typedef struct {
+    char *buf;
+    size_t len;
+} serialized_t;
+
+static serialized_t serialize(DynList *dl) {
+    serialized_t s = { NULL, 0 };
+    FILE *f = open_memstream(&s.buf, &s.len);
+    CHECK(DL_serialize(dl, f) == 0);
+    fclose(f);
+    return s;
+}
+
+// Deserializes `len` bytes of `buf`; `err` is the last error afterwards.
+static DynList *deserialize(const char *buf, size_t len, int *err) {
+    FILE *f = fmemopen((void *) buf, len, "r");
+    clib_clear_error();
+    DynList *dl = DL_deserialize(f, compare_ints);
+    *err = clib_last_error();
+    fclose(f);
+    return dl;
+}
+
+typedef struct {
+    int fd;
+    const char *buf;
+    size_t len;
+} pipe_writer_t;
+
+static void *write_pipe(void *arg) {
+    pipe_writer_t *w = (pipe_writer_t *) arg;
+    for (size_t done = 0; done < w->len; ) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    close(w->fd);
+    return NULL;
+}
+
+// Deserializes through a pipe, which can't be sized up front.
+static DynList *deserialize_pipe(const char *buf, size_t len, int *err) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        *err = CLIB_EIO;
+        return NULL;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    pipe_writer_t w = { fds[1], buf, len };
+    pthread_t writer;
+    pthread_create(&writer, NULL, write_pipe, &w);
+    FILE *f = fdopen(fds[0], "r");
+    clib_clear_error();
+    DynList *dl = DL_deserialize(f, compare_ints);
+    *err = clib_last_error();
+    fclose(f);
+    pthread_join(writer, NULL);
+    return dl;
+}
+
+static int same_ints(DynList *a, DynList *b) {
+    return a != NULL && b != NULL && a->size == b->size && a->stride == b->stride &&
+           memcmp(a->data, b->data, a->size * a->stride) == 0;
+}
+
+static int equals_ints(DynList *dl, const int *v, size_t n) {
+    return dl->size == n && memcmp(dl->data, v, n * sizeof(int)) == 0;
+}
+
+static int is_sorted(DynList *dl) {
+    for (size_t i = 1; i < dl->size; i++) {
+        if (dl->compare_to(dl->data + (i - 1) * dl->stride, dl->data + i * dl->stride) > 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void test_sorted_mode(void) {
+    int v[] = { 7, 2, 9, 2, 5, 1, 7, 2 };
+    DynList *dl = DL_create(0, sizeof(int), compare_ints);
+    DL_append_n(dl, v, 8);
+    CHECK(dl->sorted == 0);
+    DL_sort(dl);
+    int sorted[] = { 1, 2, 2, 2, 5, 7, 7, 9 };
+    CHECK(dl->sorted == 1 && equals_ints(dl, sorted, 8));
+
+    // Bounds around runs of duplicates, and past both ends.
+    int keys[]  = { 0, 1, 2, 3, 5, 7, 9, 10 };
+    int lower[] = { 0, 0, 1, 4, 4, 5, 7, 8 };
+    int upper[] = { 0, 1, 4, 4, 5, 7, 8, 8 };
+    for (int i = 0; i < 8; i++) {
+        CHECK(DL_lower_bound(dl, &keys[i]) == lower[i]);
+        CHECK(DL_upper_bound(dl, &keys[i]) == upper[i]);
+        int found = lower[i] < upper[i];
+        CHECK(DL_bsearch(dl, &keys[i]) == (found ? lower[i] : -2));
+        CHECK(DL_count(dl, &keys[i]) == upper[i] - lower[i]);
+        CHECK(DL_index(dl, &keys[i]) == (found ? lower[i] : -2));
+    }
+
+    // Mutations in order keep sorted mode, others leave it.
+    int x = 3;
+    CHECK(DL_insert(dl, &x, 4) == 0 && dl->sorted == 1);
+    x = 0;
+    CHECK(DL_insert(dl, &x, 9) == 0 && dl->sorted == 0);
+    DL_sort(dl);
+    x = 4;
+    CHECK(DL_set(dl, &x, 6) == 0 && dl->sorted == 1);
+    x = 8;
+    CHECK(DL_set(dl, &x, 0) == 0 && dl->sorted == 0);
+    DL_sort(dl);
+    int tail[] = { 9, 10, 11 };
+    CHECK(DL_append_n(dl, tail, 3) == 0 && dl->sorted == 1);
+    int bad_tail[] = { 12, 4 };
+    CHECK(DL_append_n(dl, bad_tail, 2) == 0 && dl->sorted == 0);
+    DL_sort(dl);
+
+    // DL_insert_sorted goes behind equal elements.
+    x = 7;
+    int upper7 = DL_upper_bound(dl, &x);
+    CHECK(DL_insert_sorted(dl, &x) == 0 && dl->sorted == 1);
+    CHECK(DL_upper_bound(dl, &x) == upper7 + 1 && is_sorted(dl));
+
+    // Random mutations: sorted mode must never claim an unsorted list.
+    unsigned seed = 1;
+    for (int i = 0; i < 2000; i++) {
+        int y = rand_r(&seed) % 32;
+        size_t at = rand_r(&seed) % (dl->size + 1);
+        switch (rand_r(&seed) % 4) {
+            case 0: DL_insert(dl, &y, at); break;
+            case 1: DL_set(dl, &y, at < dl->size ? at : 0); break;
+            case 2: DL_append_n(dl, &y, 1); break;
+            default: DL_insert_sorted(dl, &y); break;
+        }
+        CHECK(!dl->sorted || is_sorted(dl));
+        if (!dl->sorted) {
+            DL_sort(dl);
+        }
+    }
+    DL_free(dl);
+}
+
+static void test_batch(void) {
+    int v[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    int three[] = { 100, 101, 102 };
+    DynList *dl = DL_create(1, sizeof(int), compare_ints);
+    CHECK(DL_append_n(dl, v, 10) == 0 && equals_ints(dl, v, 10));
+
+    // Inserting and removing at the front, the end and in the middle.
+    int front[] = { 100, 101, 102, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    CHECK(DL_insert_n(dl, three, 3, 0) == 0 && equals_ints(dl, front, 13));
+    int both[] = { 100, 101, 102, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 100, 101, 102 };
+    CHECK(DL_insert_n(dl, three, 3, 13) == 0 && equals_ints(dl, both, 16));
+    CHECK(DL_remove_range(dl, 0, 3) == 0 && equals_ints(dl, both + 3, 13));
+    CHECK(DL_remove_range(dl, 10, 13) == 0 && equals_ints(dl, v, 10));
+    int middle[] = { 0, 1, 100, 101, 102, 2, 3, 4, 5, 6, 7, 8, 9 };
+    CHECK(DL_insert_n(dl, three, 3, 2) == 0 && equals_ints(dl, middle, 13));
+    CHECK(DL_remove_range(dl, 2, 5) == 0 && equals_ints(dl, v, 10));
+
+    // Empty ranges change nothing, out of range ones fail.
+    CHECK(DL_insert_n(dl, three, 0, 10) == 0 && DL_remove_range(dl, 10, 10) == 0);
+    CHECK(DL_remove_range(dl, 0, 0) == 0 && equals_ints(dl, v, 10));
+    clib_clear_error();
+    CHECK(DL_insert_n(dl, three, 3, 11) == -1 && clib_last_error() == CLIB_ERANGE);
+    CHECK(DL_remove_range(dl, 5, 3) == -1 && DL_remove_range(dl, 8, 11) == -1);
+    CHECK(equals_ints(dl, v, 10));
+
+    // Sorted mode at both ends.
+    DL_sort(dl);
+    int low[] = { -3, -2, -1 };
+    CHECK(DL_insert_n(dl, low, 3, 0) == 0 && dl->sorted == 1);
+    CHECK(DL_insert_n(dl, three, 3, DL_size(dl)) == 0 && dl->sorted == 1);
+    CHECK(DL_insert_n(dl, three, 3, 0) == 0 && dl->sorted == 0);
+    CHECK(DL_remove_range(dl, 0, DL_size(dl)) == 0 && DL_size(dl) == 0);
+
+    // DL_reserve grows once and keeps the elements.
+    DL_append_n(dl, v, 10);
+    CHECK(DL_reserve(dl, 1000) == 0 && dl->capacity >= 1000 && equals_ints(dl, v, 10));
+    char *data = dl->data;
+    for (int i = 10; i < 1000; i++) {
+        DL_append(dl, &i);
+    }
+    CHECK(dl->data == data && DL_size(dl) == 1000);
+    DL_free(dl);
+}
+
+// Radix sorts records of a key and its input position by the key and
+// compares the result with the stable DL_sort, which calls `cmp` on
+// the key at the start of each record.
+static void check_radix(int (*cmp)(void *, void *), int key_type, size_t key_size,
+                        const char *vals, size_t nv) {
+    size_t stride = 2 * key_size;
+    size_t lengths[] = { 0, 1, 2, 17, 1000 };
+    unsigned seed = 3;
+    char *rec = malloc(stride);
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        DynList *radix = DL_create(lengths[l], stride, cmp);
+        for (size_t i = 0; i < lengths[l]; i++) {
+            uint64_t seq = i;
+            memcpy(rec, vals + rand_r(&seed) % nv * key_size, key_size);
+            memcpy(rec + key_size, &seq, key_size);
+            DL_append(radix, rec);
+        }
+        DynList *merge = lengths[l] > 0 ? DL_copy(radix, 0, lengths[l]) : DL_create(0, stride, cmp);
+        CHECK(DL_sort_by_offset(radix, 0, key_type) == 0);
+        CHECK(DL_sort(merge) == 0);
+        CHECK(DL_size(radix) == DL_size(merge));
+        CHECK(memcmp(radix->data, merge->data, lengths[l] * stride) == 0);
+        DL_free(radix);
+        DL_free(merge);
+    }
+    free(rec);
+}
+
+static void test_radix(void) {
+    int32_t i32[] = { INT32_MIN, -100000, -256, -1, 0, 1, 255, 256, INT32_MAX };
+    int64_t i64[] = { INT64_MIN, -((int64_t) 1 << 40), -255, -1, 0, 1, (int64_t) 1 << 32, INT64_MAX };
+    float f32[] = { -INFINITY, -1.5f, -1e-40f, -0.0f, 0.0f, 1e-40f, 1.5f, INFINITY, NAN, -NAN };
+    double f64[] = { -INFINITY, -1.5, -1e-310, -0.0, 0.0, 1e-310, 1.5, INFINITY, NAN, -NAN };
+    check_radix(DL_cmp_int32, DL_KEY_I32, 4, (char *) i32, sizeof(i32) / sizeof(i32[0]));
+    check_radix(DL_cmp_int64, DL_KEY_I64, 8, (char *) i64, sizeof(i64) / sizeof(i64[0]));
+    check_radix(DL_cmp_float, DL_KEY_F32, 4, (char *) f32, sizeof(f32) / sizeof(f32[0]));
+    check_radix(DL_cmp_double, DL_KEY_F64, 8, (char *) f64, sizeof(f64) / sizeof(f64[0]));
+}
+
+static int is_multiple(void *elem, void *ctx) {
+    return *(int *) elem % *(int *) ctx == 0;
+}
+
+static void add_to(void *elem, void *ctx) {
+    *(int *) elem += *(int *) ctx;
+}
+
+// A polynomial hash of the elements in order, which only merges to the
+// single-threaded result if the partials are combined in chunk order.
+typedef struct {
+    uint64_t hash;
+    uint64_t scale;
+} poly_t;
+
+static void poly_step(void *acc, void *elem, void *ctx) {
+    poly_t *p = (poly_t *) acc;
+    p->hash = p->hash * 31 + (uint64_t) *(int *) elem;
+    p->scale *= 31;
+}
+
+static void poly_merge(void *acc, void *partial, void *ctx) {
+    poly_t *p = (poly_t *) acc;
+    poly_t *q = (poly_t *) partial;
+    p->hash = p->hash * q->scale + q->hash;
+    p->scale *= q->scale;
+}
+
+// An accumulator wider than a cache line; `misaligned` counts partials
+// that do not start on a cache line of their own.
+typedef struct {
+    int64_t sum;
+    char pad[92];
+} wide_t;
+
+static void wide_step(void *acc, void *elem, void *ctx) {
+    ((wide_t *) acc)->sum += *(int *) elem;
+}
+
+static void wide_merge(void *acc, void *partial, void *ctx) {
+    *(int *) ctx += (uintptr_t) partial % 64 != 0;
+    ((wide_t *) acc)->sum += ((wide_t *) partial)->sum;
+}
+
+static void test_parallel_func(void) {
+    // Not a multiple of any thread count or chunk size.
+    size_t n = 100003;
+    DynList *dl = DL_create(n, sizeof(int), compare_ints);
+    unsigned seed = 4;
+    for (size_t i = 0; i < n; i++) {
+        int v = rand_r(&seed) % 1000 - 500;
+        DL_append(dl, &v);
+    }
+
+    int three = 3;
+    DynList *expected = DL_create(0, sizeof(int), compare_ints);
+    int first = -1;
+    DL_append(expected, &first);
+    CHECK(DL_filter_into(expected, dl, is_multiple, &three, 1) == 0);
+    int expected_count = DL_count_if(dl, is_multiple, &three, 1);
+    CHECK(expected_count == DL_size(expected) - 1);
+    poly_t expected_poly = { 0, 1 };
+    CHECK(DL_reduce(dl, &expected_poly, sizeof(poly_t), poly_step, poly_merge, NULL, 1) == 0);
+    int64_t expected_sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        expected_sum += *(int *) DL_get(dl, i);
+    }
+
+    int threads[] = { 2, 3, 7, 0 };
+    for (int t = 0; t < 4; t++) {
+        DynList *filtered = DL_create(0, sizeof(int), compare_ints);
+        DL_append(filtered, &first);
+        CHECK(DL_filter_into(filtered, dl, is_multiple, &three, threads[t]) == 0);
+        CHECK(DL_size(filtered) == DL_size(expected));
+        CHECK(memcmp(filtered->data, expected->data, expected->size * sizeof(int)) == 0);
+        CHECK(DL_count_if(dl, is_multiple, &three, threads[t]) == expected_count);
+        poly_t poly = { 0, 1 };
+        CHECK(DL_reduce(dl, &poly, sizeof(poly_t), poly_step, poly_merge, NULL, threads[t]) == 0);
+        CHECK(poly.hash == expected_poly.hash && poly.scale == expected_poly.scale);
+        wide_t wide = { 0 };
+        int misaligned = 0;
+        CHECK(DL_reduce(dl, &wide, sizeof(wide_t), wide_step, wide_merge, &misaligned, threads[t]) == 0);
+        CHECK(wide.sum == expected_sum && misaligned == 0);
+        DL_free(filtered);
+    }
+
+    // DL_for_each reaches every element exactly once.
+    DynList *copy = DL_copy(dl, 0, n);
+    int one = 1;
+    CHECK(DL_for_each(copy, add_to, &one, 7) == 0);
+    int ok = 1;
+    for (size_t i = 0; i < n; i++) {
+        ok &= *(int *) DL_get(copy, i) == *(int *) DL_get(dl, i) + 1;
+    }
+    CHECK(ok);
+
+    DL_free(copy);
+    DL_free(expected);
+    DL_free(dl);
+}
+
+// An allocator that records the size of every live block and counts
+// frees and reallocations that pass a different size.
+typedef struct {
+    void **ptrs;
+    size_t *sizes;
+    size_t live;
+    size_t capacity;
+    size_t allocs;
+    size_t mismatches;
+} counting_t;
+
+static void track(counting_t *c, void *ptr, size_t size) {
+    if (c->live == c->capacity) {
+        c->capacity = c->capacity * 2 + 16;
+        c->ptrs = realloc(c->ptrs, c->capacity * sizeof(void *));
+        c->sizes = realloc(c->sizes, c->capacity * sizeof(size_t));
+    }
+    c->ptrs[c->live] = ptr;
+    c->sizes[c->live++] = size;
+}
+
+static void untrack(counting_t *c, void *ptr, size_t size) {
+    for (size_t i = 0; i < c->live; i++) {
+        if (c->ptrs[i] == ptr) {
+            c->mismatches += c->sizes[i] != size;
+            c->live--;
+            c->ptrs[i] = c->ptrs[c->live];
+            c->sizes[i] = c->sizes[c->live];
+            return;
+        }
+    }
+    c->mismatches++;
+}
+
+static void *counting_alloc(void *ctx, size_t size) {
+    void *p = malloc(size);
+    if (p != NULL) {
+        track((counting_t *) ctx, p, size);
+        ((counting_t *) ctx)->allocs++;
+    }
+    return p;
+}
+
+static void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    if (ptr != NULL) {
+        untrack((counting_t *) ctx, ptr, old_size);
+    }
+    void *p = realloc(ptr, new_size);
+    if (p != NULL) {
+        track((counting_t *) ctx, p, new_size);
+    } else if (ptr != NULL && new_size > 0) {
+        track((counting_t *) ctx, ptr, old_size);
+    }
+    return p;
+}
+
+static void counting_free(void *ctx, void *ptr, size_t size) {
+    if (ptr != NULL) {
+        untrack((counting_t *) ctx, ptr, size);
+    }
+    free(ptr);
+}
+
+static void add_step(void *acc, void *elem, void *ctx) {
+    *(int *) acc += *(int *) elem;
+}
+
+static void add_merge(void *acc, void *partial, void *ctx) {
+    *(int *) acc += *(int *) partial;
+}
+
+// Runs the structures through operations that allocate, grow and shrink.
+static void test_allocator(void) {
+    counting_t c = { 0 };
+    CLIB_Allocator a = { counting_alloc, counting_realloc, counting_free, &c };
+
+    DynList *dl = DL_create_with_allocator(1, sizeof(int), compare_ints, &a);
+    for (int i = 0; i < 5000; i++) {
+        int v = (i * 7919) % 5000;
+        DL_append(dl, &v);
+    }
+    int batch[100] = { 0 };
+    DL_insert_n(dl, batch, 100, 17);
+    DL_remove_range(dl, 0, 50);
+    DL_reserve(dl, 20000);
+    DL_shrink_to_fit(dl);
+    DL_sort(dl);
+    DL_sort_ex(dl, DL_SORT_UNSTABLE);
+    DL_sort_by_offset(dl, 0, DL_KEY_I32);
+    DL_sort_parallel(dl, 3);
+    DynList *copy = DL_copy(dl, 10, 4000);
+    DynList *filtered = DL_create_with_allocator(0, sizeof(int), compare_ints, &a);
+    int three = 3;
+    DL_filter_into(filtered, dl, is_multiple, &three, 3);
+    int sum = 0;
+    DL_reduce(dl, &sum, sizeof(int), add_step, add_merge, NULL, 3);
+    DL_extend(copy, filtered);
+
+    DL_begin_concurrent(copy);
+    for (int i = 0; i < 3000; i++) {
+        DL_append_concurrent(copy, &i);
+    }
+    DL_end_concurrent(copy);
+
+    DL_Deque *dq = DL_deque_from_dynlist(copy);
+    for (int i = 0; i < 3000; i++) {
+        DL_deque_push_front(dq, &i);
+        DL_deque_pop_back(dq, NULL);
+    }
+    DL_deque_reserve(dq, 10000);
+    DynList *back = DL_deque_to_dynlist(dq);
+    DL_deque_free(dq);
+
+    DL_Heap *heap = DL_heap_create_with_allocator(0, sizeof(int), compare_ints, DL_HEAP_HANDLES, &a);
+    size_t handle;
+    for (int i = 0; i < 3000; i++) {
+        DL_heap_push(heap, &i, &handle);
+    }
+    DL_heap_remove(heap, handle, NULL);
+    DL_heap_free(heap);
+
+    DL_SegList *sl = DL_seglist_create_with_allocator(0, sizeof(int), compare_ints, &a);
+    for (int i = 0; i < 3000; i++) {
+        DL_seglist_append(sl, &i);
+    }
+    DynList *flat = DL_seglist_to_dynlist(sl);
+    DL_seglist_free(sl);
+
+    DL_free(flat);
+    DL_free(back);
+    DL_free(filtered);
+    DL_free(copy);
+    DL_free(dl);
+
+    CHECK(c.allocs > 0);
+    CHECK(c.mismatches == 0);
+    CHECK(c.live == 0);
+    free(c.ptrs);
+    free(c.sizes);
+}
+
+// Compares `dq` element by element with ref[lo..hi).
+static int deque_equals(DL_Deque *dq, const int *ref, size_t lo, size_t hi) {
+    if ((size_t) DL_deque_size(dq) != hi - lo) {
+        return 0;
+    }
+    for (size_t i = lo; i < hi; i++) {
+        if (*(int *) DL_deque_get(dq, i - lo) != ref[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void test_deque(void) {
+    // Reference: a plain array with room to grow in both directions.
+    int ref[2 * 20000];
+    size_t lo = 20000, hi = 20000;
+    DL_Deque *dq = DL_deque_create(8, sizeof(int), compare_ints);
+    size_t capacity = dq->capacity;
+
+    // Wrap the back around the end of the buffer...
+    for (int i = 0; i < 6; i++) {
+        DL_deque_push_back(dq, &i);
+        ref[hi++] = i;
+    }
+    for (int i = 0; i < 5; i++) {
+        int out;
+        CHECK(DL_deque_pop_front(dq, &out) == 0 && out == ref[lo++]);
+    }
+    for (int i = 6; i < 12; i++) {
+        DL_deque_push_back(dq, &i);
+        ref[hi++] = i;
+    }
+    CHECK(dq->capacity == capacity && dq->head + DL_deque_size(dq) > dq->capacity);
+    CHECK(deque_equals(dq, ref, lo, hi));
+
+    // ...and grow while wrapped, from both ends.
+    for (int i = 12; dq->capacity == capacity; i++) {
+        DL_deque_push_back(dq, &i);
+        ref[hi++] = i;
+    }
+    CHECK(deque_equals(dq, ref, lo, hi));
+    capacity = dq->capacity;
+    for (int i = -1; dq->capacity == capacity; i--) {
+        DL_deque_push_front(dq, &i);
+        ref[--lo] = i;
+    }
+    CHECK(deque_equals(dq, ref, lo, hi));
+
+    // The front wraps below index 0 of the buffer as well.
+    DL_deque_clear(dq);
+    lo = hi = 20000;
+    for (int i = 0; i < 2; i++) {
+        DL_deque_push_back(dq, &i);
+        ref[hi++] = i;
+    }
+    for (int i = 2; i < 5; i++) {
+        DL_deque_push_front(dq, &i);
+        ref[--lo] = i;
+    }
+    CHECK(dq->head + DL_deque_size(dq) > dq->capacity && deque_equals(dq, ref, lo, hi));
+    CHECK(DL_deque_reserve(dq, 1000) == 0 && deque_equals(dq, ref, lo, hi));
+
+    // Random operations against the reference.
+    unsigned seed = 5;
+    for (int i = 0; i < 20000; i++) {
+        int v = rand_r(&seed);
+        int out;
+        switch (rand_r(&seed) % 4) {
+            case 0:
+                DL_deque_push_back(dq, &v);
+                ref[hi++] = v;
+                break;
+            case 1:
+                DL_deque_push_front(dq, &v);
+                ref[--lo] = v;
+                break;
+            case 2:
+                CHECK(DL_deque_pop_back(dq, &out) == (lo < hi ? 0 : -1));
+                if (lo < hi) {
+                    CHECK(out == ref[--hi]);
+                }
+                break;
+            default:
+                CHECK(DL_deque_pop_front(dq, &out) == (lo < hi ? 0 : -1));
+                if (lo < hi) {
+                    CHECK(out == ref[lo++]);
+                }
+        }
+        if (lo < 100 || hi > 2 * 20000 - 100) {
+            break;
+        }
+    }
+    CHECK(deque_equals(dq, ref, lo, hi));
+
+    // Converting a wrapped deque puts the elements in order.
+    DynList *dl = DL_deque_to_dynlist(dq);
+    CHECK(dl != NULL && equals_ints(dl, ref + lo, hi - lo));
+    DL_deque_free(dq);
+    dq = DL_deque_from_dynlist(dl);
+    int front = -7;
+    DL_deque_push_front(dq, &front);
+    ref[--lo] = front;
+    CHECK(deque_equals(dq, ref, lo, hi));
+    DL_deque_free(dq);
+    DL_free(dl);
+}
+
+// Checks DL_count, DL_index, DL_contains and DL_remove on a list with a
+// built-in comparator, which use the vector kernels, against a plain
+// loop over the comparator.
+static void check_scan(int (*cmp)(void *, void *), size_t stride, const char *data, size_t n,
+                       const void *key) {
+    DynList *dl = DL_create(n, stride, cmp);
+    DL_append_n(dl, (void *) data, n);
+    void *k = (void *) key;
+
+    int count = 0;
+    int first = -2;
+    for (size_t i = 0; i < n; i++) {
+        if (cmp((void *) (data + i * stride), k) == 0) {
+            first = count++ == 0 ? (int) i : first;
+        }
+    }
+    CHECK(DL_count(dl, k) == count);
+    CHECK(DL_index(dl, k) == first);
+    CHECK(DL_contains(dl, k) == (first >= 0));
+
+    CHECK(DL_remove(dl, k) == 0);
+    size_t head = first >= 0 ? (size_t) first : n;
+    CHECK(DL_size(dl) == (first >= 0 ? n - 1 : n));
+    CHECK(memcmp(dl->data, data, head * stride) == 0);
+    if (first >= 0) {
+        CHECK(memcmp(dl->data + head * stride, data + (head + 1) * stride, (n - head - 1) * stride) == 0);
+    }
+    DL_free(dl);
+}
+
+// Runs `check_scan` for every key in `vals` over lists of all lengths
+// up to a few vectors and one long list, none a multiple of the vector
+// width. The last key never occurs except in the tail lists, which hold
+// vals[0] and the key only as their last element.
+static void check_scans(int (*cmp)(void *, void *), size_t stride, const char *vals, size_t nv) {
+    char *data = malloc(1001 * stride);
+    size_t lengths[42];
+    for (size_t i = 0; i < 41; i++) {
+        lengths[i] = i;
+    }
+    lengths[41] = 1001;
+
+    for (size_t l = 0; l < 42; l++) {
+        size_t n = lengths[l];
+        for (size_t i = 0; i < n; i++) {
+            memcpy(data + i * stride, vals + (i * 5 + 3) % (nv - 1) * stride, stride);
+        }
+        for (size_t k = 0; k < nv; k++) {
+            check_scan(cmp, stride, data, n, vals + k * stride);
+        }
+        for (size_t k = 1; n > 0 && k < nv; k++) {
+            if (cmp((void *) vals, (void *) (vals + k * stride)) == 0) {
+                continue;
+            }
+            for (size_t i = 0; i < n; i++) {
+                memcpy(data + i * stride, vals, stride);
+            }
+            memcpy(data + (n - 1) * stride, vals + k * stride, stride);
+            check_scan(cmp, stride, data, n, vals + k * stride);
+        }
+    }
+    free(data);
+}
+
+static void test_simd_scans(void) {
+    int32_t i32[] = { 5, -1, 0, INT32_MIN, INT32_MAX, 42 };
+    int64_t i64[] = { 5, -1, 0, INT64_MIN, (int64_t) 1 << 32, 42 };
+    float f32[] = { 1.5f, -2, 0.0f, NAN, -0.0f, INFINITY, 7 };
+    double f64[] = { 1.5, -2, 0.0, NAN, -0.0, -INFINITY, 7 };
+
+    // Both kernel sets, where the CPU has AVX2.
+    for (int avx2 = 1; avx2 >= 0; avx2--) {
+        dl_simd_use_avx2(avx2);
+        check_scans(DL_cmp_int32, sizeof(int32_t), (char *) i32, sizeof(i32) / sizeof(i32[0]));
+        check_scans(DL_cmp_int64, sizeof(int64_t), (char *) i64, sizeof(i64) / sizeof(i64[0]));
+        check_scans(DL_cmp_float, sizeof(float), (char *) f32, sizeof(f32) / sizeof(f32[0]));
+        check_scans(DL_cmp_double, sizeof(double), (char *) f64, sizeof(f64) / sizeof(f64[0]));
+    }
+    dl_simd_use_avx2(1);
+}
+
+// A typed sort has to order NaN and -0.0 like DL_sort with DL_cmp_float.
+static void test_typed_float(void) {
+    float values[] = { 3, NAN, -1, 0.0f, -0.0f, NAN, 2, -INFINITY, 0.0f, INFINITY, -0.0f, 1 };
+    size_t n = sizeof(values) / sizeof(values[0]);
+    DynList *typed = DL_float_create(0);
+    DynList *generic = DL_create(0, sizeof(float), DL_cmp_float);
+    DynList *typed_d = DL_double_create(0);
+    DynList *generic_d = DL_create(0, sizeof(double), DL_cmp_double);
+    // 100 elements, so the merge passes run too.
+    for (size_t i = 0; i < 100; i++) {
+        float f = values[i * 7 % n];
+        double d = f;
+        DL_float_append(typed, f);
+        DL_append(generic, &f);
+        DL_double_append(typed_d, d);
+        DL_append(generic_d, &d);
+    }
+    CHECK(DL_float_sort(typed) == 0 && DL_sort(generic) == 0);
+    CHECK(memcmp(typed->data, generic->data, 100 * sizeof(float)) == 0);
+    CHECK(isnan(*DL_float_get(typed, 99)) && !isnan(*DL_float_get(typed, 0)));
+    CHECK(DL_double_sort(typed_d) == 0 && DL_sort(generic_d) == 0);
+    CHECK(memcmp(typed_d->data, generic_d->data, 100 * sizeof(double)) == 0);
+
+    // NaN equals NaN, -0.0 equals 0.0.
+    DynList *unsorted = DL_float_create(0);
+    for (size_t i = 0; i < n; i++) {
+        DL_float_append(unsorted, values[i]);
+    }
+    CHECK(DL_float_count(unsorted, NAN) == 2);
+    CHECK(DL_float_index(unsorted, NAN) == 1);
+    CHECK(DL_float_count(unsorted, 0.0f) == 4);
+    CHECK(DL_float_index(unsorted, -0.0f) == 3);
+
+    // Typed functions refuse lists of another element size.
+    DynList *wrong = DL_create(4, sizeof(double), NULL);
+    double d = 1;
+    DL_append(wrong, &d);
+    clib_clear_error();
+    CHECK(DL_float_append(wrong, 1) == -1 && clib_last_error() == CLIB_EINVAL);
+    CHECK(DL_float_get(wrong, 0) == NULL);
+    CHECK(DL_float_sort(wrong) == -1);
+    CHECK(DL_float_set(wrong, 1, 0) == -1);
+    CHECK(DL_float_index(wrong, 1) == -1);
+    CHECK(DL_size(wrong) == 1);
+
+    DL_free(wrong);
+    DL_free(unsorted);
+    DL_free(typed);
+    DL_free(generic);
+    DL_free(typed_d);
+    DL_free(generic_d);
+}
+
+static int compare_ints_desc(void *a, void *b) {
+    return compare_ints(b, a);
+}
+
+// A typed sort orders by its own comparator, so it may only set sorted
+// mode when that is the list's compare_to.
+static void test_typed_sort_mode(void) {
+    // 50 elements for the merge passes, 20 for the insertion sort only.
+    size_t sizes[] = { 50, 20 };
+    for (int k = 0; k < 2; k++) {
+        size_t n = sizes[k];
+        DynList *desc = DL_create(64, sizeof(int), compare_ints_desc);
+        DynList *none = DL_create(64, sizeof(int), NULL);
+        DynList *own = DL_int_create(64);
+        for (size_t i = 0; i < n; i++) {
+            int v = (int) (i * 7 % n);
+            DL_int_append(desc, v);
+            DL_int_append(none, v);
+            DL_int_append(own, v);
+        }
+        CHECK(DL_int_sort(desc) == 0 && desc->sorted == 0);
+        CHECK(DL_int_sort(none) == 0 && none->sorted == 0);
+        CHECK(DL_int_sort(own) == 0 && own->sorted == 1);
+        for (int v = 0; v < (int) n; v++) {
+            CHECK(DL_contains(desc, &v) == 1);
+            CHECK(DL_count(desc, &v) == 1);
+            CHECK(DL_index(desc, &v) == v);
+            CHECK(DL_index(own, &v) == v);
+        }
+        int x = (int) n / 2;
+        CHECK(DL_remove(desc, &x) == 0 && DL_contains(desc, &x) == 0);
+        DL_free(desc);
+        DL_free(none);
+        DL_free(own);
+    }
+}
+
+// Opens `path` expecting failure; returns the last error.
+static int open_mmap_error(const char *path, size_t stride, int flags) {
+    clib_clear_error();
+    DynList *dl = DL_open_mmap(path, stride, flags);
+    if (dl != NULL) {
+        DL_free(dl);
+        return CLIB_OK;
+    }
+    return clib_last_error();
+}
+
+// Overwrites `len` bytes of the file at `path` at `offset`.
+static void patch_file(const char *path, long offset, const void *bytes, size_t len) {
+    FILE *f = fopen(path, "r+b");
+    fseek(f, offset, SEEK_SET);
+    fwrite(bytes, 1, len, f);
+    fclose(f);
+}
+
+static void test_mmap(void) {
+    char path[] = "/tmp/dlmmapXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    // An empty file is created as an empty list, which grows the file.
+    DynList *dl = DL_open_mmap(path, sizeof(long), DL_MMAP_RDWR | DL_MMAP_CREATE);
+    CHECK(dl != NULL && DL_size(dl) == 0);
+    if (dl == NULL) {
+        unlink(path);
+        return;
+    }
+    size_t initial = dl->capacity;
+    for (long i = 0; i < 5000; i++) {
+        long v = i * i;
+        CHECK(DL_append(dl, &v) == 0);
+    }
+    CHECK(dl->capacity > initial);
+    CHECK(DL_sync(dl) == 0);
+    DL_free(dl);
+
+    // Read back, taking the stride from the file.
+    dl = DL_open_mmap(path, 0, DL_MMAP_RDONLY);
+    CHECK(dl != NULL && dl->stride == sizeof(long) && DL_size(dl) == 5000);
+    for (long i = 0; dl != NULL && i < DL_size(dl); i++) {
+        CHECK(*(long *) DL_get(dl, i) == i * i);
+    }
+    DL_free(dl);
+
+    // A heap list has no file to sync.
+    DynList *heap = DL_create(1, sizeof(long), NULL);
+    CHECK(DL_sync(heap) == -1);
+    DL_free(heap);
+
+    // A different stride and broken headers fail with CLIB_EFORMAT, a
+    // missing file with CLIB_EIO.
+    CHECK(open_mmap_error(path, sizeof(int), DL_MMAP_RDONLY) == CLIB_EFORMAT);
+    CHECK(open_mmap_error("/nonexistent/list.dl", 0, DL_MMAP_RDONLY) == CLIB_EIO);
+    // The size is at offset 24 of the header.
+    uint64_t size = (uint64_t) 1 << 40;
+    patch_file(path, 24, &size, sizeof(size));
+    CHECK(open_mmap_error(path, 0, DL_MMAP_RDONLY) == CLIB_EFORMAT);
+    size = 5000;
+    patch_file(path, 24, &size, sizeof(size));
+    CHECK(open_mmap_error(path, 0, DL_MMAP_RDONLY) == CLIB_OK);
+    patch_file(path, 0, "X", 1);
+    CHECK(open_mmap_error(path, 0, DL_MMAP_RDONLY) == CLIB_EFORMAT);
+    CHECK(truncate(path, 10) == 0);
+    CHECK(open_mmap_error(path, 0, DL_MMAP_RDWR) == CLIB_EFORMAT);
+    CHECK(truncate(path, 0) == 0);
+    CHECK(open_mmap_error(path, sizeof(long), DL_MMAP_RDONLY) == CLIB_EFORMAT);
+
+    unlink(path);
+}
+
+static void test_serialization(void) {
+    // 600000 ints are more than CLIB_SERIAL_CHUNK, so reading them from a
+    // pipe grows the list.
+    DynList *dl = DL_create(0, sizeof(int), compare_ints);
+    for (int i = 0; i < 600000; i++) {
+        int v = (int) ((long) i * 7919 % 600000);
+        DL_append(dl, &v);
+    }
+    serialized_t s = serialize(dl);
+    int err;
+
+    DynList *copy = deserialize(s.buf, s.len, &err);
+    CHECK(same_ints(dl, copy));
+    CHECK(copy != NULL && copy->capacity == dl->size);
+    DL_free(copy);
+    copy = deserialize_pipe(s.buf, s.len, &err);
+    CHECK(same_ints(dl, copy));
+    DL_free(copy);
+
+    DynList *empty = DL_create(0, sizeof(int), compare_ints);
+    serialized_t e = serialize(empty);
+    copy = deserialize(e.buf, e.len, &err);
+    CHECK(same_ints(empty, copy));
+    DL_free(copy);
+    DL_free(empty);
+    free(e.buf);
+
+    // Truncated elements and a truncated header.
+    CHECK(deserialize(s.buf, s.len - 1, &err) == NULL && err == CLIB_EFORMAT);
+    CHECK(deserialize_pipe(s.buf, s.len - 1, &err) == NULL && err == CLIB_EFORMAT);
+    CHECK(deserialize(s.buf, sizeof(CLIB_SerialHeader) - 1, &err) == NULL && err == CLIB_EFORMAT);
+
+    // A flipped byte in the elements fails the checksum.
+    char *bad = malloc(s.len);
+    memcpy(bad, s.buf, s.len);
+    bad[s.len / 2] ^= 0x10;
+    CHECK(deserialize(bad, s.len, &err) == NULL && err == CLIB_EFORMAT);
+
+    // Bad magic, version and stride.
+    CLIB_SerialHeader h;
+    memcpy(bad, s.buf, s.len);
+    bad[0] ^= 1;
+    CHECK(deserialize(bad, s.len, &err) == NULL && err == CLIB_EFORMAT);
+    memcpy(&h, s.buf, sizeof(h));
+    h.version++;
+    memcpy(bad, &h, sizeof(h));
+    CHECK(deserialize(bad, s.len, &err) == NULL && err == CLIB_EFORMAT);
+    memcpy(&h, s.buf, sizeof(h));
+    h.stride = 0;
+    memcpy(bad, &h, sizeof(h));
+    CHECK(deserialize(bad, s.len, &err) == NULL && err == CLIB_EFORMAT);
+
+    // A forged count is rejected before anything that large is allocated,
+    // whether the input can be sized or not.
+    memcpy(&h, s.buf, sizeof(h));
+    h.count = (uint64_t) 1 << 40;
+    memcpy(bad, &h, sizeof(h));
+    CHECK(deserialize(bad, 4096, &err) == NULL && err == CLIB_EFORMAT);
+    CHECK(deserialize_pipe(bad, 4096, &err) == NULL && err == CLIB_EFORMAT);
+    h.count = UINT64_MAX;
+    memcpy(bad, &h, sizeof(h));
+    CHECK(deserialize(bad, 4096, &err) == NULL && err == CLIB_EFORMAT);
+
+    free(bad);
+    free(s.buf);
+    DL_free(dl);
+}
+
 int main() {
 
     printf("Testing...");
@@ -123,7 +1040,7 @@ int main() {
 
 
     printf("\nPopping off:\n\n");
-    while (DL_size(dl) > 0) {
+    while (DL_size(pdl) > 0) {
         struct Person *p = (struct Person*) DL_pop(pdl, DL_size(pdl) - 1);
         printPerson(p);
         free(p);
@@ -273,6 +1190,99 @@ int main() {
 
     DL_free(cp);
 
+
+    printf("--- Typed lists ---\n");
+    DynList *tdl = DL_int_create(4);
+    for (int i = 0; i < 10; i++) {
+        DL_int_append(tdl, (i * 7) % 10);
+    }
+    DL_int_sort(tdl);
+    for (int i = 0; i < DL_size(tdl); i++) {
+        printf("tdl[%d] = %d\n", i, *DL_int_get(tdl, i));
+    }
+    printf("index of 3 in tdl: %d\n", DL_int_index(tdl, 3));
+    // Typed and generic functions share the same list.
+    int e = 42;
+    DL_append(tdl, &e);
+    printf("tdl contains 42: %d\n", DL_int_contains(tdl, 42));
+    DL_free(tdl);
+
+    DynList *tpdl = DL_person_create(4);
+    DL_person_append(tpdl, p1);
+    DL_person_append(tpdl, p7);
+    DL_person_append(tpdl, p2);
+    DL_person_append(tpdl, p8);
+    DL_person_sort(tpdl);
+    for (int i = 0; i < DL_size(tpdl); i++) {
+        printPerson(DL_person_get(tpdl, i));
+    }
+    printf("occurrences of ID 55: %d\n", DL_person_count(tpdl, p7));
+    DL_free(tpdl);
+
+    test_sorted_mode();
+    test_batch();
+    test_radix();
+    test_parallel_func();
+    test_allocator();
+    test_deque();
+    test_typed_float();
+    test_typed_sort_mode();
+    test_simd_scans();
+
+    printf("--- Heaps ---\n");
+    DynList *hdl = DL_create(8, sizeof(int), compare_ints);
+    for (int i = 0; i < 8; i++) {
+        int v = (i * 5) % 8;
+        DL_append(hdl, &v);
+    }
+    // The heap takes over the list's elements, handle i is element i.
+    DL_Heap *heap = DL_heap_from_dynlist(hdl, DL_HEAP_4ARY | DL_HEAP_HANDLES);
+    int v = -1;
+    DL_heap_update(heap, 3, &v);
+    printf("element 3 decreased to -1, top: %d\n", *(int *) DL_heap_peek(heap));
+    DL_heap_remove(heap, 4, NULL);
+    while (DL_heap_pop(heap, &v) == 0) {
+        printf("%d ", v);
+    }
+    printf("\n");
+    DL_heap_free(heap);
+    DL_free(hdl);
+
+    printf("--- Segmented lists ---\n");
+    DL_SegList *sl = DL_seglist_create(0, sizeof(int), compare_ints);
+    int first = 7;
+    DL_seglist_append(sl, &first);
+    int *pfirst = DL_seglist_get(sl, 0);
+    for (int i = 1; i < 1000; i++) {
+        DL_seglist_append(sl, &i);
+    }
+    // Growing added chunks instead of moving the elements.
+    printf("size: %ld, first element: %d, same address: %d\n", DL_seglist_size(sl), *pfirst,
+           pfirst == DL_seglist_get(sl, 0));
+    size_t count;
+    for (unsigned int k = 0; DL_seglist_chunk(sl, k, &count) != NULL; k++) {
+        printf("chunk %u: %zu elements\n", k, count);
+    }
+    DL_seglist_free(sl);
+
+    printf("--- File backed lists ---\n");
+    test_mmap();
+
+    printf("--- Serialization ---\n");
+    test_serialization();
+
+    printf("--- Errors ---\n");
+    clib_clear_error();
+    DynList *edl = DL_create(2, sizeof(int), compare_ints);
+    if (DL_get(edl, 5) == NULL) {
+        printf("DL_get(edl, 5) failed: %s\n", clib_strerror(clib_last_error()));
+    }
+    DL_free(edl);
+
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
     printf("All good!\n");
     return EXIT_SUCCESS;
 }
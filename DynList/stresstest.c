@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "dynlist.h"
+
+/*
+* Stress test of the concurrent append mode: producer threads append
+* with DL_append_concurrent and DL_append_n_concurrent while reader
+* threads call DL_publish and read the published elements with
+* DL_get_concurrent. An element is (producer << 32 | sequence number),
+* so every published prefix has to hold each producer's elements in
+* order and every batch of DL_append_n_concurrent next to each other.
+* After DL_end_concurrent every element has to be there exactly once.
+* Built with sanitizers by `make stresstest`.
+* Usage: ./stresstest [producers] [readers] [appends per producer]
+*/
+
+#define BATCH 5
+// Elements in the list before DL_begin_concurrent.
+#define INITIAL 10
+#define ORIGIN ((uint64_t) 0xffffffff << 32)
+
+static DynList *dl;
+static long appends;
+// batch_start[s] is set if sequence number s starts a batch.
+static char *batch_start;
+static atomic_int done;
+static atomic_long failures;
+
+static void fail(const char *what) {
+    if (atomic_fetch_add(&failures, 1) < 10) {
+        fprintf(stderr, "FAILED: %s\n", what);
+    }
+}
+
+static void *producer(void *arg) {
+    uint64_t t = (uintptr_t) arg;
+    for (long i = 0; i < appends; ) {
+        if (batch_start[i]) {
+            uint64_t batch[BATCH];
+            for (int j = 0; j < BATCH; j++) {
+                batch[j] = t << 32 | (uint64_t) (i + j);
+            }
+            if (DL_append_n_concurrent(dl, batch, BATCH) != 0) {
+                fail("DL_append_n_concurrent");
+            }
+            i += BATCH;
+        } else {
+            uint64_t v = t << 32 | (uint64_t) i;
+            if (DL_append_concurrent(dl, &v) != 0) {
+                fail("DL_append_concurrent");
+            }
+            i++;
+        }
+    }
+    return NULL;
+}
+
+/*
+* Checks the first `n` elements: the initial ones, then each producer's
+* sequence numbers in increasing order, batches unbroken. `next` holds
+* one counter per producer.
+*/
+static void check_prefix(long n, int producers, long *next, const char *what) {
+    for (int t = 0; t < producers; t++) {
+        next[t] = 0;
+    }
+    for (long i = 0; i < n; i++) {
+        uint64_t v = *(uint64_t *) DL_get_concurrent(dl, i);
+        if (i < INITIAL) {
+            if (v != (ORIGIN | (uint64_t) i)) {
+                fail(what);
+                return;
+            }
+            continue;
+        }
+        uint64_t t = v >> 32;
+        long s = (long) (v & 0xffffffff);
+        if (t >= (uint64_t) producers || s != next[t]) {
+            fail(what);
+            return;
+        }
+        next[t]++;
+        // A batch is reserved at once, so it is published as a whole.
+        if (batch_start[s] && i + BATCH > n) {
+            fail(what);
+            return;
+        }
+    }
+}
+
+static void *reader(void *arg) {
+    int producers = (int) (uintptr_t) arg;
+    long *next = malloc(producers * sizeof(long));
+    if (next == NULL) {
+        fail("allocation");
+        return NULL;
+    }
+    long last = 0;
+    while (!atomic_load(&done)) {
+        long n = DL_publish(dl);
+        if (n < last) {
+            fail("DL_publish went backwards");
+        }
+        last = n;
+        check_prefix(n, producers, next, "published prefix");
+    }
+    free(next);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int producers = argc > 1 ? atoi(argv[1]) : 4;
+    int readers = argc > 2 ? atoi(argv[2]) : 2;
+    appends = argc > 3 ? atol(argv[3]) : 100000;
+    producers = producers < 1 ? 1 : producers > 64 ? 64 : producers;
+    readers = readers < 0 ? 0 : readers > 64 ? 64 : readers;
+
+    batch_start = calloc(appends + 1, 1);
+    for (long i = 0; batch_start != NULL && i < appends; i += batch_start[i] ? BATCH : 1) {
+        batch_start[i] = i % 3 == 0 && i + BATCH <= appends;
+    }
+
+    dl = DL_create(3, sizeof(uint64_t), NULL);
+    for (uint64_t i = 0; i < INITIAL; i++) {
+        uint64_t v = ORIGIN | i;
+        DL_append(dl, &v);
+    }
+    if (batch_start == NULL || dl == NULL || DL_begin_concurrent(dl) != 0) {
+        fprintf(stderr, "Setup failed: %s\n", clib_strerror(clib_last_error()));
+        return EXIT_FAILURE;
+    }
+
+    pthread_t threads[128];
+    for (int i = 0; i < readers; i++) {
+        pthread_create(&threads[i], NULL, reader, (void *) (uintptr_t) producers);
+    }
+    for (int i = 0; i < producers; i++) {
+        pthread_create(&threads[readers + i], NULL, producer, (void *) (uintptr_t) i);
+    }
+    for (int i = 0; i < producers; i++) {
+        pthread_join(threads[readers + i], NULL);
+    }
+    atomic_store(&done, 1);
+    for (int i = 0; i < readers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    long total = INITIAL + producers * appends;
+    if (DL_publish(dl) != total) {
+        fail("final DL_publish");
+    }
+    if (DL_end_concurrent(dl) != 0 || DL_size(dl) != total) {
+        fail("DL_end_concurrent");
+    }
+
+    // Every element exactly once.
+    char *seen = calloc(producers * appends, 1);
+    if (seen == NULL) {
+        fail("allocation");
+    }
+    for (long i = INITIAL; seen != NULL && i < DL_size(dl); i++) {
+        uint64_t v = *(uint64_t *) DL_get(dl, i);
+        uint64_t t = v >> 32;
+        long s = (long) (v & 0xffffffff);
+        if (t >= (uint64_t) producers || s >= appends || seen[t * appends + s]++ != 0) {
+            fail("element after DL_end_concurrent");
+            break;
+        }
+    }
+    for (long i = 0; i < INITIAL; i++) {
+        if (*(uint64_t *) DL_get(dl, i) != (ORIGIN | (uint64_t) i)) {
+            fail("initial element after DL_end_concurrent");
+        }
+    }
+    free(seen);
+    free(batch_start);
+    DL_free(dl);
+
+    if (atomic_load(&failures) > 0) {
+        fprintf(stderr, "%ld failures\n", atomic_load(&failures));
+        return EXIT_FAILURE;
+    }
+    printf("stresstest: %d producers, %d readers, %ld appends each: OK\n", producers, readers, appends);
+    return EXIT_SUCCESS;
+}
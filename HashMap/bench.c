@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "hashmap.h"
+#include "dynlist.h"
+#include "clib_bench.h"
+
+/*
+* Microbenchmarks of HashMap on uint64 keys with uint64 values, and of
+* deduplicating and joining lists of keys with a hash set compared with
+* sorting a DynList (radix sort, then a unique pass or binary searches).
+* Usage: ./bench [--max-n N] [--format table|csv|json] [--filter S]
+*/
+
+static uint64_t *keys(CLIB_Bench *b, size_t n, uint64_t range) {
+    uint64_t *k = malloc(n * sizeof(uint64_t));
+    if (k == NULL) {
+        fprintf(stderr, "Allocation of keys failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < n; i++) {
+        k[i] = range > 0 ? clib_bench_rand(b) % range : clib_bench_rand(b);
+    }
+    return k;
+}
+
+static HashMap *create(CLIB_Bench *b, size_t value_stride) {
+    HashMap *map = HashMap_create_with_allocator(sizeof(uint64_t), value_stride, HashMap_hash_u64,
+                                                 HashMap_equals_u64, &b->allocator);
+    if (map == NULL) {
+        fprintf(stderr, "HashMap_create failed: %s\n", clib_strerror(clib_last_error()));
+        exit(EXIT_FAILURE);
+    }
+    return map;
+}
+
+static HashMap *filled(CLIB_Bench *b, uint64_t *k, size_t n) {
+    HashMap *map = create(b, sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++) {
+        HashMap_put(map, &k[i], &i);
+    }
+    return map;
+}
+
+static DynList *list_of(CLIB_Bench *b, uint64_t *k, size_t n) {
+    DynList *dl = DL_create_with_allocator(n, sizeof(uint64_t), DL_cmp_int64, &b->allocator);
+    if (dl == NULL || DL_append_n(dl, k, n) != 0) {
+        fprintf(stderr, "DynList creation failed: %s\n", clib_strerror(clib_last_error()));
+        exit(EXIT_FAILURE);
+    }
+    return dl;
+}
+
+static void bench_insert_random(CLIB_Bench *b, size_t n) {
+    uint64_t *k = keys(b, n, 0);
+    HashMap *map = create(b, sizeof(uint64_t));
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        HashMap_put(map, &k[i], &i);
+    }
+    clib_bench_stop(b, n);
+    HashMap_free(map);
+    free(k);
+}
+
+static void bench_insert_reserved(CLIB_Bench *b, size_t n) {
+    uint64_t *k = keys(b, n, 0);
+    HashMap *map = create(b, sizeof(uint64_t));
+    clib_bench_start(b);
+    HashMap_reserve(map, n);
+    for (size_t i = 0; i < n; i++) {
+        HashMap_put(map, &k[i], &i);
+    }
+    clib_bench_stop(b, n);
+    HashMap_free(map);
+    free(k);
+}
+
+static void run_lookup(CLIB_Bench *b, size_t n, int hit) {
+    uint64_t *k = keys(b, n, 0);
+    uint64_t *q = hit ? k : keys(b, n, 0);
+    HashMap *map = filled(b, k, n);
+    long found = 0;
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        found += HashMap_get(map, &q[i]) != NULL;
+    }
+    clib_bench_stop(b, n);
+    if (hit && found != (long) n) {
+        fprintf(stderr, "Lookup failed: found %ld of %zu keys.\n", found, n);
+    }
+    HashMap_free(map);
+    if (!hit) {
+        free(q);
+    }
+    free(k);
+}
+
+static void bench_lookup_hit(CLIB_Bench *b, size_t n) {
+    run_lookup(b, n, 1);
+}
+
+static void bench_lookup_miss(CLIB_Bench *b, size_t n) {
+    run_lookup(b, n, 0);
+}
+
+static void bench_iterate(CLIB_Bench *b, size_t n) {
+    uint64_t *k = keys(b, n, 0);
+    HashMap *map = filled(b, k, n);
+    HashMap_iter it;
+    uint64_t sum = 0;
+    clib_bench_start(b);
+    for (uint64_t *p = HashMap_iter_begin(map, &it); p != NULL; p = HashMap_iter_next(&it)) {
+        sum += *(uint64_t *) HashMap_iter_value(&it);
+    }
+    clib_bench_stop(b, n);
+    volatile uint64_t s = sum;
+    (void) s;
+    HashMap_free(map);
+    free(k);
+}
+
+static void bench_remove_random(CLIB_Bench *b, size_t n) {
+    uint64_t *k = keys(b, n, 0);
+    HashMap *map = filled(b, k, n);
+    clib_bench_start(b);
+    for (size_t i = 0; i < n; i++) {
+        HashMap_remove(map, &k[i]);
+    }
+    clib_bench_stop(b, n);
+    HashMap_free(map);
+    free(k);
+}
+
+// Deduplication of n keys taking about n/4 distinct values, keeping the
+// first occurrence of each (hash set) or the sorted unique keys (sort).
+static void bench_dedup_hashmap(CLIB_Bench *b, size_t n) {
+    uint64_t *k = keys(b, n, n / 4 + 1);
+    DynList *dl = list_of(b, k, n);
+    HashMap *seen = create(b, 0);
+    clib_bench_start(b);
+    uint64_t *data = (uint64_t *) dl->data;
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (HashMap_insert(seen, &data[i], NULL) == 0) {
+            data[unique++] = data[i];
+        }
+    }
+    dl->size = unique;
+    clib_bench_stop(b, n);
+    HashMap_free(seen);
+    DL_free(dl);
+    free(k);
+}
+
+static void bench_dedup_dynlist_sort(CLIB_Bench *b, size_t n) {
+    uint64_t *k = keys(b, n, n / 4 + 1);
+    DynList *dl = list_of(b, k, n);
+    clib_bench_start(b);
+    DL_sort_by_offset(dl, 0, DL_KEY_U64);
+    uint64_t *data = (uint64_t *) dl->data;
+    size_t unique = n > 0;
+    for (size_t i = 1; i < n; i++) {
+        if (data[i] != data[unique - 1]) {
+            data[unique++] = data[i];
+        }
+    }
+    dl->size = unique;
+    clib_bench_stop(b, n);
+    DL_free(dl);
+    free(k);
+}
+
+// Semi-join: counts the n keys of one list that occur in another list
+// of n keys (both about half overlapping).
+static void bench_join_hashmap(CLIB_Bench *b, size_t n) {
+    uint64_t *k1 = keys(b, n, 2 * n);
+    uint64_t *k2 = keys(b, n, 2 * n);
+    DynList *dl1 = list_of(b, k1, n);
+    DynList *dl2 = list_of(b, k2, n);
+    HashMap *set = create(b, 0);
+    long matches = 0;
+    clib_bench_start(b);
+    HashMap_reserve(set, n);
+    for (size_t i = 0; i < n; i++) {
+        HashMap_insert(set, DL_get(dl1, i), NULL);
+    }
+    for (size_t i = 0; i < n; i++) {
+        matches += HashMap_contains(set, DL_get(dl2, i));
+    }
+    clib_bench_stop(b, n);
+    volatile long m = matches;
+    (void) m;
+    HashMap_free(set);
+    DL_free(dl1);
+    DL_free(dl2);
+    free(k1);
+    free(k2);
+}
+
+static void bench_join_dynlist_bsearch(CLIB_Bench *b, size_t n) {
+    uint64_t *k1 = keys(b, n, 2 * n);
+    uint64_t *k2 = keys(b, n, 2 * n);
+    DynList *dl1 = list_of(b, k1, n);
+    DynList *dl2 = list_of(b, k2, n);
+    long matches = 0;
+    clib_bench_start(b);
+    DL_sort_by_offset(dl1, 0, DL_KEY_U64);
+    for (size_t i = 0; i < n; i++) {
+        matches += DL_bsearch(dl1, DL_get(dl2, i)) >= 0;
+    }
+    clib_bench_stop(b, n);
+    volatile long m = matches;
+    (void) m;
+    DL_free(dl1);
+    DL_free(dl2);
+    free(k1);
+    free(k2);
+}
+
+int main(int argc, char **argv) {
+    static const struct {
+        const char *name;
+        void (*fn)(CLIB_Bench *b, size_t n);
+    } benchmarks[] = {
+        { "insert_random",        bench_insert_random },
+        { "insert_reserved",      bench_insert_reserved },
+        { "lookup_hit",           bench_lookup_hit },
+        { "lookup_miss",          bench_lookup_miss },
+        { "iterate",              bench_iterate },
+        { "remove_random",        bench_remove_random },
+        { "dedup_hashmap",        bench_dedup_hashmap },
+        { "dedup_dynlist_sort",   bench_dedup_dynlist_sort },
+        { "join_hashmap",         bench_join_hashmap },
+        { "join_dynlist_bsearch", bench_join_dynlist_bsearch },
+    };
+
+    CLIB_Bench b;
+    clib_bench_init(&b, "HashMap", argc, argv);
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        for (size_t n = 1000; n <= b.max_n; n *= 10) {
+            clib_bench_run(&b, benchmarks[i].name, n, benchmarks[i].fn);
+        }
+    }
+    clib_bench_finish(&b);
+
+    return EXIT_SUCCESS;
+}
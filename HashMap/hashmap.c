@@ -0,0 +1,619 @@
+#include "hashmap.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HASHMAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/*
+* Open addressing with linear probing and Robin Hood ordering: an insert
+* takes the slot of any entry that is closer to its home slot than the
+* new entry already is. Entries with the same home slot are therefore
+* stored next to each other, and a lookup can stop at the first entry
+* that is closer to its home than the key would be at that slot.
+*
+* Each slot has two control bytes, the distance from the home slot and
+* a tag of 7 hash bits, kept in separate arrays. Lookups compare the
+* control bytes of `HASHMAP_GROUP` slots at once and only call `equals`
+* for slots whose distance and tag both match.
+*
+* Removing an entry shifts the following entries of its run back by one
+* slot (backward shift deletion), so there are no tombstones and lookups
+* never get slower after many removals.
+*/
+
+// Initial number of home slots.
+#define MIN_CAPACITY 16
+// Times `resize` doubles the capacity again when entries do not fit.
+#define MAX_RETRIES 3
+#define NOT_FOUND SIZE_MAX
+
+/**
+* `mix` spreads the bits of a hash over the whole word, so home slots
+* and tags are well distributed even for weak hash functions.
+*/
+static inline uint64_t mix(uint64_t h) {
+    return h * 0x9E3779B97F4A7C15ull;
+}
+
+static inline size_t home_of(HashMap *map, uint64_t h) {
+    return (size_t) (h >> map->shift);
+}
+
+// The 7 bits below the home slot bits.
+static inline unsigned char tag_of(HashMap *map, uint64_t h) {
+    return (unsigned char) ((h >> (map->shift - 7)) & 0x7F);
+}
+
+static inline char *entry_at(HashMap *map, size_t pos) {
+    return map->entries + pos * map->entry_size;
+}
+
+/**
+* `slots` returns the number of entries stored for `capacity` home
+* slots: entries may be `HASHMAP_MAX_DIST - 1` slots behind their home.
+*/
+static inline size_t slots(size_t capacity) {
+    return capacity + HASHMAP_MAX_DIST;
+}
+
+/**
+* `ctrl_bytes` returns the length of the control byte arrays: the slots
+* plus one group, so probing can always load a full group.
+*/
+static inline size_t ctrl_bytes(size_t capacity) {
+    return slots(capacity) + HASHMAP_GROUP;
+}
+
+/**
+* `find` returns the slot of `key` (with the mixed hash `h`), or
+* `NOT_FOUND`.
+*/
+static size_t find(HashMap *map, void *key, uint64_t h) {
+    size_t pos = home_of(map, h);
+    unsigned char tag = tag_of(map, h);
+
+#ifdef HASHMAP_SSE2
+    // Distances the key would have at the slots of the group.
+    __m128i expect = _mm_setr_epi8(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16);
+    __m128i step   = _mm_set1_epi8(HASHMAP_GROUP);
+    __m128i tags   = _mm_set1_epi8((char) tag);
+    for (int d = 0; d < HASHMAP_MAX_DIST; d += HASHMAP_GROUP, pos += HASHMAP_GROUP) {
+        __m128i dist = _mm_loadu_si128((const __m128i *) (map->dist + pos));
+        __m128i tg   = _mm_loadu_si128((const __m128i *) (map->tags + pos));
+        unsigned match = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(dist, expect),
+                                                         _mm_cmpeq_epi8(tg, tags)));
+        // Slots that are empty or hold an entry closer to its home end
+        // the search. Distances are below 128, so signed compares work.
+        unsigned stop = _mm_movemask_epi8(_mm_cmpgt_epi8(expect, dist));
+        if (stop != 0) {
+            match &= (stop & -stop) - 1;
+        }
+        while (match != 0) {
+            size_t i = pos + __builtin_ctz(match);
+            if (map->equals(key, entry_at(map, i))) {
+                return i;
+            }
+            match &= match - 1;
+        }
+        if (stop != 0) {
+            return NOT_FOUND;
+        }
+        expect = _mm_add_epi8(expect, step);
+    }
+#else
+    for (unsigned d = 1; d <= HASHMAP_MAX_DIST; d++, pos++) {
+        if (map->dist[pos] < d) {
+            return NOT_FOUND;
+        }
+        if (map->dist[pos] == d && map->tags[pos] == tag && map->equals(key, entry_at(map, pos))) {
+            return pos;
+        }
+    }
+#endif
+    return NOT_FOUND;
+}
+
+/**
+* `place` stores the entry in `buf` (with the mixed hash `h`), which
+* must not be in the map, moving entries closer to their home slot
+* further back. Returns 0 on success, or 1 (with the map and `buf`
+* unchanged) if an entry would end up `HASHMAP_MAX_DIST` or more slots
+* behind its home.
+*/
+static int place(HashMap *map, char *buf, uint64_t h) {
+    char *tmp = map->scratch + 2 * map->entry_size;
+    size_t home = home_of(map, h);
+    unsigned char tag = tag_of(map, h);
+    unsigned char d = 1;
+    // Slots taken from other entries, with their old control bytes.
+    unsigned char swap_at[HASHMAP_MAX_DIST], swap_dist[HASHMAP_MAX_DIST], swap_tag[HASHMAP_MAX_DIST];
+    int swaps = 0;
+
+    for (size_t k = 0; k < HASHMAP_MAX_DIST; k++, d++) {
+        size_t pos = home + k;
+        if (map->dist[pos] == 0) {
+            memcpy(entry_at(map, pos), buf, map->entry_size);
+            map->dist[pos] = d;
+            map->tags[pos] = tag;
+            return 0;
+        }
+        if (map->dist[pos] < d) {
+            // Take the slot and carry its entry on.
+            swap_at[swaps]   = (unsigned char) k;
+            swap_dist[swaps] = map->dist[pos];
+            swap_tag[swaps]  = map->tags[pos];
+            swaps++;
+            memcpy(tmp, entry_at(map, pos), map->entry_size);
+            memcpy(entry_at(map, pos), buf, map->entry_size);
+            memcpy(buf, tmp, map->entry_size);
+            map->dist[pos] = d;
+            map->tags[pos] = tag;
+            d   = swap_dist[swaps - 1];
+            tag = swap_tag[swaps - 1];
+        }
+    }
+
+    // Too far from home: put every entry back where it was.
+    while (swaps-- > 0) {
+        size_t pos = home + swap_at[swaps];
+        memcpy(tmp, entry_at(map, pos), map->entry_size);
+        memcpy(entry_at(map, pos), buf, map->entry_size);
+        memcpy(buf, tmp, map->entry_size);
+        map->dist[pos] = swap_dist[swaps];
+        map->tags[pos] = swap_tag[swaps];
+    }
+    return 1;
+}
+
+/**
+* `resize` moves all entries into new arrays with `capacity` home
+* slots, doubling it up to `MAX_RETRIES` times while entries end up too
+* far from home. On failure the map is unchanged.
+* Returns 0 on success, -1 otherwise.
+*/
+static int resize(HashMap *map, size_t capacity, const char *caller) {
+    CLIB_Allocator *a = &map->allocator;
+    char *carry = map->scratch + map->entry_size;
+
+    for (int retry = 0; ; retry++) {
+        if (capacity > SIZE_MAX / 4 || ctrl_bytes(capacity) > SIZE_MAX / 2 / map->entry_size) {
+            CLIB_FAIL(CLIB_EOVERFLOW, "%s error: capacity of %zu slots overflows.", caller, capacity);
+            return -1;
+        }
+
+        size_t n = ctrl_bytes(capacity);
+        char *entries = (char *) a->alloc(a->ctx, slots(capacity) * map->entry_size);
+        unsigned char *ctrl = (unsigned char *) a->alloc(a->ctx, 2 * n);
+        if (entries == NULL || ctrl == NULL) {
+            CLIB_FAIL(CLIB_ENOMEM, "%s error: failed to allocate memory for %zu slots.", caller, capacity);
+            if (entries != NULL) {
+                a->free(a->ctx, entries, slots(capacity) * map->entry_size);
+            }
+            if (ctrl != NULL) {
+                a->free(a->ctx, ctrl, 2 * n);
+            }
+            return -1;
+        }
+        memset(ctrl, 0, 2 * n);
+
+        HashMap old = *map;
+        map->entries  = entries;
+        map->dist     = ctrl;
+        map->tags     = ctrl + n;
+        map->capacity = capacity;
+        map->shift    = 64 - __builtin_ctzll(capacity);
+
+        int full = 0;
+        for (size_t i = 0; old.entries != NULL && i < slots(old.capacity) && !full; i++) {
+            if (old.dist[i] != 0) {
+                char *e = old.entries + i * old.entry_size;
+                memcpy(carry, e, map->entry_size);
+                full = place(map, carry, mix(map->hash(e)));
+            }
+        }
+
+        if (!full) {
+            if (old.entries != NULL) {
+                a->free(a->ctx, old.entries, slots(old.capacity) * old.entry_size);
+                a->free(a->ctx, old.dist, 2 * ctrl_bytes(old.capacity));
+            }
+            return 0;
+        }
+
+        // Hashes cluster too much for this capacity: start over with twice
+        // as many slots.
+        a->free(a->ctx, entries, slots(capacity) * map->entry_size);
+        a->free(a->ctx, ctrl, 2 * n);
+        map->entries  = old.entries;
+        map->dist     = old.dist;
+        map->tags     = old.tags;
+        map->capacity = old.capacity;
+        map->shift    = old.shift;
+        if (retry == MAX_RETRIES) {
+            CLIB_FAIL(CLIB_EOVERFLOW, "%s error: too many keys with colliding hashes.", caller);
+            return -1;
+        }
+        capacity *= 2;
+    }
+}
+
+/**
+* `alignment` returns the alignment assumed for an object of `size`
+* bytes: the largest power of two dividing it, at most 16.
+*/
+static size_t alignment(size_t size) {
+    size_t align = 1;
+    while (align < 16 && size % (2 * align) == 0) {
+        align *= 2;
+    }
+    return align;
+}
+
+/**
+* `HashMap_create` creates an empty hash map from keys of `key_stride`
+* bytes to values of `value_stride` bytes. With a `value_stride` of 0
+* it is a hash set. `hash` must return equal hashes for keys `equals`
+* considers equal (non-zero return value). In case of failure it
+* returns `NULL`.
+*/
+HashMap *HashMap_create(size_t key_stride, size_t value_stride,
+                        uint64_t (*hash)(void *key), int (*equals)(void *key1, void *key2)) {
+    return HashMap_create_with_allocator(key_stride, value_stride, hash, equals, NULL);
+}
+
+/**
+* `HashMap_create_with_allocator` works like `HashMap_create`, but all
+* memory is obtained from `allocator` (malloc/realloc/free if `NULL`).
+*/
+HashMap *HashMap_create_with_allocator(size_t key_stride, size_t value_stride,
+                                       uint64_t (*hash)(void *key),
+                                       int (*equals)(void *key1, void *key2),
+                                       const CLIB_Allocator *allocator) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    if (key_stride == 0 || hash == NULL || equals == NULL ||
+        key_stride > SIZE_MAX / 64 || value_stride > SIZE_MAX / 64) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_create error: invalid stride or missing hash/equals function.");
+        return NULL;
+    }
+
+    // Values (and keys, in the following entries) are aligned as their
+    // size suggests.
+    size_t value_align  = value_stride > 0 ? alignment(value_stride) : 1;
+    size_t entry_align  = alignment(key_stride) > value_align ? alignment(key_stride) : value_align;
+    size_t value_offset = (key_stride + value_align - 1) / value_align * value_align;
+    size_t entry_size   = (value_offset + value_stride + entry_align - 1) / entry_align * entry_align;
+
+    // Scratch space for the entry being inserted, the entry carried
+    // along while placing it, and a swap buffer.
+    HashMap *map = (HashMap *) a.alloc(a.ctx, sizeof(HashMap) + 3 * entry_size);
+    if (map == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "HashMap_create error: failed to allocate memory.");
+        return NULL;
+    }
+    memset(map, 0, sizeof(HashMap));
+    map->key_stride   = key_stride;
+    map->value_stride = value_stride;
+    map->value_offset = value_offset;
+    map->entry_size   = entry_size;
+    map->hash         = hash;
+    map->equals       = equals;
+    map->allocator    = a;
+
+    if (resize(map, MIN_CAPACITY, "HashMap_create") != 0) {
+        a.free(a.ctx, map, sizeof(HashMap) + 3 * entry_size);
+        return NULL;
+    }
+
+    return map;
+}
+
+/**
+* `HashMap_free` frees the map and all its entries.
+*/
+void HashMap_free(HashMap *map) {
+    if (map == NULL) {
+        return;
+    }
+
+    CLIB_Allocator a = map->allocator;
+    a.free(a.ctx, map->entries, slots(map->capacity) * map->entry_size);
+    a.free(a.ctx, map->dist, 2 * ctrl_bytes(map->capacity));
+    a.free(a.ctx, map, sizeof(HashMap) + 3 * map->entry_size);
+}
+
+/**
+* `add` stores `key` and `value` (which may be NULL for sets). If the
+* key is present, its value is overwritten if `replace` is set.
+* Returns 0 if the key was added, 1 if it was present, -1 on failure.
+*/
+static int add(HashMap *map, void *key, void *value, int replace, const char *caller) {
+    if (map == NULL || key == NULL || (value == NULL && map->value_stride > 0)) {
+        CLIB_FAIL(CLIB_EINVAL, "%s error: map, key or value is NULL.", caller);
+        return -1;
+    }
+
+    uint64_t h = mix(map->hash(key));
+    size_t pos = find(map, key, h);
+    if (pos != NOT_FOUND) {
+        if (replace && map->value_stride > 0) {
+            memcpy(entry_at(map, pos) + map->value_offset, value, map->value_stride);
+        }
+        return 1;
+    }
+
+    // Keep the load factor at or below 7/8.
+    if (map->size + 1 > map->capacity - map->capacity / 8 &&
+        resize(map, 2 * map->capacity, caller) != 0) {
+        return -1;
+    }
+
+    char *pending = map->scratch;
+    memcpy(pending, key, map->key_stride);
+    if (map->value_stride > 0) {
+        memcpy(pending + map->value_offset, value, map->value_stride);
+    }
+    if (place(map, pending, h) != 0) {
+        // Its run is too long. Spreading the keys over twice as many home
+        // slots shortens runs, unless the hashes themselves collide: then
+        // the map is mostly empty, and does not grow any further.
+        if (map->size < map->capacity / 4) {
+            CLIB_FAIL(CLIB_EOVERFLOW, "%s error: too many keys with colliding hashes.", caller);
+            return -1;
+        }
+        if (resize(map, 2 * map->capacity, caller) != 0) {
+            return -1;
+        }
+        if (place(map, pending, h) != 0) {
+            CLIB_FAIL(CLIB_EOVERFLOW, "%s error: too many keys with colliding hashes.", caller);
+            return -1;
+        }
+    }
+    map->size++;
+
+    return 0;
+}
+
+/**
+* `HashMap_put` sets the value of `key` to `value`, adding the key if
+* it is not present. For sets `value` is ignored and may be NULL.
+* Returns 0 if the key was added, 1 if it was present, -1 on failure.
+*/
+int HashMap_put(HashMap *map, void *key, void *value) {
+    return add(map, key, value, 1, "HashMap_put");
+}
+
+/**
+* `HashMap_insert` adds `key` with `value` unless the key is present,
+* in which case the map is unchanged. For sets `value` is ignored and
+* may be NULL.
+* Returns 0 if the key was added, 1 if it was present, -1 on failure.
+*/
+int HashMap_insert(HashMap *map, void *key, void *value) {
+    return add(map, key, value, 0, "HashMap_insert");
+}
+
+/**
+* `HashMap_get` returns a pointer to the value of `key` (to the stored
+* key for sets), or NULL if the key is not present. The pointer is
+* valid until the map is modified.
+*/
+void *HashMap_get(HashMap *map, void *key) {
+    if (map == NULL || key == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_get error: map or key is NULL.");
+        return NULL;
+    }
+
+    size_t pos = find(map, key, mix(map->hash(key)));
+    if (pos == NOT_FOUND) {
+        return NULL;
+    }
+    return entry_at(map, pos) + (map->value_stride > 0 ? map->value_offset : 0);
+}
+
+/**
+* `HashMap_contains` returns 1 if `key` is present, 0 if it is not and
+* -1 if `map` or `key` is NULL.
+*/
+int HashMap_contains(HashMap *map, void *key) {
+    if (map == NULL || key == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_contains error: map or key is NULL.");
+        return -1;
+    }
+    return find(map, key, mix(map->hash(key))) != NOT_FOUND;
+}
+
+/**
+* `HashMap_remove` removes `key` and its value. The following entries
+* of the run are shifted back by one slot, so no tombstone is left.
+* Returns 0 if the key was removed, 1 if it was not present, -1 on
+* failure.
+*/
+int HashMap_remove(HashMap *map, void *key) {
+    if (map == NULL || key == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_remove error: map or key is NULL.");
+        return -1;
+    }
+
+    size_t pos = find(map, key, mix(map->hash(key)));
+    if (pos == NOT_FOUND) {
+        return 1;
+    }
+
+    // Entries at their home slot (distance 1) and empty slots end the run.
+    while (map->dist[pos + 1] > 1) {
+        memcpy(entry_at(map, pos), entry_at(map, pos + 1), map->entry_size);
+        map->dist[pos] = map->dist[pos + 1] - 1;
+        map->tags[pos] = map->tags[pos + 1];
+        pos++;
+    }
+    map->dist[pos] = 0;
+    map->size--;
+
+    return 0;
+}
+
+/**
+* `HashMap_reserve` makes sure `n` keys fit into the map without
+* growing it.
+* Returns 0 on success, -1 otherwise.
+*/
+int HashMap_reserve(HashMap *map, size_t n) {
+    if (map == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_reserve error: provided map is NULL.");
+        return -1;
+    }
+
+    size_t capacity = map->capacity;
+    while (n > capacity - capacity / 8) {
+        if (capacity > SIZE_MAX / 4) {
+            CLIB_FAIL(CLIB_EOVERFLOW, "HashMap_reserve error: %zu keys overflow the capacity.", n);
+            return -1;
+        }
+        capacity *= 2;
+    }
+    if (capacity == map->capacity) {
+        return 0;
+    }
+    return resize(map, capacity, "HashMap_reserve");
+}
+
+/**
+* `HashMap_clear` removes all keys. The capacity remains unchanged.
+*/
+void HashMap_clear(HashMap *map) {
+    if (map == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_clear error: provided map is NULL.");
+        return;
+    }
+    memset(map->dist, 0, ctrl_bytes(map->capacity));
+    map->size = 0;
+}
+
+/**
+* `HashMap_size` returns the number of keys in the map.
+*/
+long HashMap_size(HashMap *map) {
+    if (map == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_size error: provided map is NULL.");
+        return -1;
+    }
+    return (long) map->size;
+}
+
+/**
+* `next_entry` positions `it` at the first entry at or behind slot
+* `pos` and returns its key, or NULL if there is none.
+*/
+static void *next_entry(HashMap_iter *it, size_t pos) {
+    HashMap *map = it->map;
+    size_t n = slots(map->capacity);
+    while (pos < n && map->dist[pos] == 0) {
+        pos++;
+    }
+    it->pos = pos;
+    return pos < n ? entry_at(map, pos) : NULL;
+}
+
+/**
+* `HashMap_iter_begin` positions `it` at the first entry of `map` and
+* returns a pointer to its key, or NULL if the map is empty. Entries
+* are visited in no particular order. Modifying the map invalidates
+* its iterators.
+*/
+void *HashMap_iter_begin(HashMap *map, HashMap_iter *it) {
+    if (map == NULL || it == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_iter_begin error: map or iterator is NULL.");
+        return NULL;
+    }
+    it->map = map;
+    return next_entry(it, 0);
+}
+
+/**
+* `HashMap_iter_next` moves `it` to the next entry and returns a pointer
+* to its key, or NULL at the end.
+*/
+void *HashMap_iter_next(HashMap_iter *it) {
+    if (it == NULL || it->map == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_iter_next error: iterator is NULL or not started.");
+        return NULL;
+    }
+    if (it->pos >= slots(it->map->capacity)) {
+        return NULL;
+    }
+    return next_entry(it, it->pos + 1);
+}
+
+/**
+* `HashMap_iter_value` returns a pointer to the value of the current
+* entry, or NULL at the end and for sets.
+*/
+void *HashMap_iter_value(HashMap_iter *it) {
+    if (it == NULL || it->map == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "HashMap_iter_value error: iterator is NULL or not started.");
+        return NULL;
+    }
+    HashMap *map = it->map;
+    if (it->pos >= slots(map->capacity) || map->value_stride == 0) {
+        return NULL;
+    }
+    return entry_at(map, it->pos) + map->value_offset;
+}
+
+/**
+* Built-in hash functions. Integer keys are scrambled with the
+* finalizer of SplitMix64, so every bit of the key affects every bit
+* of the hash.
+*/
+static inline uint64_t finalize(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t HashMap_hash_u32(void *key) {
+    uint32_t k;
+    memcpy(&k, key, sizeof(k));
+    return finalize(k);
+}
+
+uint64_t HashMap_hash_u64(void *key) {
+    uint64_t k;
+    memcpy(&k, key, sizeof(k));
+    return finalize(k);
+}
+
+int HashMap_equals_u32(void *key1, void *key2) {
+    return *(uint32_t *) key1 == *(uint32_t *) key2;
+}
+
+int HashMap_equals_u64(void *key1, void *key2) {
+    return *(uint64_t *) key1 == *(uint64_t *) key2;
+}
+
+/**
+* `HashMap_hash_bytes` hashes `len` bytes at `data`, 8 bytes at a time.
+* Use it to build hash functions for composite keys, e.g. for strings.
+*/
+uint64_t HashMap_hash_bytes(const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *) data;
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ finalize(w)) * 0x9E3779B97F4A7C15ull;
+        p   += 8;
+        len -= 8;
+    }
+    if (len > 0) {
+        uint64_t w = 0;
+        memcpy(&w, p, len);
+        h = (h ^ finalize(w)) * 0x9E3779B97F4A7C15ull;
+    }
+    return finalize(h);
+}
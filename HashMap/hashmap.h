@@ -0,0 +1,83 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "clib_alloc.h"
+#include "clib_log.h"
+
+// Control bytes compared at once while probing.
+#define HASHMAP_GROUP 16
+// Entries are stored less than this many slots behind their home slot;
+// an insert that would place one further away grows the table instead.
+// A multiple of `HASHMAP_GROUP` below 128, see `find`.
+#define HASHMAP_MAX_DIST 112
+
+typedef struct {
+    // Entries: the key, followed by the value at `value_offset`, padded
+    // to `entry_size` bytes. Slot i holds an entry if `dist[i] != 0`.
+    char *entries;
+    // Control bytes per slot: `dist` is the distance of the entry from
+    // its home slot plus 1 (0 for an empty slot), `tags` holds 7 bits of
+    // its hash.
+    unsigned char *dist;
+    unsigned char *tags;
+    // Number of home slots (a power of two) and `64 - log2(capacity)`.
+    // Entries may be stored up to `HASHMAP_MAX_DIST` slots behind the
+    // last home slot, so the arrays never wrap around.
+    size_t capacity;
+    unsigned int shift;
+    // Number of entries.
+    size_t size;
+    size_t key_stride;
+    size_t value_stride;
+    size_t value_offset;
+    size_t entry_size;
+    uint64_t (*hash)(void *key);
+    int (*equals)(void *key1, void *key2);
+    // Allocator for the map and its arrays.
+    CLIB_Allocator allocator;
+    // Room for three entries while inserting (the new entry, the entry
+    // being moved and a swap buffer).
+    _Alignas(max_align_t) char scratch[];
+} HashMap;
+
+typedef struct {
+    HashMap *map;
+    // Slot of the current entry.
+    size_t pos;
+} HashMap_iter;
+
+HashMap *HashMap_create(size_t key_stride, size_t value_stride,
+                        uint64_t (*hash)(void *key), int (*equals)(void *key1, void *key2));
+HashMap *HashMap_create_with_allocator(size_t key_stride, size_t value_stride,
+                                       uint64_t (*hash)(void *key),
+                                       int (*equals)(void *key1, void *key2),
+                                       const CLIB_Allocator *allocator);
+void HashMap_free(HashMap *map);
+int HashMap_put(HashMap *map, void *key, void *value);
+int HashMap_insert(HashMap *map, void *key, void *value);
+void *HashMap_get(HashMap *map, void *key);
+int HashMap_contains(HashMap *map, void *key);
+int HashMap_remove(HashMap *map, void *key);
+int HashMap_reserve(HashMap *map, size_t n);
+void HashMap_clear(HashMap *map);
+long HashMap_size(HashMap *map);
+void *HashMap_iter_begin(HashMap *map, HashMap_iter *it);
+void *HashMap_iter_next(HashMap_iter *it);
+void *HashMap_iter_value(HashMap_iter *it);
+
+// Built-in hash and equality functions for integer keys, and a hash for
+// arbitrary bytes to build others with.
+uint64_t HashMap_hash_u32(void *key);
+uint64_t HashMap_hash_u64(void *key);
+int HashMap_equals_u32(void *key1, void *key2);
+int HashMap_equals_u64(void *key1, void *key2);
+uint64_t HashMap_hash_bytes(const void *data, size_t len);
+
+#endif
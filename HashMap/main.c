@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "hashmap.h"
+
+typedef struct {
+    char name[16];
+} name_t;
+
+typedef struct {
+    int age;
+    float height;
+} person_t;
+
+uint64_t hash_key(void *key) {
+    return HashMap_hash_bytes(((name_t *) key)->name, strlen(((name_t *) key)->name));
+}
+
+int equals_key(void *a, void *b) {
+    return strcmp(((name_t *) a)->name, ((name_t *) b)->name) == 0;
+}
+
+int main() {
+
+    printf("----- HashMap -----\n\n");
+
+    HashMap *people = HashMap_create(sizeof(name_t), sizeof(person_t), hash_key, equals_key);
+    if (people == NULL) {
+        printf("Creation of HashMap failed.\n");
+        return 1;
+    }
+    printf("HashMap created successfully.\n");
+
+    name_t alice = { "alice" }, bob = { "bob" }, carol = { "carol" };
+    person_t pa = { 21, 1.76f }, pb = { 23, 1.86f }, pc = { 25, 1.80f };
+    HashMap_put(people, &alice, &pa);
+    HashMap_put(people, &bob, &pb);
+    printf("insert carol: %d\n", HashMap_insert(people, &carol, &pc));
+    printf("insert carol again: %d (already present)\n", HashMap_insert(people, &carol, &pa));
+
+    person_t *p = HashMap_get(people, &carol);
+    printf("carol: age %d, height %.2f\n", p->age, p->height);
+    pc.age = 26;
+    printf("put carol: %d (replaced)\n", HashMap_put(people, &carol, &pc));
+    printf("carol: age %d\n", ((person_t *) HashMap_get(people, &carol))->age);
+
+    HashMap_iter it;
+    for (name_t *k = HashMap_iter_begin(people, &it); k != NULL; k = HashMap_iter_next(&it)) {
+        printf("%s is %d\n", k->name, ((person_t *) HashMap_iter_value(&it))->age);
+    }
+
+    printf("remove bob: %d\n", HashMap_remove(people, &bob));
+    printf("remove bob again: %d (absent)\n", HashMap_remove(people, &bob));
+    printf("contains bob: %d, size: %ld\n", HashMap_contains(people, &bob), HashMap_size(people));
+    HashMap_free(people);
+
+
+    printf("\n--- Sets ---\n");
+
+    // With a value stride of 0 the map is a set: deduplicate 100000
+    // numbers that take 1000 distinct values.
+    HashMap *seen = HashMap_create(sizeof(uint64_t), 0, HashMap_hash_u64, HashMap_equals_u64);
+    HashMap_reserve(seen, 1000);
+    long unique = 0;
+    for (uint64_t i = 0; i < 100000; i++) {
+        uint64_t x = (i * 7919) % 1000;
+        if (HashMap_insert(seen, &x, NULL) == 0) {
+            unique++;
+        }
+    }
+    printf("unique values: %ld, size: %ld\n", unique, HashMap_size(seen));
+
+    // Removals leave no tombstones behind.
+    for (uint64_t x = 0; x < 1000; x += 2) {
+        HashMap_remove(seen, &x);
+    }
+    uint64_t x = 501;
+    printf("after removing the even values: size %ld, contains 501: %d\n", HashMap_size(seen), HashMap_contains(seen, &x));
+    if (HashMap_size(seen) != 500 || !HashMap_contains(seen, &x)) {
+        return 1;
+    }
+    HashMap_free(seen);
+
+    printf("\n--- Errors ---\n");
+    clib_clear_error();
+    if (HashMap_create(sizeof(name_t), 0, NULL, equals_key) == NULL) {
+        printf("HashMap_create without hash failed: %s\n", clib_strerror(clib_last_error()));
+    }
+    HashMap *empty = HashMap_create(sizeof(uint64_t), 0, HashMap_hash_u64, HashMap_equals_u64);
+    if (HashMap_contains(NULL, &x) != -1 || HashMap_contains(empty, NULL) != -1) {
+        return 1;
+    }
+    HashMap_free(empty);
+    printf("HashMap_contains with NULL failed: %s\n", clib_strerror(clib_last_error()));
+
+    printf("All good!\n");
+    return EXIT_SUCCESS;
+}
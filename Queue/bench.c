@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include "queue.h"
+#include "dynlist.h"
+#include "clib_bench.h"
+
+/*
+* Throughput of passing n int64 messages from producer to consumer
+* threads through a queue of 1024 elements, compared with a mutex
+* guarded DynList used as a queue (`DL_append` / `DL_pop_into(dl, 0)`).
+* Full and empty queues are waited on with `sched_yield`.
+* Usage: ./bench [--max-n N] [--format table|csv|json] [--filter S]
+*/
+
+#define QUEUE_CAPACITY 1024
+
+typedef struct {
+    DynList         *dl;
+    pthread_mutex_t lock;
+} locked_list;
+
+static int locked_push(void *q, const void *element) {
+    locked_list *l = (locked_list *) q;
+    pthread_mutex_lock(&l->lock);
+    int rc = DL_size(l->dl) >= QUEUE_CAPACITY ? 1 : DL_append(l->dl, (void *) element);
+    pthread_mutex_unlock(&l->lock);
+    return rc;
+}
+
+static int locked_pop(void *q, void *out) {
+    locked_list *l = (locked_list *) q;
+    pthread_mutex_lock(&l->lock);
+    int rc = DL_size(l->dl) == 0 ? 1 : DL_pop_into(l->dl, 0, out);
+    pthread_mutex_unlock(&l->lock);
+    return rc;
+}
+
+static int spsc_push(void *q, const void *element) {
+    return SPSCQueue_push((SPSCQueue *) q, element);
+}
+
+static int spsc_pop(void *q, void *out) {
+    return SPSCQueue_pop((SPSCQueue *) q, out);
+}
+
+static int mpmc_push(void *q, const void *element) {
+    return MPMCQueue_push((MPMCQueue *) q, element);
+}
+
+static int mpmc_pop(void *q, void *out) {
+    return MPMCQueue_pop((MPMCQueue *) q, out);
+}
+
+typedef struct {
+    void    *q;
+    int     (*push)(void *q, const void *element);
+    int     (*pop)(void *q, void *out);
+    int64_t lo, hi;
+    int64_t sum;
+} worker_arg;
+
+static void *producer(void *arg) {
+    worker_arg *w = (worker_arg *) arg;
+    for (int64_t i = w->lo; i < w->hi; i++) {
+        while (w->push(w->q, &i) == 1) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    worker_arg *w = (worker_arg *) arg;
+    int64_t v;
+    for (int64_t i = w->lo; i < w->hi; i++) {
+        while (w->pop(w->q, &v) == 1) {
+            sched_yield();
+        }
+        w->sum += v;
+    }
+    return NULL;
+}
+
+/**
+* `run` passes `n` messages from `threads` producers to `threads`
+* consumers and checks that each arrived once.
+*/
+static void run(CLIB_Bench *b, size_t n, int threads, void *q,
+                int (*push)(void *q, const void *element), int (*pop)(void *q, void *out)) {
+    pthread_t tids[16];
+    worker_arg args[16];
+
+    clib_bench_start(b);
+    for (int i = 0; i < threads; i++) {
+        int64_t lo = (int64_t) (n * i / threads), hi = (int64_t) (n * (i + 1) / threads);
+        args[2 * i]     = (worker_arg) { q, push, pop, lo, hi, 0 };
+        args[2 * i + 1] = (worker_arg) { q, push, pop, lo, hi, 0 };
+        pthread_create(&tids[2 * i], NULL, producer, &args[2 * i]);
+        pthread_create(&tids[2 * i + 1], NULL, consumer, &args[2 * i + 1]);
+    }
+    int64_t sum = 0;
+    for (int i = 0; i < 2 * threads; i++) {
+        pthread_join(tids[i], NULL);
+        sum += args[i].sum;
+    }
+    clib_bench_stop(b, n);
+
+    if (sum != (int64_t) n * ((int64_t) n - 1) / 2) {
+        fprintf(stderr, "Messages lost: sum %lld.\n", (long long) sum);
+    }
+}
+
+static void run_locked(CLIB_Bench *b, size_t n, int threads) {
+    locked_list l;
+    l.dl = DL_create_with_allocator(QUEUE_CAPACITY, sizeof(int64_t), NULL, &b->allocator);
+    pthread_mutex_init(&l.lock, NULL);
+    run(b, n, threads, &l, locked_push, locked_pop);
+    pthread_mutex_destroy(&l.lock);
+    DL_free(l.dl);
+}
+
+static void run_mpmc(CLIB_Bench *b, size_t n, int threads) {
+    MPMCQueue *q = MPMCQueue_create_with_allocator(QUEUE_CAPACITY, sizeof(int64_t), &b->allocator);
+    run(b, n, threads, q, mpmc_push, mpmc_pop);
+    MPMCQueue_free(q);
+}
+
+static void bench_spsc(CLIB_Bench *b, size_t n) {
+    SPSCQueue *q = SPSCQueue_create_with_allocator(QUEUE_CAPACITY, sizeof(int64_t), &b->allocator);
+    run(b, n, 1, q, spsc_push, spsc_pop);
+    SPSCQueue_free(q);
+}
+
+static void bench_mpmc_1x1(CLIB_Bench *b, size_t n) {
+    run_mpmc(b, n, 1);
+}
+
+static void bench_mpmc_4x4(CLIB_Bench *b, size_t n) {
+    run_mpmc(b, n, 4);
+}
+
+static void bench_locked_dynlist_1x1(CLIB_Bench *b, size_t n) {
+    run_locked(b, n, 1);
+}
+
+static void bench_locked_dynlist_4x4(CLIB_Bench *b, size_t n) {
+    run_locked(b, n, 4);
+}
+
+int main(int argc, char **argv) {
+    static const struct {
+        const char *name;
+        void (*fn)(CLIB_Bench *b, size_t n);
+    } benchmarks[] = {
+        { "spsc",                bench_spsc },
+        { "mpmc_1x1",            bench_mpmc_1x1 },
+        { "mpmc_4x4",            bench_mpmc_4x4 },
+        { "locked_dynlist_1x1",  bench_locked_dynlist_1x1 },
+        { "locked_dynlist_4x4",  bench_locked_dynlist_4x4 },
+    };
+
+    CLIB_Bench b;
+    clib_bench_init(&b, "Queue", argc, argv);
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        for (size_t n = 1000; n <= b.max_n; n *= 10) {
+            clib_bench_run(&b, benchmarks[i].name, n, benchmarks[i].fn);
+        }
+    }
+    clib_bench_finish(&b);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "queue.h"
+
+#define MESSAGES 100000
+#define THREADS 2
+
+typedef struct {
+    size_t id;
+    int producer;
+    float payload;
+} message_t;
+
+static SPSCQueue *spsc;
+static MPMCQueue *mpmc;
+
+static void *spsc_producer(void *arg) {
+    (void) arg;
+    for (size_t i = 0; i < MESSAGES; i++) {
+        message_t m = { .id = i, .producer = 0, .payload = i * 0.5f };
+        while (SPSCQueue_push(spsc, &m) == 1) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *mpmc_producer(void *arg) {
+    int id = *(int *) arg;
+    for (size_t i = 0; i < MESSAGES; i++) {
+        message_t m = { .id = i, .producer = id, .payload = 1.0f };
+        while (MPMCQueue_push(mpmc, &m) == 1) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *mpmc_consumer(void *arg) {
+    size_t *sum = (size_t *) arg;
+    for (size_t i = 0; i < MESSAGES; i++) {
+        message_t m;
+        while (MPMCQueue_pop(mpmc, &m) == 1) {
+            sched_yield();
+        }
+        *sum += m.id;
+    }
+    return NULL;
+}
+
+int main() {
+
+    printf("----- SPSCQueue -----\n\n");
+
+    spsc = SPSCQueue_create(1000, sizeof(message_t));
+    if (spsc == NULL) {
+        printf("Creation of SPSCQueue failed.\n");
+        return 1;
+    }
+    printf("SPSCQueue created with a capacity of %ld messages.\n", SPSCQueue_capacity(spsc));
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, spsc_producer, NULL);
+
+    // Messages arrive complete and in order.
+    size_t received = 0;
+    while (received < MESSAGES) {
+        message_t m;
+        if (SPSCQueue_pop(spsc, &m) == 1) {
+            sched_yield();
+            continue;
+        }
+        if (m.id != received || m.payload != received * 0.5f) {
+            printf("Received message %zu, expected %zu.\n", m.id, received);
+            return 1;
+        }
+        received++;
+    }
+    pthread_join(producer, NULL);
+    printf("Received %zu messages in order, %ld left.\n", received, SPSCQueue_size(spsc));
+    SPSCQueue_free(spsc);
+
+
+    printf("\n----- MPMCQueue -----\n\n");
+
+    mpmc = MPMCQueue_create(64, sizeof(message_t));
+    if (mpmc == NULL) {
+        printf("Creation of MPMCQueue failed.\n");
+        return 1;
+    }
+
+    pthread_t producers[THREADS], consumers[THREADS];
+    int ids[THREADS];
+    size_t sums[THREADS] = { 0 };
+    for (int i = 0; i < THREADS; i++) {
+        ids[i] = i;
+        pthread_create(&producers[i], NULL, mpmc_producer, &ids[i]);
+        pthread_create(&consumers[i], NULL, mpmc_consumer, &sums[i]);
+    }
+    size_t sum = 0;
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(producers[i], NULL);
+        pthread_join(consumers[i], NULL);
+        sum += sums[i];
+    }
+
+    // Every message is received exactly once.
+    size_t expected = (size_t) THREADS * MESSAGES * (MESSAGES - 1) / 2;
+    printf("%d producers and %d consumers: sum of ids %zu, expected %zu.\n", THREADS, THREADS, sum, expected);
+    if (sum != expected) {
+        return 1;
+    }
+
+    message_t m = { 0 };
+    for (int i = 0; i < 64; i++) {
+        MPMCQueue_push(mpmc, &m);
+    }
+    printf("Push into a full queue returns %d.\n", MPMCQueue_push(mpmc, &m));
+    MPMCQueue_free(mpmc);
+
+    printf("\n--- Errors ---\n");
+    clib_clear_error();
+    if (SPSCQueue_create(16, 0) == NULL) {
+        printf("SPSCQueue_create(16, 0) failed: %s\n", clib_strerror(clib_last_error()));
+    }
+
+    printf("All good!\n");
+    return EXIT_SUCCESS;
+}
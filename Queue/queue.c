@@ -0,0 +1,412 @@
+#include "queue.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Fields written by different threads are kept this far apart, so they
+// never share a cache line.
+#define CACHE_LINE 64
+
+/*
+* SPSC: a ring of `capacity` (a power of two) elements. `tail` counts
+* the elements pushed and is only written by the producer, `head`
+* counts the elements popped and is only written by the consumer. Each
+* side keeps a copy of the other side's index and only reloads it when
+* the queue looks full (or empty), so in the steady state neither side
+* reads the cache line the other one writes.
+*/
+struct SPSCQueue {
+    // Producer.
+    _Alignas(CACHE_LINE) atomic_size_t tail;
+    size_t head_cache;
+    // Consumer.
+    _Alignas(CACHE_LINE) atomic_size_t head;
+    size_t tail_cache;
+    // Constant after creation.
+    _Alignas(CACHE_LINE) char *data;
+    size_t mask;
+    size_t stride;
+    CLIB_Allocator allocator;
+    // The block the queue was carved out of, see `alloc_aligned`.
+    void *block;
+};
+
+/*
+* MPMC: Dmitry Vyukov's bounded queue. Every cell carries a sequence
+* number telling which turn it is at: `pos` means it is free for the
+* push at position `pos`, `pos + 1` that it holds the element for the
+* pop at position `pos`. Producers claim a position with a CAS on
+* `enqueue_pos`, consumers with a CAS on `dequeue_pos`; the cell's
+* sequence number then hands the element over without further
+* synchronization between the two sides.
+*/
+struct MPMCQueue {
+    _Alignas(CACHE_LINE) atomic_size_t enqueue_pos;
+    _Alignas(CACHE_LINE) atomic_size_t dequeue_pos;
+    // Constant after creation. A cell is the sequence number followed by
+    // the element, padded to `cell_size` bytes.
+    _Alignas(CACHE_LINE) char *cells;
+    size_t mask;
+    size_t stride;
+    size_t cell_size;
+    CLIB_Allocator allocator;
+    void *block;
+};
+
+/**
+* `copy_elem` copies a single element. Common element sizes get a
+* fixed-size copy the compiler can turn into plain loads and stores.
+*/
+static inline void copy_elem(void *dst, const void *src, size_t stride) {
+    switch (stride) {
+        case 4:  memcpy(dst, src, 4);  break;
+        case 8:  memcpy(dst, src, 8);  break;
+        case 16: memcpy(dst, src, 16); break;
+        default: memcpy(dst, src, stride);
+    }
+}
+
+/**
+* `alloc_aligned` allocates `size` bytes aligned to `CACHE_LINE`. The
+* allocator only guarantees malloc's alignment, so it over-allocates by
+* `CACHE_LINE - 1` bytes and rounds the address up; the block to free
+* is stored in `*block`. Free it with `aligned_size(size)` bytes.
+*/
+static inline size_t aligned_size(size_t size) {
+    return size + CACHE_LINE - 1;
+}
+
+static void *alloc_aligned(CLIB_Allocator *a, size_t size, void **block) {
+    *block = a->alloc(a->ctx, aligned_size(size));
+    if (*block == NULL) {
+        return NULL;
+    }
+    uintptr_t p = ((uintptr_t) *block + CACHE_LINE - 1) & ~(uintptr_t) (CACHE_LINE - 1);
+    return (void *) p;
+}
+
+/**
+* `ring_size` rounds `capacity` up to a power of two (at least 2).
+* Returns 0 if that overflows.
+*/
+static size_t ring_size(size_t capacity) {
+    size_t n = 2;
+    while (n < capacity) {
+        if (n > SIZE_MAX / 2) {
+            return 0;
+        }
+        n *= 2;
+    }
+    return n;
+}
+
+/**
+* `SPSCQueue_create` creates a queue for one producer and one consumer
+* thread, holding up to `capacity` elements (rounded up to a power of
+* two) of `stride` bytes. In case of failure it returns `NULL`.
+*/
+SPSCQueue *SPSCQueue_create(size_t capacity, size_t stride) {
+    return SPSCQueue_create_with_allocator(capacity, stride, NULL);
+}
+
+/**
+* `SPSCQueue_create_with_allocator` works like `SPSCQueue_create`, but
+* all memory is obtained from `allocator` (malloc/realloc/free if
+* `NULL`).
+*/
+SPSCQueue *SPSCQueue_create_with_allocator(size_t capacity, size_t stride,
+                                           const CLIB_Allocator *allocator) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    size_t n = ring_size(capacity);
+    if (stride == 0 || n == 0 || n > SIZE_MAX / stride) {
+        CLIB_FAIL(CLIB_EINVAL, "SPSCQueue_create error: invalid stride or capacity.");
+        return NULL;
+    }
+
+    void *block;
+    SPSCQueue *q = (SPSCQueue *) alloc_aligned(&a, sizeof(SPSCQueue), &block);
+    if (q == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "SPSCQueue_create error: failed to allocate memory.");
+        return NULL;
+    }
+    memset(q, 0, sizeof(SPSCQueue));
+    q->block = block;
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+    q->mask      = n - 1;
+    q->stride    = stride;
+    q->allocator = a;
+
+    q->data = (char *) a.alloc(a.ctx, n * stride);
+    if (q->data == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "SPSCQueue_create error: failed to allocate memory.");
+        a.free(a.ctx, block, aligned_size(sizeof(SPSCQueue)));
+        return NULL;
+    }
+
+    return q;
+}
+
+/**
+* `SPSCQueue_free` frees the queue and all elements still in it.
+*/
+void SPSCQueue_free(SPSCQueue *q) {
+    if (q == NULL) {
+        return;
+    }
+    CLIB_Allocator a = q->allocator;
+    a.free(a.ctx, q->data, (q->mask + 1) * q->stride);
+    a.free(a.ctx, q->block, aligned_size(sizeof(SPSCQueue)));
+}
+
+/**
+* `SPSCQueue_push` copies `element` into the queue. Must only be called
+* by the producer thread.
+* Returns 0 on success, 1 if the queue is full, -1 on error.
+*/
+int SPSCQueue_push(SPSCQueue *q, const void *element) {
+    if (q == NULL || element == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "SPSCQueue_push error: queue or element is NULL.");
+        return -1;
+    }
+
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (tail - q->head_cache > q->mask) {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (tail - q->head_cache > q->mask) {
+            return 1;
+        }
+    }
+
+    copy_elem(q->data + (tail & q->mask) * q->stride, element, q->stride);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+* `SPSCQueue_pop` removes the oldest element and copies it into `out`.
+* Must only be called by the consumer thread.
+* Returns 0 on success, 1 if the queue is empty, -1 on error.
+*/
+int SPSCQueue_pop(SPSCQueue *q, void *out) {
+    if (q == NULL || out == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "SPSCQueue_pop error: queue or out is NULL.");
+        return -1;
+    }
+
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (head == q->tail_cache) {
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if (head == q->tail_cache) {
+            return 1;
+        }
+    }
+
+    copy_elem(out, q->data + (head & q->mask) * q->stride, q->stride);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+* `SPSCQueue_size` returns the number of elements in the queue. While
+* other threads push or pop, the result is only a snapshot.
+*/
+long SPSCQueue_size(SPSCQueue *q) {
+    if (q == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "SPSCQueue_size error: provided queue is NULL.");
+        return -1;
+    }
+    size_t head = atomic_load(&q->head);
+    size_t tail = atomic_load(&q->tail);
+    return (long) (tail - head);
+}
+
+/**
+* `SPSCQueue_capacity` returns the maximum number of elements.
+*/
+long SPSCQueue_capacity(SPSCQueue *q) {
+    if (q == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "SPSCQueue_capacity error: provided queue is NULL.");
+        return -1;
+    }
+    return (long) (q->mask + 1);
+}
+
+/**
+* `cell_seq` returns the sequence number of cell `pos`.
+*/
+static inline atomic_size_t *cell_seq(MPMCQueue *q, size_t pos) {
+    return (atomic_size_t *) (q->cells + (pos & q->mask) * q->cell_size);
+}
+
+/**
+* `cell_data` returns the element of cell `pos`.
+*/
+static inline char *cell_data(MPMCQueue *q, size_t pos) {
+    return q->cells + (pos & q->mask) * q->cell_size + sizeof(atomic_size_t);
+}
+
+/**
+* `MPMCQueue_create` creates a queue for any number of producer and
+* consumer threads, holding up to `capacity` elements (rounded up to a
+* power of two) of `stride` bytes. In case of failure it returns `NULL`.
+*/
+MPMCQueue *MPMCQueue_create(size_t capacity, size_t stride) {
+    return MPMCQueue_create_with_allocator(capacity, stride, NULL);
+}
+
+/**
+* `MPMCQueue_create_with_allocator` works like `MPMCQueue_create`, but
+* all memory is obtained from `allocator` (malloc/realloc/free if
+* `NULL`).
+*/
+MPMCQueue *MPMCQueue_create_with_allocator(size_t capacity, size_t stride,
+                                           const CLIB_Allocator *allocator) {
+    CLIB_Allocator a = allocator != NULL ? *allocator : CLIB_DEFAULT_ALLOCATOR;
+
+    // Cells stay aligned for the sequence numbers.
+    size_t align = _Alignof(atomic_size_t);
+    size_t n = ring_size(capacity);
+    if (stride == 0 || n == 0 || stride > SIZE_MAX / 2) {
+        CLIB_FAIL(CLIB_EINVAL, "MPMCQueue_create error: invalid stride or capacity.");
+        return NULL;
+    }
+    size_t cell_size = (sizeof(atomic_size_t) + stride + align - 1) / align * align;
+    if (n > SIZE_MAX / cell_size) {
+        CLIB_FAIL(CLIB_EINVAL, "MPMCQueue_create error: invalid stride or capacity.");
+        return NULL;
+    }
+
+    void *block;
+    MPMCQueue *q = (MPMCQueue *) alloc_aligned(&a, sizeof(MPMCQueue), &block);
+    if (q == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "MPMCQueue_create error: failed to allocate memory.");
+        return NULL;
+    }
+    memset(q, 0, sizeof(MPMCQueue));
+    q->block = block;
+    atomic_init(&q->enqueue_pos, 0);
+    atomic_init(&q->dequeue_pos, 0);
+    q->mask      = n - 1;
+    q->stride    = stride;
+    q->cell_size = cell_size;
+    q->allocator = a;
+
+    q->cells = (char *) a.alloc(a.ctx, n * cell_size);
+    if (q->cells == NULL) {
+        CLIB_FAIL(CLIB_ENOMEM, "MPMCQueue_create error: failed to allocate memory.");
+        a.free(a.ctx, block, aligned_size(sizeof(MPMCQueue)));
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        atomic_init(cell_seq(q, i), i);
+    }
+
+    return q;
+}
+
+/**
+* `MPMCQueue_free` frees the queue and all elements still in it.
+*/
+void MPMCQueue_free(MPMCQueue *q) {
+    if (q == NULL) {
+        return;
+    }
+    CLIB_Allocator a = q->allocator;
+    a.free(a.ctx, q->cells, (q->mask + 1) * q->cell_size);
+    a.free(a.ctx, q->block, aligned_size(sizeof(MPMCQueue)));
+}
+
+/**
+* `MPMCQueue_push` copies `element` into the queue. Thread-safe.
+* Returns 0 on success, 1 if the queue is full, -1 on error.
+*/
+int MPMCQueue_push(MPMCQueue *q, const void *element) {
+    if (q == NULL || element == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "MPMCQueue_push error: queue or element is NULL.");
+        return -1;
+    }
+
+    size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        size_t seq = atomic_load_explicit(cell_seq(q, pos), memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The cell still holds the element pushed one lap earlier.
+            return 1;
+        } else {
+            pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    copy_elem(cell_data(q, pos), element, q->stride);
+    atomic_store_explicit(cell_seq(q, pos), pos + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+* `MPMCQueue_pop` removes the oldest element and copies it into `out`.
+* Thread-safe.
+* Returns 0 on success, 1 if the queue is empty, -1 on error.
+*/
+int MPMCQueue_pop(MPMCQueue *q, void *out) {
+    if (q == NULL || out == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "MPMCQueue_pop error: queue or out is NULL.");
+        return -1;
+    }
+
+    size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        size_t seq = atomic_load_explicit(cell_seq(q, pos), memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The element for this position has not been pushed yet.
+            return 1;
+        } else {
+            pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    copy_elem(out, cell_data(q, pos), q->stride);
+    atomic_store_explicit(cell_seq(q, pos), pos + q->mask + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+* `MPMCQueue_size` returns the number of elements in the queue. While
+* other threads push or pop, the result is only a snapshot.
+*/
+long MPMCQueue_size(MPMCQueue *q) {
+    if (q == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "MPMCQueue_size error: provided queue is NULL.");
+        return -1;
+    }
+    size_t head = atomic_load(&q->dequeue_pos);
+    size_t tail = atomic_load(&q->enqueue_pos);
+    return tail > head ? (long) (tail - head) : 0;
+}
+
+/**
+* `MPMCQueue_capacity` returns the maximum number of elements.
+*/
+long MPMCQueue_capacity(MPMCQueue *q) {
+    if (q == NULL) {
+        CLIB_FAIL(CLIB_EINVAL, "MPMCQueue_capacity error: provided queue is NULL.");
+        return -1;
+    }
+    return (long) (q->mask + 1);
+}
@@ -0,0 +1,47 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "clib_alloc.h"
+#include "clib_log.h"
+
+/*
+* Bounded lock-free queues for passing elements of `stride` bytes
+* between threads. Elements are copied into the queue on push and out
+* of it on pop, like DynList elements.
+*
+* `SPSCQueue`: one producer and one consumer thread.
+* `MPMCQueue`: any number of producer and consumer threads.
+*
+* Push returns 1 if the queue is full, pop returns 1 if it is empty;
+* neither ever blocks, so waiting (spinning, yielding, ...) is up to
+* the caller.
+*/
+
+typedef struct SPSCQueue SPSCQueue;
+typedef struct MPMCQueue MPMCQueue;
+
+SPSCQueue *SPSCQueue_create(size_t capacity, size_t stride);
+SPSCQueue *SPSCQueue_create_with_allocator(size_t capacity, size_t stride,
+                                           const CLIB_Allocator *allocator);
+void SPSCQueue_free(SPSCQueue *q);
+int SPSCQueue_push(SPSCQueue *q, const void *element);
+int SPSCQueue_pop(SPSCQueue *q, void *out);
+long SPSCQueue_size(SPSCQueue *q);
+long SPSCQueue_capacity(SPSCQueue *q);
+
+MPMCQueue *MPMCQueue_create(size_t capacity, size_t stride);
+MPMCQueue *MPMCQueue_create_with_allocator(size_t capacity, size_t stride,
+                                           const CLIB_Allocator *allocator);
+void MPMCQueue_free(MPMCQueue *q);
+int MPMCQueue_push(MPMCQueue *q, const void *element);
+int MPMCQueue_pop(MPMCQueue *q, void *out);
+long MPMCQueue_size(MPMCQueue *q);
+long MPMCQueue_capacity(MPMCQueue *q);
+
+#endif